@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Main.cpp: Entry of aquarium_bake, which bakes JSON model files into binary mesh caches
+// ahead of time, so the first launch of Aquarium doesn't need to parse JSON either. It also
+// packs assets into a single asset pack.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "aquarium-optimized/Mesh.h"
+#include "common/AssetPack.h"
+#include "common/MappedFile.h"
+#include "include/CmdArgsHelper.h"
+
+// "assets/BigFishA.js" is baked into "assets/BigFishA.mesh", same as
+// ResourceHelper::getMeshCachePath.
+static std::string getCachePath(const std::string &modelPath)
+{
+    size_t nPos   = modelPath.find_last_of('.');
+    size_t nSlash = modelPath.find_last_of("/\\");
+    if (nPos == std::string::npos || (nSlash != std::string::npos && nPos < nSlash))
+    {
+        return modelPath + ".mesh";
+    }
+    return modelPath.substr(0, nPos) + ".mesh";
+}
+
+// Pack the files into packPath. Model files are baked, and are packed as their mesh caches in
+// place of the JSON files.
+static bool pack(const std::string &packPath, const std::vector<std::string> &paths)
+{
+    std::vector<AssetPackInput> assets;
+    for (const auto &path : paths)
+    {
+        // Assets are looked up by their paths relative to the root, such as "assets/Coral.js".
+        std::string name = path;
+        std::replace(name.begin(), name.end(), '\\', '/');
+        while (name.compare(0, 2, "./") == 0)
+        {
+            name.erase(0, 2);
+        }
+
+        // Stale caches are baked again from their JSON files.
+        if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".mesh") == 0)
+        {
+            continue;
+        }
+
+        AssetPackInput asset;
+        asset.name = name;
+        Mesh mesh;
+        if (mesh.loadFromJson(path))
+        {
+            optimizeMesh(path, &mesh);
+
+            uint64_t sourceHash;
+            if (!hashFile(path, &sourceHash) || !mesh.writeCache(&asset.data, sourceHash))
+            {
+                std::cerr << "Failed to bake " << path << std::endl;
+                return false;
+            }
+            asset.name = getCachePath(name);
+        }
+        else
+        {
+            MappedFile file;
+            if (!file.open(path))
+            {
+                std::cerr << "Failed to read " << path << std::endl;
+                return false;
+            }
+            asset.data.assign(file.data(), file.data() + file.size());
+        }
+        assets.push_back(std::move(asset));
+    }
+
+    if (!writeAssetPack(packPath, &assets))
+    {
+        std::cerr << "Failed to write " << packPath << std::endl;
+        return false;
+    }
+    std::cout << "Packed " << assets.size() << " assets into " << packPath << std::endl;
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool force = false;
+    std::string packPath;
+    std::vector<std::string> modelPaths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string cmd(argv[i]);
+        if (cmd == "-h" || cmd == "--h")
+        {
+            std::cout << cmdArgsStrAquariumBake << std::endl;
+            return 0;
+        }
+        else if (cmd == "--force")
+        {
+            force = true;
+        }
+        else if (cmd == "--pack" && i + 1 < argc)
+        {
+            packPath = argv[++i];
+        }
+        else
+        {
+            modelPaths.push_back(cmd);
+        }
+    }
+
+    if (modelPaths.empty())
+    {
+        std::cout << cmdArgsStrAquariumBake << std::endl;
+        return -1;
+    }
+
+    if (!packPath.empty())
+    {
+        return pack(packPath, modelPaths) ? 0 : -1;
+    }
+
+    int failed = 0;
+    for (const auto &modelPath : modelPaths)
+    {
+        std::string cachePath = getCachePath(modelPath);
+
+        uint64_t sourceHash;
+        if (!hashFile(modelPath, &sourceHash))
+        {
+            std::cerr << "Failed to read " << modelPath << std::endl;
+            ++failed;
+            continue;
+        }
+
+        Mesh mesh;
+        if (!force && mesh.loadFromCache(cachePath, sourceHash))
+        {
+            std::cout << cachePath << " is up to date." << std::endl;
+            continue;
+        }
+
+        // Files other than models, such as PropPlacement.js, don't have "models".
+        if (!mesh.loadFromJson(modelPath))
+        {
+            std::cerr << "Skip " << modelPath << ", it isn't a model file." << std::endl;
+            continue;
+        }
+        optimizeMesh(modelPath, &mesh);
+
+        if (!mesh.writeCache(cachePath, sourceHash))
+        {
+            std::cerr << "Failed to write " << cachePath << std::endl;
+            ++failed;
+            continue;
+        }
+        std::cout << "Baked " << cachePath << std::endl;
+    }
+
+    return failed == 0 ? 0 : -1;
+}
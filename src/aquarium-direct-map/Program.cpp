@@ -11,11 +11,11 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <regex>
 
 #include "Program.h"
 
 #include "common/AQUARIUM_ASSERT.h"
+#include "common/ShaderPreprocessor.h"
 
 Program::Program(const std::string &vId, const std::string &fId)
     : program(0u),
@@ -62,21 +62,19 @@ void Program::createProgramFromTags(const std::string &vId, const std::string &f
         R"(outColor = mix(outColor, vec4(fogColor.rgb, diffuseColor.a),
         clamp(pow((v_position.z / v_position.w), fogPower) * fogMult - fogOffset,0.0,1.0));)";
 
-#ifdef __APPLE__
-    VertexShaderCode = std::regex_replace(VertexShaderCode, std::regex(R"(#version 450 core)"), R"(#version 410 core)");
-    FragmentShaderCode = std::regex_replace(FragmentShaderCode, std::regex(R"(#version 450 core)"), R"(#version 410 core)");
-    #endif
-
     // enable fog, reflection and normalMaps
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(// #fogUniforms)"), fogUniforms);
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(// #fogCode)"), fogCode);
-
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noReflection)"), "");
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noNormalMap)"), "");
+    ShaderVariant variant;
+    variant.removedTags     = {"noReflection", "noNormalMap"};
+    variant.substitutedTags = {{"fogUniforms", fogUniforms}, {"fogCode", fogCode}};
+#ifdef __APPLE__
+    variant.fromVersion = "450 core";
+    variant.toVersion   = "410 core";
+#endif
+
+    // Models of the scene share shader files, which are tokenized once.
+    static ShaderPreprocessor preprocessor;
+    VertexShaderCode   = preprocessor.preprocess(vId, VertexShaderCode, variant);
+    FragmentShaderCode = preprocessor.preprocess(fId, FragmentShaderCode, variant);
 
     program = LoadProgram(VertexShaderCode, FragmentShaderCode);
 }
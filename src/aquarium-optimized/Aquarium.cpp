@@ -10,26 +10,128 @@
 // Update uniforms for each frame.
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
-#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 
 #include "Aquarium.h"
+#include "AssetLoader.h"
 #include "ContextFactory.h"
 #include "FishModel.h"
 #include "Matrix.h"
+#include "Mesh.h"
 #include "Program.h"
+#include "ResourceHelper.h"
 #include "SeaweedModel.h"
+#include "ShaderPermutation.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
 
 #include "common/AQUARIUM_ASSERT.h"
+#include "common/ProcessMemory.h"
 #include "include/CmdArgsHelper.h"
 #include "opengl/ContextGL.h"
 
-#include "rapidjson/document.h"
-#include "rapidjson/istreamwrapper.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
+
+namespace {
+
+struct PlacementObject
+{
+    std::string name;
+    std::vector<float> worldMatrix;
+};
+
+// SAX handler which reads the names and world matrices of "objects" in a placement file.
+class PlacementHandler
+{
+  public:
+    explicit PlacementHandler(std::vector<PlacementObject> *objects)
+        : mObjects(objects), mDepth(0), mKey(), mInObjects(false), mFoundObjects(false)
+    {
+    }
+
+    bool foundObjects() const { return mFoundObjects; }
+
+    bool Null() { return true; }
+    bool Bool(bool) { return true; }
+    bool Int(int i) { return addNumber(i); }
+    bool Uint(unsigned u) { return addNumber(u); }
+    bool Int64(int64_t i) { return addNumber(static_cast<double>(i)); }
+    bool Uint64(uint64_t u) { return addNumber(static_cast<double>(u)); }
+    bool Double(double d) { return addNumber(d); }
+    bool RawNumber(const char *, rapidjson::SizeType, bool) { return false; }
+
+    bool String(const char *str, rapidjson::SizeType length, bool)
+    {
+        if (mInObjects && mDepth == 3 && mKey == "name")
+        {
+            mObjects->back().name.assign(str, length);
+        }
+        return true;
+    }
+
+    bool StartObject() { return startContainer(); }
+    bool StartArray() { return startContainer(); }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool)
+    {
+        mKey.assign(str, length);
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) { return endContainer(); }
+    bool EndArray(rapidjson::SizeType) { return endContainer(); }
+
+  private:
+    // Depth 1 is the root object, 2 is the "objects" array, 3 is an object and 4 is its
+    // world matrix.
+    bool startContainer()
+    {
+        ++mDepth;
+        if (mDepth == 2 && mKey == "objects")
+        {
+            mInObjects    = true;
+            mFoundObjects = true;
+        }
+        else if (mInObjects && mDepth == 3)
+        {
+            mObjects->emplace_back();
+            mObjects->back().worldMatrix.reserve(16);
+        }
+        return true;
+    }
+
+    bool endContainer()
+    {
+        if (mDepth == 2)
+        {
+            mInObjects = false;
+        }
+        --mDepth;
+        return true;
+    }
+
+    bool addNumber(double value)
+    {
+        if (mInObjects && mDepth == 4 && mKey == "worldMatrix")
+        {
+            mObjects->back().worldMatrix.push_back(static_cast<float>(value));
+        }
+        return true;
+    }
+
+    std::vector<PlacementObject> *mObjects;
+    int mDepth;
+    std::string mKey;
+    bool mInObjects;
+    bool mFoundObjects;
+};
+
+}  // namespace
 
 Aquarium::Aquarium()
     : mModelEnumMap(),
@@ -40,7 +142,16 @@ Aquarium::Aquarium()
       mFpsTimer(),
       mFishCount(1),
       mBackendType(BACKENDTYPE::BACKENDTYPELAST),
-      mFactory(nullptr)
+      mFactory(nullptr),
+      mFrustum(),
+      mCullingStats(),
+      mDrawTimeStats({0.0, 0.0, 0}),
+      mLoadingThreadCount(ThreadPool::getHardwareThreadCount()),
+      mTextureLoader(nullptr),
+      mFishDrawOrder(),
+      mTextureBudget(0),
+      mTextureStreamer(nullptr),
+      mInitTime()
 {
     g.then     = 0.0f;
     g.mclock   = 0.0f;
@@ -75,6 +186,10 @@ Aquarium::Aquarium()
 
 Aquarium::~Aquarium()
 {
+    // Join the decoding threads before the textures are deleted.
+    delete mTextureLoader;
+    delete mTextureStreamer;
+
     for (auto &tex : mTextureMap)
     {
         if (tex.second != nullptr)
@@ -143,13 +258,19 @@ BACKENDTYPE Aquarium::getBackendType(const std::string& backendPath)
 
 bool Aquarium::init(int argc, char **argv)
 {
-    mFactory = new ContextFactory();
+    mInitTime = std::chrono::steady_clock::now();
+    mFactory  = new ContextFactory();
 
     // Create context of different backends through the cmd args.
     // "--backend" {backend}: create different backends. currently opengl is supported.
     // "--num-fish" {numfish}: imply rendering fish count.
     // "--enable-msaa": enable 4 times MSAA.
     // "--enable-instanced-draws": use instanced draw. By default, it's individual draw.
+    // "--loading-threads" {count}: count of worker threads to load assets, 0 loads serially.
+    // "--enable-interleaved-vertex-buffer": bind one interleaved vertex buffer per model.
+    // "--enable-quantized-vertex-attributes": interleave and quantize vertex attributes to 16 bits.
+    // "--enable-progressive-loading": draw the first frame before textures are loaded.
+    // "--texture-budget-mb" {size}: stream the mips of textures within the GPU memory budget.
     char *pNext;
     for (int i = 1; i < argc; ++i)
     {
@@ -207,6 +328,15 @@ bool Aquarium::init(int argc, char **argv)
                 return false;
             }
         }
+        else if (cmd == "--loading-threads")
+        {
+            mLoadingThreadCount = strtol(argv[i++ + 1], &pNext, 10);
+            if (mLoadingThreadCount < 0)
+            {
+                std::cerr << "Loading thread count should larger or equal to 0." << std::endl;
+                return false;
+            }
+        }
         else if (cmd == "--enable-msaa")
         {
             if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEMSAAx4)))
@@ -277,11 +407,82 @@ bool Aquarium::init(int argc, char **argv)
 
             toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFULLSCREENMODE));
         }
+        else if (cmd == "--enable-interleaved-vertex-buffer")
+        {
+            if (!availableToggleBitset.test(
+                    static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER)))
+            {
+                std::cerr << "Interleaved vertex buffer isn't implemented for the backend."
+                          << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER));
+        }
+        else if (cmd == "--enable-quantized-vertex-attributes")
+        {
+            if (!availableToggleBitset.test(
+                    static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES)))
+            {
+                std::cerr << "Quantized vertex attributes aren't implemented for the backend."
+                          << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES));
+        }
+        else if (cmd == "--enable-progressive-loading")
+        {
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEPROGRESSIVELOADING)))
+            {
+                std::cerr << "Progressive loading isn't implemented for the backend." << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEPROGRESSIVELOADING));
+        }
+        else if (cmd == "--texture-budget-mb")
+        {
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLETEXTURESTREAMING)))
+            {
+                std::cerr << "Texture streaming isn't implemented for the backend." << std::endl;
+                return false;
+            }
+
+            long budget = strtol(argv[i++ + 1], &pNext, 10);
+            if (budget <= 0)
+            {
+                std::cerr << "Texture budget should be larger than 0 MB." << std::endl;
+                return false;
+            }
+            mTextureBudget = static_cast<size_t>(budget) * 1024 * 1024;
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLETEXTURESTREAMING));
+        }
+        else if (cmd == "--enable-fish-texture-arrays")
+        {
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS)))
+            {
+                std::cerr << "Fish texture arrays aren't implemented for the backend."
+                          << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS));
+        }
         else
         {
         }
     }
 
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS)) &&
+        !toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS)))
+    {
+        std::cerr << "Fish texture arrays are only used by the instanced draw path, add "
+                     "--enable-instanced-draws."
+                  << std::endl;
+        return false;
+    }
+
     if (!mContext->initialize(mBackendType, toggleBitset))
     {
         return false;
@@ -292,14 +493,6 @@ bool Aquarium::init(int argc, char **argv)
     std::cout << "Init resources ..." << std::endl;
     getElapsedTime();
 
-    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
-    std::vector<std::string> skyUrls;
-    resourceHelper->getSkyBoxUrls(&skyUrls);
-    mTextureMap["skybox"] = mContext->createTexture("skybox", skyUrls);
-
-    // Init general buffer and binding groups for dawn backend.
-    mContext->initGeneralResources(this);
-
     setupModelEnumMap();
     loadReource();
     mContext->FlushInit();
@@ -312,21 +505,75 @@ bool Aquarium::init(int argc, char **argv)
 
 void Aquarium::display()
 {
+    bool firstFrame = true;
     while (!mContext->ShouldQuit())
     {
         mContext->KeyBoardQuit();
         render();
 
         mContext->DoFlush();
+
+        if (firstFrame)
+        {
+            firstFrame = false;
+            std::cout << "Time to first frame: " << getTimeSinceInit() << "s." << std::endl;
+            if (mTextureLoader == nullptr)
+            {
+                std::cout << "Time to full quality: " << getTimeSinceInit() << "s." << std::endl;
+                printMemoryUsage("after load");
+            }
+        }
+        // After the first frame, so it's drawn with placeholders only.
+        uploadLoadedTextures();
+
+        if (mTextureStreamer != nullptr)
+        {
+            float pixelsPerUnit = g.projection[5] * mContext->getclientHeight() * 0.5f;
+            mTextureStreamer->update(lightWorldPositionUniform.viewProjection, pixelsPerUnit);
+        }
     }
 
+    printMemoryUsage("at steady state");
+    printDrawTimeStats();
+    if (mTextureStreamer != nullptr)
+    {
+        mTextureStreamer->printStats();
+    }
     mContext->Terminate();
 }
 
+// Swap in the textures decoded since the last frame with progressive loading.
+void Aquarium::uploadLoadedTextures()
+{
+    if (mTextureLoader == nullptr || !mTextureLoader->poll())
+    {
+        return;
+    }
+
+    std::cout << "Time to full quality: " << getTimeSinceInit() << "s." << std::endl;
+    printMemoryUsage("after load");
+    delete mTextureLoader;
+    mTextureLoader = nullptr;
+}
+
 void Aquarium::loadReource()
 {
     loadModels();
     loadPlacement();
+
+    // Mips are estimated from the world bounding spheres set by the placement.
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLETEXTURESTREAMING)))
+    {
+        mTextureStreamer = new TextureStreamer(mContext->getResourceHelper(), mTextureBudget,
+                                               mLoadingThreadCount);
+        for (const Model *model : mAquariumModels)
+        {
+            if (model != nullptr)
+            {
+                mTextureStreamer->addModel(model);
+            }
+        }
+    }
 }
 
 void Aquarium::setupModelEnumMap()
@@ -342,41 +589,48 @@ void Aquarium::loadPlacement()
 {
     const ResourceHelper *resourceHelper = mContext->getResourceHelper();
     std::string proppath                 = resourceHelper->getPropPlacementPath();
-    std::ifstream PlacementStream(proppath, std::ios::in);
-    rapidjson::IStreamWrapper isPlacement(PlacementStream);
-    rapidjson::Document document;
-    document.ParseStream(isPlacement);
-
-    ASSERT(document.IsObject());
-
-    ASSERT(document.HasMember("objects"));
-    const rapidjson::Value &objects = document["objects"];
-    ASSERT(objects.IsArray());
+    Resource file;
+    if (!resourceHelper->openResource(proppath, &file))
+    {
+        std::cout << "Couldn't open placement file " << proppath << "." << std::endl;
+        return;
+    }
 
-    for (rapidjson::SizeType i = 0; i < objects.Size(); ++i)
+    std::vector<PlacementObject> objects;
+    PlacementHandler handler(&objects);
+    rapidjson::MemoryStream stream(reinterpret_cast<const char *>(file.data()), file.size());
+    rapidjson::Reader reader;
+    if (reader.Parse(stream, handler).IsError() || !handler.foundObjects())
     {
-        const rapidjson::Value &name        = objects[i]["name"];
-        const rapidjson::Value &worldMatrix = objects[i]["worldMatrix"];
-        ASSERT(worldMatrix.IsArray() && worldMatrix.Size() == 16);
+        std::cout << "Couldn't parse placement file " << proppath << "." << std::endl;
+        return;
+    }
 
-        std::vector<float> matrix;
-        for (rapidjson::SizeType j = 0; j < worldMatrix.Size(); ++j)
-        {
-            matrix.push_back(worldMatrix[j].GetFloat());
-        }
+    for (auto &object : objects)
+    {
+        ASSERT(object.worldMatrix.size() == 16);
 
-        MODELNAME modelname = mModelEnumMap[name.GetString()];
+        MODELNAME modelname = mModelEnumMap[object.name];
         // MODELFIRST means the model is not found in the Map
         if (modelname != MODELNAME::MODELFIRST)
         {
-            mAquariumModels[modelname]->worldmatrices.push_back(matrix);
+            Model *model = mAquariumModels[modelname];
+            model->worldBoundingSpheres.push_back(
+                transformBoundingSphere(model->boundingSphere, object.worldMatrix.data()));
+            model->worldmatrices.push_back(std::move(object.worldMatrix));
         }
     }
 }
 
 void Aquarium::loadModels()
 {
+    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
+    const std::string &imagePath         = resourceHelper->getImagePath();
     bool enableInstanceddraw = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    bool enableProgressiveLoading =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEPROGRESSIVELOADING));
+
+    std::vector<const G_sceneInfo *> infos;
     for (const auto &info : g_sceneInfo)
     {
         if ((enableInstanceddraw && info.type == MODELGROUP::FISH) ||
@@ -384,124 +638,408 @@ void Aquarium::loadModels()
         {
             continue;
         }
-        loadModel(info);
+        infos.push_back(&info);
     }
-}
 
-// Load vertex and index buffers, textures and program for each model.
-void Aquarium::loadModel(const G_sceneInfo &info)
-{
-    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
-    const std::string &imagePath         = resourceHelper->getImagePath();
-    const std::string &programPath       = resourceHelper->getProgramPath();
-    const std::string &modelPath         = resourceHelper->getModelPath(std::string(info.namestr));
+    auto loadStart = std::chrono::steady_clock::now();
+    AssetLoader loader(mLoadingThreadCount);
 
-    std::ifstream ModelStream(modelPath, std::ios::in);
-    rapidjson::IStreamWrapper is(ModelStream);
-    rapidjson::Document document;
-    document.ParseStream(is);
-    ASSERT(document.IsObject());
-    const rapidjson::Value &models = document["models"];
-    ASSERT(models.IsArray());
+    // Textures are decoded on workers as soon as a mesh refers to them, and are uploaded on
+    // this thread while the remaining files are still being read. With progressive loading,
+    // they are uploaded between frames after the first one instead, and placeholders are bound
+    // until then.
+    AssetLoader *textureLoader = &loader;
+    if (enableProgressiveLoading)
+    {
+        mTextureLoader = new AssetLoader(mLoadingThreadCount);
+        textureLoader  = mTextureLoader;
+    }
+    auto submitTexture = [&](Texture *texture) {
+        if (enableProgressiveLoading)
+        {
+            texture->loadPlaceholder();
+        }
+        // The prepared levels are mapped from the texture cache if it's valid. Otherwise each
+        // image, such as a face of the skybox, is decoded by a task of its own, and the levels
+        // are prepared by another task after the last one is done. Handlers run on this thread,
+        // so the count doesn't need to be atomic.
+        auto cached = std::make_shared<bool>(false);
+        textureLoader->submit(
+            [texture, resourceHelper, cached]() { *cached = texture->loadCache(resourceHelper); },
+            [texture, resourceHelper, cached, textureLoader]() {
+                if (*cached)
+                {
+                    texture->loadTexture();
+                    return;
+                }
+
+                size_t imageCount = texture->getImageCount();
+                auto remaining    = std::make_shared<size_t>(imageCount);
+                for (size_t i = 0; i < imageCount; ++i)
+                {
+                    textureLoader->submit(
+                        [texture, resourceHelper, i]() { texture->decodeImage(resourceHelper, i); },
+                        [texture, resourceHelper, remaining, textureLoader]() {
+                            if (--*remaining != 0)
+                            {
+                                return;
+                            }
+                            textureLoader->submit(
+                                [texture, resourceHelper]() {
+                                    texture->prepareLevels(resourceHelper);
+                                },
+                                [texture]() { texture->loadTexture(); });
+                        });
+                }
+            });
+    };
+    bool enableTextureStreaming =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLETEXTURESTREAMING));
+    auto loadTexture = [&](const std::string &name, const std::string &image) {
+        auto it = mTextureMap.find(image);
+        if (it != mTextureMap.end())
+        {
+            return it->second;
+        }
 
+        Texture *texture   = mContext->createTexture(name, imagePath + image);
+        mTextureMap[image] = texture;
+        if (enableTextureStreaming)
+        {
+            texture->setStreamed();
+        }
+        submitTexture(texture);
+        return texture;
+    };
+    // With fish texture arrays, the textures of the instanced fish only record their images,
+    // which are loaded into the arrays after the meshes.
+    bool enableFishTextureArrays =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS));
+    auto createTexture = [&](const std::string &name, const std::string &image) {
+        auto it = mTextureMap.find(image);
+        if (it != mTextureMap.end())
+        {
+            return it->second;
+        }
+
+        Texture *texture   = mContext->createTexture(name, imagePath + image);
+        mTextureMap[image] = texture;
+        return texture;
+    };
+    // Shaders are read, preprocessed and compiled on workers if the backend can compile off the
+    // render thread. Otherwise the render thread only starts compiling them, and waits for all of
+    // them at the end, so the driver compiles them in parallel.
+    auto loadProgram = [&](uint32_t key) {
+        auto it = mProgramMap.find(key);
+        if (it != mProgramMap.end())
+        {
+            return it->second;
+        }
+
+        std::string vsId;
+        std::string fsId;
+        getShaderFiles(key, &vsId, &fsId);
+        const std::string &programPath = resourceHelper->getProgramPath();
+        Program *program = mContext->createProgram(programPath + vsId, programPath + fsId, key);
+        mProgramMap[key] = program;
+        loader.submit([program]() { program->prepareProgram(); },
+                      [program]() { program->loadProgram(); });
+        return program;
+    };
+
+    std::vector<std::string> skyUrls;
+    resourceHelper->getSkyBoxUrls(&skyUrls);
+    Texture *skybox       = mContext->createTexture("skybox", skyUrls);
+    mTextureMap["skybox"] = skybox;
+    submitTexture(skybox);
+
+    // The programs named by the scene are known up front, so they compile while the meshes are
+    // read. Those of the other models depend on the maps in their meshes.
+    for (const G_sceneInfo *info : infos)
+    {
+        if (std::string(info->program[0]) != "")
+        {
+            loadProgram(getProgramKey(*info, false, false));
+        }
+    }
+
+    // Buffers are created straight from the meshes, which must outlive the loader. A mesh is
+    // released as soon as the buffers of its model are created.
+    std::vector<Mesh> meshes(infos.size());
+    // Set by the task of each mesh, and read by its handler.
+    std::vector<char> meshLoaded(infos.size(), 0);
+    for (size_t i = 0; i < infos.size(); ++i)
+    {
+        const G_sceneInfo *info = infos[i];
+        Mesh *mesh              = &meshes[i];
+        char *loaded            = &meshLoaded[i];
+        std::string modelPath   = resourceHelper->getModelPath(info->namestr);
+        std::string cachePath   = resourceHelper->getMeshCachePath(info->namestr);
+        loader.submit(
+            [resourceHelper, modelPath, cachePath, mesh, loaded]() {
+                // The asset pack has the meshes baked instead of the JSON files.
+                const uint8_t *data;
+                size_t size;
+                *loaded = resourceHelper->findPackedResource(cachePath, &data, &size)
+                              ? mesh->loadFromMemory(data, size)
+                              : loadMesh(modelPath, cachePath, mesh);
+            },
+            [&, info, mesh, loaded]() {
+                if (!*loaded)
+                {
+                    std::cout << "Failed to load the mesh of model " << info->namestr << "."
+                              << std::endl;
+                    mesh->clear();
+                    return;
+                }
+                if (enableFishTextureArrays && info->type == MODELGROUP::FISHINSTANCEDDRAW)
+                {
+                    loadModel(*info, *mesh, createTexture, loadProgram);
+                }
+                else
+                {
+                    loadModel(*info, *mesh, loadTexture, loadProgram);
+                }
+                mesh->clear();
+            });
+    }
+
+    loader.run();
+
+    if (enableFishTextureArrays)
+    {
+        loadFishTextureArrays(submitTexture);
+        loader.run();
+    }
+
+    auto compileStart = std::chrono::steady_clock::now();
+    for (auto &program : mProgramMap)
+    {
+        program.second->finishProgram();
+    }
+    std::cout << "Loaded " << mProgramMap.size() << " program permutations, waited "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - compileStart)
+                     .count()
+              << "s for the compiler." << std::endl;
+
+    // Init general buffer and binding groups for dawn backend, and skybox descriptor for
+    // d3d12 backend.
+    mContext->initGeneralResources(this);
+
+    for (const G_sceneInfo *info : infos)
+    {
+        mAquariumModels[info->name]->init();
+    }
+
+    double loadTime =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    double serialTime = loader.getWorkerTime() + loader.getRenderThreadTime();
+    std::cout << "Loaded " << infos.size() << " models"
+              << (resourceHelper->hasAssetPack() ? " from the asset pack" : "") << " with "
+              << loader.getThreadCount() << " loading threads on "
+              << ThreadPool::getHardwareThreadCount() << " cores in "
+              << loadTime << "s. Worker tasks took " << loader.getWorkerTime()
+              << "s, render thread took " << loader.getRenderThreadTime() << "s, speedup "
+              << serialTime / loadTime << "x." << std::endl;
+}
+
+// Create vertex and index buffers for a model, and look up its textures and program.
+void Aquarium::loadModel(
+    const G_sceneInfo &info,
+    const Mesh &mesh,
+    const std::function<Texture *(const std::string &, const std::string &)> &loadTexture,
+    const std::function<Program *(uint32_t)> &loadProgram)
+{
     Model *model               = mContext->createModel(this, info.type, info.name, info.blend);
     mAquariumModels[info.name] = model;
 
-    auto &value = models.GetArray()[models.GetArray().Size() - 1];
     {
         // set up textures
-        const rapidjson::Value &textures = value["textures"];
-        for (rapidjson::Value::ConstMemberIterator itr = textures.MemberBegin();
-             itr != textures.MemberEnd(); ++itr)
+        for (const auto &texture : mesh.getTextures())
         {
-            std::string name  = itr->name.GetString();
-            std::string image = itr->value.GetString();
+            model->textureMap[texture.first] = loadTexture(texture.first, texture.second);
+        }
 
-            if (mTextureMap.find(image) == mTextureMap.end())
+        // set up vertices
+        bool interleaved = false;
+        if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES)))
+        {
+            std::vector<unsigned short> vertices;
+            interleaved =
+                mesh.quantizeVertices(&vertices, &model->vertexElements, &model->vertexStride);
+            if (interleaved)
             {
-                mTextureMap[image] = mContext->createTexture(name, imagePath + image);
+                model->bufferMap["vertices"] = mContext->createBuffer(
+                    model->vertexStride / static_cast<int>(sizeof(unsigned short)),
+                    vertices.data(), vertices.size(), false);
+            }
+        }
+        else if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER)))
+        {
+            std::vector<float> vertices;
+            interleaved =
+                mesh.interleaveVertices(&vertices, &model->vertexElements, &model->vertexStride);
+            if (interleaved)
+            {
+                model->bufferMap["vertices"] = mContext->createBuffer(
+                    model->vertexStride / static_cast<int>(sizeof(float)), vertices.data(),
+                    vertices.size(), false);
             }
-
-            model->textureMap[name] = mTextureMap[image];
         }
 
-        // set up vertices
-        const rapidjson::Value &arrays = value["fields"];
-        for (rapidjson::Value::ConstMemberIterator itr = arrays.MemberBegin();
-             itr != arrays.MemberEnd(); ++itr)
+        for (const auto &attribute : mesh.getAttributes())
         {
-            std::string name  = itr->name.GetString();
-            int numComponents = itr->value["numComponents"].GetInt();
-            std::string type  = itr->value["type"].GetString();
+            bool isIndex = attribute.name == "indices";
             Buffer *buffer;
-            if (name == "indices")
+            if (attribute.type == MeshAttributeType::UINT16)
             {
-                std::vector<unsigned short> vec;
-                for (auto &data : itr->value["data"].GetArray())
-                {
-                    vec.push_back(data.GetInt());
-                }
-                buffer = mContext->createBuffer(numComponents, &vec, true);
+                buffer = mContext->createBuffer(
+                    attribute.numComponents, static_cast<const unsigned short *>(attribute.data),
+                    attribute.count, isIndex);
             }
             else
             {
-                std::vector<float> vec;
-                for (auto &data : itr->value["data"].GetArray())
+                const float *data = static_cast<const float *>(attribute.data);
+                if (attribute.name == "position")
                 {
-                    vec.push_back(data.GetFloat());
+                    model->boundingSphere =
+                        computeBoundingSphere(data, attribute.count, attribute.numComponents);
                 }
-                buffer = mContext->createBuffer(numComponents, &vec, false);
+                // The attribute is already in the interleaved vertex buffer.
+                if (interleaved)
+                {
+                    continue;
+                }
+                buffer = mContext->createBuffer(attribute.numComponents, data, attribute.count,
+                                                isIndex);
             }
 
-            model->bufferMap[name] = buffer;
+            model->bufferMap[attribute.name] = buffer;
         }
 
-        // setup program
-        // There are 3 programs
-        // DM
-        // DM+NM
-        // DM+NM+RM
-        std::string vsId;
-        std::string fsId;
-
-        vsId = info.program[0];
-        fsId = info.program[1];
-
-        if (vsId != "" && fsId != "")
+        // Seaweed vertex shader sways the vertices by up to (0.07 * y)^2 along x axis.
+        if (info.type == MODELGROUP::SEAWEED)
         {
-            model->textureMap["skybox"] = mTextureMap["skybox"];
+            float top  = (model->boundingSphere.center[1] + model->boundingSphere.radius) * 0.07f;
+            model->boundingSphere.radius += top * top;
         }
-        else if (model->textureMap["reflection"] != nullptr)
-        {
-            vsId = "reflectionMapVertexShader";
-            fsId = "reflectionMapFragmentShader";
 
+        // setup program
+        // Look the maps up without inserting them, as the textures of fish are turned into
+        // texture arrays one by one.
+        auto hasTexture = [model](const std::string &name) {
+            auto it = model->textureMap.find(name);
+            return it != model->textureMap.end() && it->second != nullptr;
+        };
+        bool hasNormalMap     = hasTexture("normalMap");
+        bool hasReflectionMap = hasTexture("reflection");
+        if (std::string(info.program[0]) != "" || hasReflectionMap)
+        {
             model->textureMap["skybox"] = mTextureMap["skybox"];
         }
-        else if (model->textureMap["normalMap"] != nullptr)
+
+        model->setProgram(loadProgram(getProgramKey(info, hasNormalMap, hasReflectionMap)));
+    }
+}
+
+// The models named by the scene have their programs. The others are lit by the maps they have, in
+// the order of reflection, normal and diffuse maps.
+uint32_t Aquarium::getProgramKey(const G_sceneInfo &info,
+                                 bool hasNormalMap,
+                                 bool hasReflectionMap) const
+{
+    uint32_t key     = FEATUREFOG;
+    std::string vsId = info.program[0];
+    std::string fsId = info.program[1];
+    if (vsId == "")
+    {
+        if (hasNormalMap)
         {
-            vsId = "normalMapVertexShader";
-            fsId = "normalMapFragmentShader";
+            key |= FEATURENORMALMAP;
         }
-        else
+        if (hasReflectionMap)
         {
-            vsId = "diffuseVertexShader";
-            fsId = "diffuseFragmentShader";
+            key |= FEATUREREFLECTION;
         }
+        return key;
+    }
+
+    switch (info.type)
+    {
+        case MODELGROUP::FISH:
+        case MODELGROUP::FISHINSTANCEDDRAW:
+            key |= FEATUREFISHBEND | FEATURENORMALMAP;
+            if (fsId == "fishReflectionFragmentShader")
+            {
+                key |= FEATUREREFLECTION;
+            }
+            if (info.type == MODELGROUP::FISHINSTANCEDDRAW)
+            {
+                key |= FEATUREINSTANCING;
+                // The species sample the layer of their textures in the fish texture arrays.
+                if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS)))
+                {
+                    key |= FEATURETEXTUREARRAYS;
+                }
+            }
+            break;
+        case MODELGROUP::SEAWEED:
+            key |= FEATURESWAY;
+            break;
+        case MODELGROUP::INNER:
+            key |= FEATUREREFRACTION | FEATURENORMALMAP | FEATUREREFLECTION;
+            break;
+        default:
+            break;
+    }
+    return key;
+}
 
-        Program *program;
-        if (mProgramMap.find(vsId + fsId) != mProgramMap.end())
+// The instanced fish species drawn with the same program get a texture array for each of their
+// textures, with a layer per species. Layers are resized to the largest species.
+void Aquarium::loadFishTextureArrays(const std::function<void(Texture *)> &submitTexture)
+{
+    std::map<std::string, std::vector<FishModel *>> groups;
+    for (const G_sceneInfo &info : g_sceneInfo)
+    {
+        if (info.type == MODELGROUP::FISHINSTANCEDDRAW && mAquariumModels[info.name] != nullptr)
         {
-            program = mProgramMap[vsId + fsId];
+            groups[info.program[1]].push_back(static_cast<FishModel *>(mAquariumModels[info.name]));
         }
-        else
+    }
+
+    for (const auto &group : groups)
+    {
+        const std::vector<FishModel *> &species = group.second;
+        for (auto &texture : species[0]->textureMap)
         {
-            program = mContext->createProgram(programPath + vsId, programPath + fsId);
-            mProgramMap[vsId + fsId] = program;
+            if (texture.first == "skybox")
+            {
+                continue;
+            }
+
+            std::vector<std::string> urls;
+            for (FishModel *model : species)
+            {
+                Texture *layer = model->textureMap[texture.first];
+                ASSERT(layer != nullptr);
+                urls.push_back(layer->getUrls()[0]);
+            }
+
+            Texture *array = mContext->createTextureArray(texture.first, urls);
+            mTextureMap[group.first + "/" + texture.first] = array;
+            for (FishModel *model : species)
+            {
+                model->textureMap[texture.first] = array;
+            }
+            submitTexture(array);
         }
 
-        model->setProgram(program);
-        model->init();
+        for (size_t i = 0; i < species.size(); ++i)
+        {
+            species[i]->setTextureLayer(static_cast<int>(i));
+            mFishDrawOrder.push_back(species[i]);
+        }
     }
 }
 
@@ -544,6 +1082,22 @@ void Aquarium::calculateFishCount()
     }
 }
 
+double Aquarium::getTimeSinceInit() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mInitTime).count();
+}
+
+void Aquarium::printMemoryUsage(const std::string &when) const
+{
+    size_t resident;
+    size_t peak;
+    if (getProcessMemory(&resident, &peak))
+    {
+        std::cout << "Memory " << when << ": RSS " << resident / (1024 * 1024) << " MB, peak "
+                  << peak / (1024 * 1024) << " MB." << std::endl;
+    }
+}
+
 float Aquarium::getElapsedTime()
 {
     // Update our time
@@ -602,6 +1156,7 @@ void Aquarium::updateGlobalUniforms()
     matrix::inverse4(g.view, lightWorldPositionUniform.viewInverse);
     matrix::mulMatrixMatrix4(lightWorldPositionUniform.viewProjection, g.view, g.projection);
     matrix::inverse4(g.viewProjectionInverse, lightWorldPositionUniform.viewProjection);
+    mFrustum.extractPlanes(lightWorldPositionUniform.viewProjection);
 
     memcpy(g.skyView, g.view, 16 * sizeof(float));
     g.skyView[12] = 0.0;
@@ -627,6 +1182,8 @@ void Aquarium::render()
     updateGlobalUniforms();
 
     matrix::resetPseudoRandom();
+    mCullingStats = {};
+    ++mDrawTimeStats.frameCount;
 
     mContext->preFrame();
 
@@ -640,7 +1197,7 @@ void Aquarium::render()
 
     drawOutside();
 
-    mContext->showFPS(mFpsTimer);
+    mContext->showFPS(mFpsTimer, mCullingStats);
 }
 
 void Aquarium::drawBackground()
@@ -684,7 +1241,7 @@ void Aquarium::drawFishes()
 
         if (updateAndDrawForEachFish)
         {
-            model->prepareForDraw();
+            prepareModelForDraw(model);
         }
 
         float fishBaseClock   = g.mclock * g_fishSpeed;
@@ -701,6 +1258,17 @@ void Aquarium::drawFishes()
         float fishYClock      = g_fishYClock;
         float fishZClock      = g_fishZClock;
 
+        // The fish is centered at its world position and may be rotated to any direction, the
+        // tail bends along x axis by up to (2 * length / fishLength)^2 * fishBendAmount.
+        const BoundingSphere &sphere = model->boundingSphere;
+        float extent = std::sqrt(sphere.center[0] * sphere.center[0] +
+                                 sphere.center[1] * sphere.center[1] +
+                                 sphere.center[2] * sphere.center[2]) +
+                       sphere.radius;
+        float bend       = 2.0f * extent / fishInfo.fishLength;
+        float fishExtent = extent + bend * bend * fishInfo.fishBendAmount;
+
+        int curInstance = 0;
         for (int ii = 0; ii < numFish; ++ii)
         {
             float fishClock = fishBaseClock + ii * fishOffset;
@@ -716,27 +1284,46 @@ void Aquarium::drawFishes()
             float yClock         = fishSpeedClock * fishYClock;
             float zClock         = fishSpeedClock * fishZClock;
 
+            float x = sin(xClock) * xRadius;
+            float y = sin(yClock) * yRadius + fishHeight;
+            float z = cos(zClock) * zRadius;
+            if (!mFrustum.intersectsSphere(x, y, z, fishExtent * scale))
+            {
+                continue;
+            }
+
+            // Surviving fish are compacted to the front of the per instance data.
             model->updateFishPerUniforms(
-                sin(xClock) * xRadius, sin(yClock) * yRadius + fishHeight, cos(zClock) * zRadius,
-                sin(xClock - 0.04f) * xRadius, sin(yClock - 0.01f) * yRadius + fishHeight,
+                x, y, z, sin(xClock - 0.04f) * xRadius, sin(yClock - 0.01f) * yRadius + fishHeight,
                 cos(zClock - 0.04f) * zRadius, scale,
                 fmod((g.mclock + ii * g_tailOffsetMult) * fishTailSpeed * speed,
                      static_cast<float>(M_PI) * 2),
-                ii);
+                curInstance);
+            ++curInstance;
             if (updateAndDrawForEachFish)
             {
                 model->updatePerInstanceUniforms(worldUniforms);
-                model->draw();
+                drawModel(model);
             }
         }
-        // TODO(yizhou): If backend is dawn or d3d12, draw only once for every type of fish by
-        // drawInstance. If backend is opengl or angle, draw for exery fish. Update the logic the
-        // same as Dawn if uniform blocks are implemented for OpenGL.
-        if (!updateAndDrawForEachFish)
+        model->setCurInstance(curInstance);
+        mCullingStats.drawnFish += curInstance;
+        mCullingStats.culledFish += numFish - curInstance;
+
+        // Backends with uniform blocks draw every type of fish once, by instanced draws or by a
+        // draw for every fish from one uniform buffer. ANGLE draws right after updating each fish.
+        if (!updateAndDrawForEachFish && mFishDrawOrder.empty())
         {
-            model->draw();
+            drawModel(model);
         }
     }
+
+    // Species sharing texture arrays are drawn one after another, so they don't switch the
+    // pipeline and bind groups in between.
+    for (FishModel *model : mFishDrawOrder)
+    {
+        drawModel(model);
+    }
 }
 
 void Aquarium::drawInner()
@@ -751,6 +1338,49 @@ void Aquarium::drawOutside()
     updateWorldMatrixAndDraw(model);
 }
 
+void Aquarium::prepareModelForDraw(Model *model)
+{
+    auto start = std::chrono::steady_clock::now();
+    model->prepareForDraw();
+    mDrawTimeStats.prepareTime +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Aquarium::drawModel(Model *model)
+{
+    auto start = std::chrono::steady_clock::now();
+    model->draw();
+    mDrawTimeStats.drawTime +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compare the vertex layouts by running with and without --enable-interleaved-vertex-buffer. The
+// vertex buffers are bound in prepareForDraw() on OpenGL and in draw() on dawn, so the CPU cost
+// of binding shows up in either time. The cost of vertex fetch on the GPU shows up in the frame
+// time.
+void Aquarium::printDrawTimeStats() const
+{
+    if (mDrawTimeStats.frameCount == 0)
+    {
+        return;
+    }
+
+    const char *layout = "separate";
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES)))
+    {
+        layout = "quantized interleaved";
+    }
+    else if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER)))
+    {
+        layout = "interleaved";
+    }
+    double framesPerMs = mDrawTimeStats.frameCount / 1000.0;
+    std::cout << "Draws with " << layout << " vertex buffers: "
+              << mDrawTimeStats.prepareTime / framesPerMs << " ms/frame preparing, "
+              << mDrawTimeStats.drawTime / framesPerMs << " ms/frame drawing, "
+              << 1000.0f / mFpsTimer.getAverageFPS() << " ms/frame on average." << std::endl;
+}
+
 void Aquarium::updateWorldProjections(const std::vector<float> &w)
 {
     ASSERT(w.size() == 16);
@@ -766,16 +1396,25 @@ void Aquarium::updateWorldMatrixAndDraw(Model *model)
     bool updateAndDrawForEachFish =
         toggleBitset.test(static_cast<size_t>(TOGGLE::UPATEANDDRAWFOREACHMODEL));
 
+    int drawnCount = 0;
     if (model->worldmatrices.size())
     {
-        for (auto &world : model->worldmatrices)
+        for (size_t i = 0; i < model->worldmatrices.size(); ++i)
         {
-            updateWorldProjections(world);
+            if (!mFrustum.intersectsSphere(model->worldBoundingSpheres[i]))
+            {
+                ++mCullingStats.culledModels;
+                continue;
+            }
+            ++mCullingStats.drawnModels;
+            ++drawnCount;
+
+            updateWorldProjections(model->worldmatrices[i]);
             if (updateAndDrawForEachFish)
             {
-                model->prepareForDraw();
+                prepareModelForDraw(model);
                 model->updatePerInstanceUniforms(worldUniforms);
-                model->draw();
+                drawModel(model);
             }
             else
             {
@@ -784,9 +1423,11 @@ void Aquarium::updateWorldMatrixAndDraw(Model *model)
         }
     }
 
-    if (!updateAndDrawForEachFish)
+    // Models without placement are drawn once, models whose instances are all culled are
+    // skipped.
+    if (!updateAndDrawForEachFish && (drawnCount > 0 || model->worldmatrices.empty()))
     {
-        model->prepareForDraw();
-        model->draw();
+        prepareModelForDraw(model);
+        drawModel(model);
     }
 }
@@ -9,16 +9,25 @@
 #define AQUARIUM_H
 
 #include <bitset>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "../common/FPSTimer.h"
 
+#include "Frustum.h"
+
+class AssetLoader;
 class ContextFactory;
 class Context;
+class FishModel;
 class Texture;
 class Program;
 class Model;
+class Mesh;
+class TextureStreamer;
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 #define M_PI 3.141592653589793
@@ -123,6 +132,18 @@ enum TOGGLE : short
     UPATEANDDRAWFOREACHMODEL,
     // Support Full Screen mode
     ENABLEFULLSCREENMODE,
+    // Pack the vertex attributes of a model into one interleaved vertex buffer.
+    ENABLEINTERLEAVEDVERTEXBUFFER,
+    // Quantize the vertex attributes except position to 16 bits in the interleaved vertex buffer.
+    ENABLEQUANTIZEDVERTEXATTRIBUTES,
+    // Show the first frame with 1x1 placeholder textures, and swap in the real textures when
+    // they are decoded and uploaded.
+    ENABLEPROGRESSIVELOADING,
+    // Pack the textures of the instanced fish species drawn with the same program into texture
+    // arrays, so the species share a pipeline and a bind group.
+    ENABLEFISHTEXTUREARRAYS,
+    // Keep only the mips of textures needed by the view on the GPU, within a memory budget.
+    ENABLETEXTURESTREAMING,
     TOGGLEMAX
 };
 
@@ -422,6 +443,24 @@ struct FogUniforms
     float fogColor[4];
 };
 
+// Count of props and fish that are drawn or rejected by frustum culling in the last frame.
+struct CullingStats
+{
+    int drawnModels;
+    int culledModels;
+    int drawnFish;
+    int culledFish;
+};
+
+// CPU time spent recording the draws of the models, which includes binding their vertex
+// buffers, accumulated over the frames since init.
+struct DrawTimeStats
+{
+    double prepareTime;  // In seconds, in prepareForDraw().
+    double drawTime;     // In seconds, in draw().
+    int frameCount;
+};
+
 class Aquarium
 {
   public:
@@ -444,10 +483,21 @@ class Aquarium
     void loadReource();
     void loadPlacement();
     void loadModels();
-    void loadModel(const G_sceneInfo &info);
+    void loadModel(
+        const G_sceneInfo &info,
+        const Mesh &mesh,
+        const std::function<Texture *(const std::string &, const std::string &)> &loadTexture,
+        const std::function<Program *(uint32_t)> &loadProgram);
+    uint32_t getProgramKey(const G_sceneInfo &info, bool hasNormalMap, bool hasReflectionMap) const;
+    void uploadLoadedTextures();
+    void loadFishTextureArrays(const std::function<void(Texture *)> &submitTexture);
     void setupModelEnumMap();
     void calculateFishCount();
     void updateWorldMatrixAndDraw(Model *model);
+    // Call prepareForDraw() and draw() of the model, accumulating their time into mDrawTimeStats.
+    void prepareModelForDraw(Model *model);
+    void drawModel(Model *model);
+    void printDrawTimeStats() const;
     void updateGlobalUniforms();
     void drawBackground();
     void drawFishes();
@@ -457,10 +507,13 @@ class Aquarium
     void updateWorldProjections(const std::vector<float> &w);
     BACKENDTYPE getBackendType(const std::string &backendPath);
     float getElapsedTime();
+    double getTimeSinceInit() const;
+    void printMemoryUsage(const std::string &when) const;
 
     std::unordered_map<std::string, MODELNAME> mModelEnumMap;
     std::unordered_map<std::string, Texture *> mTextureMap;
-    std::unordered_map<std::string, Program *> mProgramMap;
+    // Keyed by the permutation keys of ShaderPermutation.h.
+    std::unordered_map<uint32_t, Program *> mProgramMap;
     Model *mAquariumModels[MODELNAME::MODELMAX];
     Context *mContext;
     FPSTimer mFpsTimer;  // object to measure frames per second;
@@ -468,6 +521,17 @@ class Aquarium
     BACKENDTYPE mBackendType;
     ContextFactory *mFactory;
     std::vector<std::string> mSkyUrls;
+    Frustum mFrustum;
+    CullingStats mCullingStats;
+    DrawTimeStats mDrawTimeStats;
+    int mLoadingThreadCount;
+    // Loads textures after the first frame with progressive loading.
+    AssetLoader *mTextureLoader;
+    // Fish models grouped by the texture arrays they share. Empty without fish texture arrays.
+    std::vector<FishModel *> mFishDrawOrder;
+    size_t mTextureBudget;  // In bytes.
+    TextureStreamer *mTextureStreamer;
+    std::chrono::steady_clock::time_point mInitTime;
 };
 
 #endif
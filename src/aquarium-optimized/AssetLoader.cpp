@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AssetLoader.cpp: Implement the task graph to load assets.
+
+#include "AssetLoader.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+long long getMicroseconds(Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+AssetLoader::AssetLoader(int threadCount)
+    : mMutex(),
+      mCondition(),
+      mLoaded(),
+      mPendingCount(0),
+      mWorkerTime(0),
+      mRenderThreadTime(0.0),
+      mPool(threadCount)
+{
+}
+
+void AssetLoader::submit(std::function<void()> task, std::function<void()> onLoaded)
+{
+    ++mPendingCount;
+    mPool.enqueue([this, task, onLoaded]() {
+        Clock::time_point start = Clock::now();
+        task();
+        mWorkerTime += getMicroseconds(start);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mLoaded.push_back(onLoaded);
+        }
+        mCondition.notify_one();
+    });
+}
+
+void AssetLoader::run()
+{
+    while (mPendingCount > 0)
+    {
+        std::function<void()> onLoaded;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return !mLoaded.empty(); });
+            onLoaded = std::move(mLoaded.front());
+            mLoaded.pop_front();
+        }
+
+        Clock::time_point start = Clock::now();
+        onLoaded();
+        mRenderThreadTime += getMicroseconds(start) * 1e-6;
+        --mPendingCount;
+    }
+}
+
+bool AssetLoader::poll()
+{
+    std::deque<std::function<void()>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        loaded.swap(mLoaded);
+    }
+
+    for (auto &onLoaded : loaded)
+    {
+        Clock::time_point start = Clock::now();
+        onLoaded();
+        mRenderThreadTime += getMicroseconds(start) * 1e-6;
+        --mPendingCount;
+    }
+
+    return mPendingCount == 0;
+}
+
+double AssetLoader::getWorkerTime() const
+{
+    return mWorkerTime.load() * 1e-6;
+}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AssetLoader.h: Define the task graph to load assets. File reads, parsing and image decoding
+// run on a worker pool. Backend objects must be created on the render thread, so the
+// completion handler of each task is queued back to the render thread.
+
+#pragma once
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "common/ThreadPool.h"
+
+class AssetLoader
+{
+  public:
+    explicit AssetLoader(int threadCount);
+
+    // Run task on a worker thread, then run onLoaded on the render thread. Must be called on
+    // the render thread, handlers may submit more tasks.
+    void submit(std::function<void()> task, std::function<void()> onLoaded);
+    // Run completion handlers on the calling thread until all of the submitted tasks are done.
+    void run();
+    // Run the completion handlers of the tasks done so far without waiting for the others.
+    // Return true if all of the submitted tasks are done.
+    bool poll();
+
+    int getThreadCount() const { return mPool.getThreadCount(); }
+    // Time spent in tasks on worker threads and in handlers on the render thread, which
+    // is about the time to load the assets serially.
+    double getWorkerTime() const;
+    double getRenderThreadTime() const { return mRenderThreadTime; }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mLoaded;
+    int mPendingCount;
+    std::atomic<long long> mWorkerTime;  // in microseconds
+    double mRenderThreadTime;
+
+    // Declared last, so worker threads are joined before the queue is destroyed.
+    ThreadPool mPool;
+};
+
+#endif  // !ASSET_LOADER_H
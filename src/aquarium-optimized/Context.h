@@ -17,6 +17,7 @@
 #include "ResourceHelper.h"
 
 #include "common/FPSTimer.h"
+#include "common/ShaderPreprocessor.h"
 
 class Aquarium;
 class Program;
@@ -39,14 +40,29 @@ class Context
     virtual bool initialize(
         BACKENDTYPE backend,
         const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset)              = 0;
+    // Textures and programs are created empty. Their files can be read on worker threads
+    // before calling loadTexture() and loadProgram() on the render thread.
     virtual Texture *createTexture(const std::string &name, const std::string &url)           = 0;
     virtual Texture *createTexture(const std::string &name,
                                    const std::vector<std::string> &urls)                      = 0;
-    virtual Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) = 0;
+    // A 2D texture array with a layer for each image. Only backends advertising fish texture
+    // arrays implement it.
+    virtual Texture *createTextureArray(const std::string &name,
+                                        const std::vector<std::string> &urls)
+    {
+        return nullptr;
+    }
+    virtual Buffer *createBuffer(int numComponents,
+                                 const float *buffer,
+                                 size_t size,
+                                 bool isIndex)                                                = 0;
     virtual Buffer *createBuffer(int numComponents,
-                                 std::vector<unsigned short> *buffer,
+                                 const unsigned short *buffer,
+                                 size_t size,
                                  bool isIndex)                                                = 0;
-    virtual Program *createProgram(const std::string &mVId, const std::string &mFId)          = 0;
+    virtual Program *createProgram(const std::string &mVId,
+                                   const std::string &mFId,
+                                   uint32_t features)                                         = 0;
     virtual void setWindowTitle(const std::string &text)                                      = 0;
     virtual bool ShouldQuit()                                                                 = 0;
     virtual void KeyBoardQuit()                                                               = 0;
@@ -55,7 +71,7 @@ class Context
     virtual void FlushInit() {}
     virtual void preFrame()   = 0;
     virtual void showWindow() = 0;
-    virtual void showFPS(const FPSTimer& fpsTimer)    = 0;
+    virtual void showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats) = 0;
     virtual void destoryImgUI() = 0;
 
     int getClientWidth() const { return mClientWidth; }
@@ -71,12 +87,15 @@ class Context
     virtual void updateWorldlUniforms(Aquarium *aquarium) {}
 
     const ResourceHelper *getResourceHelper() { return mResourceHelper; }
+    // Shared by the programs, so each shader file is tokenized once.
+    ShaderPreprocessor *getShaderPreprocessor() { return &mShaderPreprocessor; }
 
   protected:
     int mClientWidth;
     int mClientHeight;
 
     ResourceHelper *mResourceHelper;
+    ShaderPreprocessor mShaderPreprocessor;
 
     std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> mAvailableToggleBitset;
     virtual void initAvailableToggleBitset(BACKENDTYPE backendType) = 0;
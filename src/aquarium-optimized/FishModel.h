@@ -14,7 +14,10 @@
 class FishModel : public Model
 {
   public:
-    FishModel(MODELGROUP type, MODELNAME name, bool blend) : Model(type, name, blend){}
+    FishModel(MODELGROUP type, MODELNAME name, bool blend)
+        : Model(type, name, blend), mCurInstance(0), mTextureLayer(0)
+    {
+    }
 
     virtual void updateFishPerUniforms(float x,
                                        float y,
@@ -25,6 +28,17 @@ class FishModel : public Model
                                        float scale,
                                        float time,
                                        int index) = 0;
+
+    // Fish that survive frustum culling are written to the first slots of the per instance
+    // data. Only that many fish are drawn in the next draw().
+    void setCurInstance(int curInstance) { mCurInstance = curInstance; }
+
+    // Layer of the species in its texture arrays, if the textures are shared with other species.
+    void setTextureLayer(int textureLayer) { mTextureLayer = textureLayer; }
+
+  protected:
+    int mCurInstance;
+    int mTextureLayer;
 };
 
 #endif
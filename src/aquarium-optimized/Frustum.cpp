@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Frustum.cpp: Implements bounding volumes and frustum plane tests.
+
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AQUARIUM_FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+BoundingSphere computeBoundingSphere(const float *positions, size_t count, int numComponents)
+{
+    BoundingSphere sphere = {{0.0f, 0.0f, 0.0f}, 0.0f};
+    if (positions == nullptr || count < 3 || numComponents < 3)
+    {
+        return sphere;
+    }
+
+    float minV[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maxV[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i + 2 < count; i += numComponents)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            minV[j] = std::min(minV[j], positions[i + j]);
+            maxV[j] = std::max(maxV[j], positions[i + j]);
+        }
+    }
+
+    for (int j = 0; j < 3; ++j)
+    {
+        sphere.center[j] = (minV[j] + maxV[j]) * 0.5f;
+    }
+
+    // Tighter than the half diagonal of the box for most of the meshes.
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i + 2 < count; i += numComponents)
+    {
+        float dx = positions[i] - sphere.center[0];
+        float dy = positions[i + 1] - sphere.center[1];
+        float dz = positions[i + 2] - sphere.center[2];
+        radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    sphere.radius = std::sqrt(radiusSq);
+
+    return sphere;
+}
+
+BoundingSphere transformBoundingSphere(const BoundingSphere &sphere, const float *world)
+{
+    BoundingSphere result;
+    const float *c = sphere.center;
+    for (int j = 0; j < 3; ++j)
+    {
+        result.center[j] = c[0] * world[j] + c[1] * world[4 + j] + c[2] * world[8 + j] + world[12 + j];
+    }
+
+    float scaleSq = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float *axis = world + i * 4;
+        scaleSq = std::max(scaleSq, axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    }
+    result.radius = sphere.radius * std::sqrt(scaleSq);
+
+    return result;
+}
+
+Frustum::Frustum()
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        mPlaneX[i] = 0.0f;
+        mPlaneY[i] = 0.0f;
+        mPlaneZ[i] = 0.0f;
+        mPlaneW[i] = FLT_MAX;
+    }
+}
+
+void Frustum::extractPlanes(const float *m)
+{
+    // Row vectors are multiplied on the left, so clip space coordinate j is the
+    // dot product of the position with column j of the matrix.
+    const float col0[4] = {m[0], m[4], m[8], m[12]};
+    const float col1[4] = {m[1], m[5], m[9], m[13]};
+    const float col2[4] = {m[2], m[6], m[10], m[14]};
+    const float col3[4] = {m[3], m[7], m[11], m[15]};
+
+    float planes[6][4];
+    for (int k = 0; k < 4; ++k)
+    {
+        planes[0][k] = col3[k] + col0[k];  // left
+        planes[1][k] = col3[k] - col0[k];  // right
+        planes[2][k] = col3[k] + col1[k];  // bottom
+        planes[3][k] = col3[k] - col1[k];  // top
+        planes[4][k] = col2[k];            // near
+        planes[5][k] = col3[k] - col2[k];  // far
+    }
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+                                 planes[i][2] * planes[i][2]);
+        float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+        mPlaneX[i]      = planes[i][0] * invLength;
+        mPlaneY[i]      = planes[i][1] * invLength;
+        mPlaneZ[i]      = planes[i][2] * invLength;
+        mPlaneW[i]      = planes[i][3] * invLength;
+    }
+}
+
+bool Frustum::intersectsSphere(const BoundingSphere &sphere) const
+{
+    return intersectsSphere(sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius);
+}
+
+bool Frustum::intersectsSphere(float x, float y, float z, float radius) const
+{
+#if defined(AQUARIUM_FRUSTUM_SSE)
+    const __m128 vx = _mm_set1_ps(x);
+    const __m128 vy = _mm_set1_ps(y);
+    const __m128 vz = _mm_set1_ps(z);
+    const __m128 vr = _mm_set1_ps(-radius);
+
+    // distance = x * a + y * b + z * c + d, the sphere is outside if any distance < -radius.
+    __m128 d0 = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(vx, _mm_load_ps(mPlaneX)), _mm_mul_ps(vy, _mm_load_ps(mPlaneY))),
+        _mm_add_ps(_mm_mul_ps(vz, _mm_load_ps(mPlaneZ)), _mm_load_ps(mPlaneW)));
+    __m128 d1 = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(vx, _mm_load_ps(mPlaneX + 4)),
+                   _mm_mul_ps(vy, _mm_load_ps(mPlaneY + 4))),
+        _mm_add_ps(_mm_mul_ps(vz, _mm_load_ps(mPlaneZ + 4)), _mm_load_ps(mPlaneW + 4)));
+
+    __m128 outside = _mm_or_ps(_mm_cmplt_ps(d0, vr), _mm_cmplt_ps(d1, vr));
+    return _mm_movemask_ps(outside) == 0;
+#else
+    for (int i = 0; i < 6; ++i)
+    {
+        float distance = x * mPlaneX[i] + y * mPlaneY[i] + z * mPlaneZ[i] + mPlaneW[i];
+        if (distance < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Frustum.h: Define bounding volumes of models and the view frustum used to
+// cull props and fish that are outside of the camera.
+
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H 1
+
+#include <cstddef>
+
+struct BoundingSphere
+{
+    float center[3];
+    float radius;
+};
+
+// Compute a bounding sphere from the position buffer of a model. The center is
+// the center of the axis aligned bounding box of the vertices.
+BoundingSphere computeBoundingSphere(const float *positions, size_t count, int numComponents);
+
+// Transform the sphere by a row major world matrix, as used by worldmatrices of models.
+// The radius is scaled by the largest axis scale of the matrix.
+BoundingSphere transformBoundingSphere(const BoundingSphere &sphere, const float *world);
+
+class Frustum
+{
+  public:
+    Frustum();
+
+    // Extract the six clip planes from a view projection matrix. The projection
+    // maps depth to [0, w] as matrix::frustum does.
+    void extractPlanes(const float *viewProjection);
+    bool intersectsSphere(const BoundingSphere &sphere) const;
+    bool intersectsSphere(float x, float y, float z, float radius) const;
+
+  private:
+    // Planes are stored as structure of arrays and padded to 8 entries, so that
+    // the SIMD path tests 4 planes at a time. The padding planes never reject.
+    alignas(16) float mPlaneX[8];
+    alignas(16) float mPlaneY[8];
+    alignas(16) float mPlaneZ[8];
+    alignas(16) float mPlaneW[8];
+};
+
+#endif  // !FRUSTUM_H
@@ -0,0 +1,963 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Mesh.cpp: Implements loading of models from JSON files and binary mesh caches.
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
+
+namespace {
+
+// FIFO cache size to report vertex cache stats, which is common on recent GPUs.
+constexpr int kVertexCacheSize = 16;
+// Let the ACMR grow by 5% at most for less overdraw.
+constexpr float kOverdrawThreshold = 1.05f;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t getTypeSize(MeshAttributeType type)
+{
+    return type == MeshAttributeType::UINT16 ? sizeof(unsigned short) : sizeof(float);
+}
+
+bool copyName(char *dst, size_t size, const std::string &src)
+{
+    if (src.size() >= size)
+    {
+        return false;
+    }
+    memset(dst, 0, size);
+    memcpy(dst, src.data(), src.size());
+    return true;
+}
+
+std::string readName(const char *src, size_t size)
+{
+    return std::string(src, strnlen(src, size));
+}
+
+// Bracket structure of a JSON model file, which is found without parsing any value.
+struct ModelFileOutline
+{
+    const char *lastModelBegin;
+    const char *lastModelEnd;
+    // Upper bounds of element counts of the arrays in the last model, in document order.
+    std::vector<size_t> arraySizes;
+};
+
+// Scan the file for the extent of the last entry of the top level "models" array. This only
+// looks at brackets, quotes and commas, so it's much cheaper than parsing the numbers of the
+// models which are not used.
+bool outlineModelFile(const char *json, size_t size, ModelFileOutline *outline)
+{
+    struct Container
+    {
+        char bracket;
+        size_t arrayIndex;
+    };
+    std::vector<Container> stack;
+    std::vector<std::pair<const char *, size_t>> arrays;  // Begin and count of elements.
+    std::string key;
+    bool inModels          = false;
+    const char *modelBegin = nullptr;
+
+    outline->lastModelBegin = nullptr;
+    outline->lastModelEnd   = nullptr;
+    const char *end         = json + size;
+    for (const char *p = json; p < end; ++p)
+    {
+        switch (*p)
+        {
+            case '"':
+            {
+                const char *begin = ++p;
+                while (p < end && *p != '"')
+                {
+                    p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+                }
+                if (stack.size() == 1)
+                {
+                    key.assign(begin, p - begin);
+                }
+                break;
+            }
+            case '{':
+            case '[':
+                if (stack.size() == 1 && *p == '[' && key == "models")
+                {
+                    inModels = true;
+                }
+                else if (stack.size() == 2 && inModels)
+                {
+                    modelBegin = p;
+                }
+                if (*p == '[')
+                {
+                    stack.push_back({*p, arrays.size()});
+                    arrays.emplace_back(p, 1);
+                }
+                else
+                {
+                    stack.push_back({*p, 0});
+                }
+                break;
+            case '}':
+            case ']':
+                if (stack.empty() || (stack.back().bracket == '[') != (*p == ']'))
+                {
+                    return false;
+                }
+                stack.pop_back();
+                if (stack.size() == 2 && inModels)
+                {
+                    outline->lastModelBegin = modelBegin;
+                    outline->lastModelEnd   = p + 1;
+                }
+                else if (stack.size() == 1)
+                {
+                    inModels = false;
+                }
+                break;
+            case ',':
+                if (!stack.empty() && stack.back().bracket == '[')
+                {
+                    ++arrays[stack.back().arrayIndex].second;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!stack.empty() || outline->lastModelBegin == nullptr)
+    {
+        return false;
+    }
+
+    outline->arraySizes.clear();
+    for (const auto &array : arrays)
+    {
+        if (array.first > outline->lastModelBegin && array.first < outline->lastModelEnd)
+        {
+            outline->arraySizes.push_back(array.second);
+        }
+    }
+
+    return true;
+}
+
+// SAX handler which reads a model object straight into typed buffers. "indices" are
+// unsigned shorts, and the other fields are floats.
+class ModelHandler
+{
+  public:
+    ModelHandler(const std::vector<size_t> &arraySizes,
+                 std::vector<std::pair<std::string, std::string>> *textures,
+                 std::vector<MeshAttribute> *attributes,
+                 std::vector<std::vector<float>> *floatStorage,
+                 std::vector<std::vector<unsigned short>> *indexStorage)
+        : mArraySizes(arraySizes),
+          mNextArray(0),
+          mTextures(textures),
+          mAttributes(attributes),
+          mFloatStorage(floatStorage),
+          mIndexStorage(indexStorage),
+          mDepth(0),
+          mSection(Section::OTHER),
+          mName(),
+          mKey(),
+          mInData(false)
+    {
+    }
+
+    bool Null() { return !mInData; }
+    bool Bool(bool) { return !mInData; }
+    bool Int(int i) { return addNumber(i); }
+    bool Uint(unsigned u) { return addNumber(u); }
+    bool Int64(int64_t i) { return addNumber(static_cast<double>(i)); }
+    bool Uint64(uint64_t u) { return addNumber(static_cast<double>(u)); }
+    bool Double(double d) { return addNumber(d); }
+    bool RawNumber(const char *, rapidjson::SizeType, bool) { return false; }
+
+    bool String(const char *str, rapidjson::SizeType length, bool)
+    {
+        if (mInData)
+        {
+            return false;
+        }
+        if (mDepth == 2 && mSection == Section::TEXTURES)
+        {
+            mTextures->emplace_back(mName, std::string(str, length));
+        }
+        return true;
+    }
+
+    bool StartObject()
+    {
+        if (mInData)
+        {
+            return false;
+        }
+        ++mDepth;
+        if (mDepth == 3 && mSection == Section::FIELDS)
+        {
+            MeshAttribute attribute;
+            attribute.name          = mName;
+            attribute.numComponents = 0;
+            attribute.count         = 0;
+            attribute.data          = nullptr;
+            if (mName == "indices")
+            {
+                attribute.type = MeshAttributeType::UINT16;
+                mIndexStorage->emplace_back();
+            }
+            else
+            {
+                attribute.type = MeshAttributeType::FLOAT32;
+                mFloatStorage->emplace_back();
+            }
+            mAttributes->push_back(attribute);
+        }
+        return true;
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool)
+    {
+        if (mDepth == 1)
+        {
+            std::string key(str, length);
+            mSection = key == "textures" ? Section::TEXTURES
+                                         : key == "fields" ? Section::FIELDS : Section::OTHER;
+        }
+        else if (mDepth == 2)
+        {
+            mName.assign(str, length);
+        }
+        else if (mDepth == 3)
+        {
+            mKey.assign(str, length);
+        }
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType)
+    {
+        --mDepth;
+        return true;
+    }
+
+    bool StartArray()
+    {
+        if (mInData)
+        {
+            return false;
+        }
+        size_t size = mNextArray < mArraySizes.size() ? mArraySizes[mNextArray] : 0;
+        ++mNextArray;
+
+        if (mDepth == 3 && mSection == Section::FIELDS && mKey == "data")
+        {
+            mInData = true;
+            if (mAttributes->back().type == MeshAttributeType::UINT16)
+            {
+                mIndexStorage->back().reserve(size);
+            }
+            else
+            {
+                mFloatStorage->back().reserve(size);
+            }
+        }
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType count)
+    {
+        if (mInData)
+        {
+            mAttributes->back().count = count;
+            mInData                   = false;
+        }
+        return true;
+    }
+
+  private:
+    enum class Section
+    {
+        TEXTURES,
+        FIELDS,
+        OTHER,
+    };
+
+    bool addNumber(double value)
+    {
+        if (mInData)
+        {
+            if (mAttributes->back().type == MeshAttributeType::UINT16)
+            {
+                mIndexStorage->back().push_back(static_cast<unsigned short>(value));
+            }
+            else
+            {
+                mFloatStorage->back().push_back(static_cast<float>(value));
+            }
+        }
+        else if (mDepth == 3 && mSection == Section::FIELDS && mKey == "numComponents")
+        {
+            mAttributes->back().numComponents = static_cast<int>(value);
+        }
+        return true;
+    }
+
+    const std::vector<size_t> &mArraySizes;
+    size_t mNextArray;
+    std::vector<std::pair<std::string, std::string>> *mTextures;
+    std::vector<MeshAttribute> *mAttributes;
+    std::vector<std::vector<float>> *mFloatStorage;
+    std::vector<std::vector<unsigned short>> *mIndexStorage;
+
+    int mDepth;  // 1 is the model object.
+    Section mSection;
+    std::string mName;  // Name of the current texture or field.
+    std::string mKey;   // Current key in a field.
+    bool mInData;
+};
+
+// Round to nearest even. Values out of the range of half float become infinity.
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign     = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff)
+    {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+    if (halfExponent >= 0x1f)
+    {
+        return sign | 0x7c00;
+    }
+
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t midpoint;
+    if (halfExponent <= 0)
+    {
+        // Subnormal half float.
+        if (halfExponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - halfExponent;
+        half      = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        midpoint  = 1u << (shift - 1);
+    }
+    else
+    {
+        half      = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1fff;
+        midpoint  = 0x1000;
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent.
+    if (remainder > midpoint || (remainder == midpoint && (half & 1) != 0))
+    {
+        ++half;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+uint16_t quantize(float value, VertexElementFormat format)
+{
+    switch (format)
+    {
+        case VertexElementFormat::UNORM16:
+        {
+            float clamped = std::min(std::max(value, 0.0f), 1.0f);
+            return static_cast<uint16_t>(std::lround(clamped * 65535.0f));
+        }
+        case VertexElementFormat::SNORM16:
+        {
+            float clamped = std::min(std::max(value, -1.0f), 1.0f);
+            return static_cast<uint16_t>(static_cast<int16_t>(std::lround(clamped * 32767.0f)));
+        }
+        default:
+        {
+            return floatToHalf(value);
+        }
+    }
+}
+
+VertexElementFormat chooseQuantizedFormat(const MeshAttribute &attribute)
+{
+    const float *data = static_cast<const float *>(attribute.data);
+    float minValue    = 0.0f;
+    float maxValue    = 0.0f;
+    if (attribute.count > 0)
+    {
+        auto range = std::minmax_element(data, data + attribute.count);
+        minValue   = *range.first;
+        maxValue   = *range.second;
+    }
+
+    if (minValue >= 0.0f && maxValue <= 1.0f)
+    {
+        return VertexElementFormat::UNORM16;
+    }
+    if (minValue >= -1.0f && maxValue <= 1.0f)
+    {
+        return VertexElementFormat::SNORM16;
+    }
+    // Largest finite half float.
+    if (minValue >= -65504.0f && maxValue <= 65504.0f)
+    {
+        return VertexElementFormat::FLOAT16;
+    }
+    return VertexElementFormat::FLOAT32;
+}
+
+}  // namespace
+
+Mesh::Mesh() : mTextures(), mAttributes(), mFloatStorage(), mIndexStorage(), mMappedFile() {}
+
+void Mesh::clear()
+{
+    mTextures.clear();
+    mAttributes.clear();
+    mFloatStorage.clear();
+    mIndexStorage.clear();
+    mMappedFile.close();
+}
+
+const MeshAttribute *Mesh::getAttribute(const std::string &name) const
+{
+    for (const auto &attribute : mAttributes)
+    {
+        if (attribute.name == name)
+        {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+bool Mesh::layoutVertices(bool quantize,
+                          std::vector<VertexElement> *elements,
+                          int *stride,
+                          size_t *vertexCount) const
+{
+    elements->clear();
+    *stride      = 0;
+    *vertexCount = 0;
+    for (const auto &attribute : mAttributes)
+    {
+        if (attribute.type != MeshAttributeType::FLOAT32)
+        {
+            continue;
+        }
+
+        size_t count = attribute.count / attribute.numComponents;
+        if (!elements->empty() && count != *vertexCount)
+        {
+            elements->clear();
+            return false;
+        }
+        *vertexCount = count;
+
+        VertexElement element = {attribute.name, VertexElementFormat::FLOAT32,
+                                 attribute.numComponents, *stride};
+        if (quantize && attribute.name != "position")
+        {
+            element.format        = chooseQuantizedFormat(attribute);
+            element.numComponents = (attribute.numComponents + 1) / 2 * 2;
+        }
+        if (element.format == VertexElementFormat::FLOAT32)
+        {
+            element.numComponents = attribute.numComponents;
+            *stride += element.numComponents * sizeof(float);
+        }
+        else
+        {
+            *stride += element.numComponents * sizeof(uint16_t);
+        }
+        elements->push_back(element);
+    }
+
+    return true;
+}
+
+void Mesh::packVertices(const std::vector<VertexElement> &elements,
+                        int stride,
+                        size_t vertexCount,
+                        uint8_t *vertices) const
+{
+    for (const auto &element : elements)
+    {
+        const MeshAttribute *attribute = getAttribute(element.name);
+        const float *src               = static_cast<const float *>(attribute->data);
+        int srcComponents              = attribute->numComponents;
+        uint8_t *dst                   = vertices + element.offset;
+
+        if (element.format == VertexElementFormat::FLOAT32)
+        {
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                memcpy(dst, src, srcComponents * sizeof(float));
+                src += srcComponents;
+                dst += stride;
+            }
+            continue;
+        }
+
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            uint16_t packed[4];
+            for (int c = 0; c < element.numComponents; ++c)
+            {
+                packed[c] = quantize(c < srcComponents ? src[c] : 0.0f, element.format);
+            }
+            memcpy(dst, packed, element.numComponents * sizeof(uint16_t));
+            src += srcComponents;
+            dst += stride;
+        }
+    }
+}
+
+bool Mesh::interleaveVertices(std::vector<float> *vertices,
+                              std::vector<VertexElement> *elements,
+                              int *stride) const
+{
+    size_t vertexCount;
+    if (!layoutVertices(false, elements, stride, &vertexCount))
+    {
+        return false;
+    }
+
+    vertices->resize(vertexCount * *stride / sizeof(float));
+    packVertices(*elements, *stride, vertexCount, reinterpret_cast<uint8_t *>(vertices->data()));
+
+    return true;
+}
+
+bool Mesh::quantizeVertices(std::vector<unsigned short> *vertices,
+                            std::vector<VertexElement> *elements,
+                            int *stride) const
+{
+    size_t vertexCount;
+    if (!layoutVertices(true, elements, stride, &vertexCount))
+    {
+        return false;
+    }
+
+    vertices->resize(vertexCount * *stride / sizeof(unsigned short));
+    packVertices(*elements, *stride, vertexCount, reinterpret_cast<uint8_t *>(vertices->data()));
+
+    return true;
+}
+
+void Mesh::remapVertices(const std::vector<unsigned int> &remap,
+                         size_t vertexCount,
+                         size_t newVertexCount,
+                         unsigned short *indices,
+                         size_t indexCount)
+{
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        indices[i] = static_cast<unsigned short>(remap[indices[i]]);
+    }
+
+    // Attributes point to the storage, so vertices are moved in place. Shrinking a vector
+    // doesn't reallocate it.
+    std::vector<float> remapped;
+    for (auto &storage : mFloatStorage)
+    {
+        size_t numComponents = storage.size() / vertexCount;
+        remapped.resize(newVertexCount * numComponents);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            std::copy(storage.begin() + v * numComponents,
+                      storage.begin() + (v + 1) * numComponents,
+                      remapped.begin() + remap[v] * numComponents);
+        }
+        storage.resize(remapped.size());
+        std::copy(remapped.begin(), remapped.end(), storage.begin());
+    }
+
+    for (auto &attribute : mAttributes)
+    {
+        if (attribute.type == MeshAttributeType::FLOAT32)
+        {
+            attribute.count = newVertexCount * attribute.numComponents;
+        }
+    }
+}
+
+bool Mesh::optimize(VertexCacheStats *before, VertexCacheStats *after)
+{
+    // Meshes loaded from caches point to read only memory, and are optimized when the caches
+    // are written.
+    if (mFloatStorage.empty() && mIndexStorage.empty())
+    {
+        return false;
+    }
+
+    const MeshAttribute *position = getAttribute("position");
+    const MeshAttribute *indices  = getAttribute("indices");
+    if (position == nullptr || position->type != MeshAttributeType::FLOAT32 ||
+        indices == nullptr || indices->type != MeshAttributeType::UINT16)
+    {
+        return false;
+    }
+
+    size_t vertexCount = position->count / position->numComponents;
+    if (vertexCount == 0)
+    {
+        return false;
+    }
+    for (const auto &attribute : mAttributes)
+    {
+        if (attribute.type == MeshAttributeType::FLOAT32 &&
+            attribute.count != vertexCount * attribute.numComponents)
+        {
+            return false;
+        }
+    }
+
+    unsigned short *indexData = nullptr;
+    for (auto &storage : mIndexStorage)
+    {
+        if (storage.data() == indices->data)
+        {
+            indexData = storage.data();
+        }
+    }
+    if (indexData == nullptr)
+    {
+        return false;
+    }
+    size_t indexCount = indices->count / 3 * 3;
+
+    *before = analyzeVertexCache(indexData, indexCount, vertexCount, kVertexCacheSize);
+
+    // Exported meshes duplicate vertices shared by faces, weld them first so that they can
+    // hit the cache.
+    std::vector<std::pair<const float *, int>> streams;
+    for (const auto &storage : mFloatStorage)
+    {
+        streams.emplace_back(storage.data(), static_cast<int>(storage.size() / vertexCount));
+    }
+    std::vector<unsigned int> remap;
+    size_t uniqueCount = generateVertexRemap(streams, vertexCount, &remap);
+    remapVertices(remap, vertexCount, uniqueCount, indexData, indexCount);
+    vertexCount = uniqueCount;
+
+    optimizeVertexCache(indexData, indexCount, vertexCount);
+    optimizeOverdraw(indexData, indexCount, static_cast<const float *>(position->data),
+                     position->numComponents, vertexCount, kOverdrawThreshold);
+    remap = optimizeVertexFetch(indexData, indexCount, vertexCount);
+    remapVertices(remap, vertexCount, vertexCount, indexData, 0);
+
+    *after = analyzeVertexCache(indexData, indexCount, vertexCount, kVertexCacheSize);
+
+    return true;
+}
+
+bool Mesh::loadFromJson(const std::string &path)
+{
+    clear();
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    const char *json = reinterpret_cast<const char *>(file.data());
+    ModelFileOutline outline;
+    if (!outlineModelFile(json, file.size(), &outline))
+    {
+        return false;
+    }
+
+    // Only the last model is used, so the others are skipped without being parsed.
+    rapidjson::MemoryStream stream(outline.lastModelBegin,
+                                   outline.lastModelEnd - outline.lastModelBegin);
+    ModelHandler handler(outline.arraySizes, &mTextures, &mAttributes, &mFloatStorage,
+                         &mIndexStorage);
+    rapidjson::Reader reader;
+    if (reader.Parse(stream, handler).IsError())
+    {
+        clear();
+        return false;
+    }
+
+    // Point attributes to their storage after all of the storage is allocated.
+    size_t floatIndex = 0;
+    size_t indexIndex = 0;
+    for (auto &attribute : mAttributes)
+    {
+        if (attribute.type == MeshAttributeType::UINT16)
+        {
+            attribute.data = mIndexStorage[indexIndex++].data();
+        }
+        else
+        {
+            attribute.data = mFloatStorage[floatIndex++].data();
+        }
+    }
+
+    return true;
+}
+
+bool Mesh::loadFromCache(const std::string &path, uint64_t sourceHash)
+{
+    clear();
+
+    if (!mMappedFile.open(path) ||
+        !parseCache(mMappedFile.data(), mMappedFile.size(), true, sourceHash))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Mesh::loadFromMemory(const uint8_t *data, size_t size)
+{
+    clear();
+
+    if (!parseCache(data, size, false, 0))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Mesh::parseCache(const uint8_t *base, size_t size, bool checkSourceHash, uint64_t sourceHash)
+{
+    if (size < sizeof(MeshCacheHeader))
+    {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, base, sizeof(header));
+    uint64_t tableEnd = sizeof(MeshCacheHeader) +
+                        static_cast<uint64_t>(header.textureCount) * sizeof(MeshCacheTexture) +
+                        static_cast<uint64_t>(header.attributeCount) * sizeof(MeshCacheAttribute);
+    if (memcmp(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0 ||
+        header.version != kMeshCacheVersion ||
+        (checkSourceHash && header.sourceHash != sourceHash) || header.fileSize != size ||
+        tableEnd > size)
+    {
+        return false;
+    }
+
+    const auto *textures = reinterpret_cast<const MeshCacheTexture *>(base + sizeof(header));
+    for (uint32_t i = 0; i < header.textureCount; ++i)
+    {
+        mTextures.emplace_back(readName(textures[i].name, sizeof(textures[i].name)),
+                               readName(textures[i].image, sizeof(textures[i].image)));
+    }
+
+    const auto *attributes = reinterpret_cast<const MeshCacheAttribute *>(
+        base + sizeof(header) + header.textureCount * sizeof(MeshCacheTexture));
+    for (uint32_t i = 0; i < header.attributeCount; ++i)
+    {
+        const MeshCacheAttribute &entry = attributes[i];
+        uint64_t payloadSize            = entry.count * getTypeSize(entry.type);
+        if (entry.offset % kMeshCachePayloadAlignment != 0 || entry.offset < tableEnd ||
+            entry.offset + payloadSize > size || entry.numComponents == 0)
+        {
+            return false;
+        }
+
+        MeshAttribute attribute;
+        attribute.name          = readName(entry.name, sizeof(entry.name));
+        attribute.numComponents = static_cast<int>(entry.numComponents);
+        attribute.type          = entry.type;
+        attribute.count         = static_cast<size_t>(entry.count);
+        attribute.data          = base + entry.offset;
+        mAttributes.push_back(attribute);
+    }
+
+    return true;
+}
+
+bool Mesh::writeCache(std::vector<uint8_t> *cache, uint64_t sourceHash) const
+{
+    MeshCacheHeader header;
+    memcpy(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+    header.version        = kMeshCacheVersion;
+    header.sourceHash     = sourceHash;
+    header.textureCount   = static_cast<uint32_t>(mTextures.size());
+    header.attributeCount = static_cast<uint32_t>(mAttributes.size());
+
+    std::vector<MeshCacheTexture> textures(mTextures.size());
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        if (!copyName(textures[i].name, sizeof(textures[i].name), mTextures[i].first) ||
+            !copyName(textures[i].image, sizeof(textures[i].image), mTextures[i].second))
+        {
+            return false;
+        }
+    }
+
+    uint64_t tableEnd = sizeof(MeshCacheHeader) + textures.size() * sizeof(MeshCacheTexture) +
+                        mAttributes.size() * sizeof(MeshCacheAttribute);
+    uint64_t offset   = tableEnd;
+    std::vector<MeshCacheAttribute> attributes(mAttributes.size());
+    for (size_t i = 0; i < mAttributes.size(); ++i)
+    {
+        const MeshAttribute &attribute = mAttributes[i];
+        if (!copyName(attributes[i].name, sizeof(attributes[i].name), attribute.name))
+        {
+            return false;
+        }
+        offset                      = alignUp(offset, kMeshCachePayloadAlignment);
+        attributes[i].numComponents = static_cast<uint32_t>(attribute.numComponents);
+        attributes[i].type          = attribute.type;
+        attributes[i].count         = attribute.count;
+        attributes[i].offset        = offset;
+        offset += attribute.count * getTypeSize(attribute.type);
+    }
+    header.fileSize = offset;
+
+    // Padding between payloads is zeroed.
+    cache->assign(static_cast<size_t>(header.fileSize), 0);
+    uint8_t *dst = cache->data();
+    memcpy(dst, &header, sizeof(header));
+    memcpy(dst + sizeof(header), textures.data(), textures.size() * sizeof(MeshCacheTexture));
+    memcpy(dst + sizeof(header) + textures.size() * sizeof(MeshCacheTexture), attributes.data(),
+           attributes.size() * sizeof(MeshCacheAttribute));
+    for (size_t i = 0; i < mAttributes.size(); ++i)
+    {
+        memcpy(dst + attributes[i].offset, mAttributes[i].data,
+               mAttributes[i].count * getTypeSize(mAttributes[i].type));
+    }
+
+    return true;
+}
+
+bool Mesh::writeCache(const std::string &path, uint64_t sourceHash) const
+{
+    std::vector<uint8_t> cache;
+    if (!writeCache(&cache, sourceHash))
+    {
+        return false;
+    }
+
+    // Write to a temporary file first, so a reader never maps a partially written cache.
+    std::string tempPath = path + ".tmp";
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.good())
+    {
+        return false;
+    }
+
+    stream.write(reinterpret_cast<const char *>(cache.data()),
+                 static_cast<std::streamsize>(cache.size()));
+    stream.close();
+
+    if (stream.fail())
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t hashData(const uint8_t *data, size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool hashFile(const std::string &path, uint64_t *hash)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    *hash = hashData(file.data(), file.size());
+
+    return true;
+}
+
+bool loadMesh(const std::string &jsonPath, const std::string &cachePath, Mesh *mesh)
+{
+    uint64_t sourceHash;
+    if (!hashFile(jsonPath, &sourceHash))
+    {
+        std::cerr << "Failed to read " << jsonPath << std::endl;
+        return false;
+    }
+
+    if (mesh->loadFromCache(cachePath, sourceHash))
+    {
+        return true;
+    }
+
+    if (!mesh->loadFromJson(jsonPath))
+    {
+        std::cerr << "Failed to parse " << jsonPath << std::endl;
+        return false;
+    }
+
+    optimizeMesh(jsonPath, mesh);
+
+    // The asset folder may be read only, the cache is only an optimization for the next
+    // launch.
+    mesh->writeCache(cachePath, sourceHash);
+
+    return true;
+}
+
+void optimizeMesh(const std::string &path, Mesh *mesh)
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+    if (mesh->optimize(&before, &after))
+    {
+        std::cout << path << ": vertices " << before.vertexCount << " -> " << after.vertexCount
+                  << ", ACMR " << before.acmr << " -> " << after.acmr << ", ATVR "
+                  << before.atvr << " -> " << after.atvr << std::endl;
+    }
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Mesh.h: Define the CPU side data of a model, which is loaded from a JSON model file
+// or from its binary mesh cache.
+//
+// The binary mesh cache is laid out as below. All of the values are little endian.
+//   MeshCacheHeader
+//   MeshCacheTexture[textureCount]
+//   MeshCacheAttribute[attributeCount]
+//   payloads of attributes, each aligned to kMeshCachePayloadAlignment bytes
+// The cache is mapped at runtime, so buffers are created straight from the mapped pages.
+
+#pragma once
+#ifndef MESH_H
+#define MESH_H 1
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "common/MappedFile.h"
+
+constexpr char kMeshCacheMagic[4]             = {'A', 'Q', 'M', 'C'};
+constexpr uint32_t kMeshCacheVersion          = 2;
+constexpr uint64_t kMeshCachePayloadAlignment = 16;
+
+enum class MeshAttributeType : uint32_t
+{
+    FLOAT32,
+    UINT16,
+};
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint32_t textureCount;
+    uint32_t attributeCount;
+};
+
+struct MeshCacheTexture
+{
+    char name[64];
+    char image[64];
+};
+
+struct MeshCacheAttribute
+{
+    char name[32];
+    uint32_t numComponents;
+    MeshAttributeType type;
+    uint64_t count;
+    uint64_t offset;
+};
+
+struct MeshAttribute
+{
+    std::string name;
+    int numComponents;
+    MeshAttributeType type;
+    size_t count;  // Count of scalars, not vertices.
+    const void *data;
+};
+
+enum class VertexElementFormat
+{
+    FLOAT32,
+    FLOAT16,
+    SNORM16,
+    UNORM16,
+};
+
+// An attribute of an interleaved vertex buffer.
+struct VertexElement
+{
+    std::string name;
+    VertexElementFormat format;
+    int numComponents;
+    int offset;  // In bytes from the start of a vertex.
+};
+
+class Mesh
+{
+  public:
+    Mesh();
+
+    // Load the last entry of "models" in a JSON model file.
+    bool loadFromJson(const std::string &path);
+    // Map a binary mesh cache. Fail if the cache is corrupted or is not built from the
+    // source of sourceHash.
+    bool loadFromCache(const std::string &path, uint64_t sourceHash);
+    // Use a binary mesh cache in memory which outlives the mesh, such as a blob of the asset
+    // pack. The source hash isn't checked, as the pack is baked along with its sources.
+    bool loadFromMemory(const uint8_t *data, size_t size);
+    bool writeCache(const std::string &path, uint64_t sourceHash) const;
+    bool writeCache(std::vector<uint8_t> *cache, uint64_t sourceHash) const;
+
+    // Pairs of texture name and image file.
+    const std::vector<std::pair<std::string, std::string>> &getTextures() const
+    {
+        return mTextures;
+    }
+    const std::vector<MeshAttribute> &getAttributes() const { return mAttributes; }
+    const MeshAttribute *getAttribute(const std::string &name) const;
+
+    // Pack the float attributes into one buffer, so a model binds a single vertex buffer.
+    // stride is the size of a vertex in bytes. Return false if the attributes don't have
+    // the same count of vertices.
+    bool interleaveVertices(std::vector<float> *vertices,
+                            std::vector<VertexElement> *elements,
+                            int *stride) const;
+    // Same as interleaveVertices, but the attributes except position are quantized to 16 bits:
+    // unorm16 if the values are in [0, 1], snorm16 if they are in [-1, 1] and half float
+    // otherwise. Attributes of 1 or 3 components are padded to 2 or 4 components, as there are
+    // no such 16-bit vertex formats on some backends.
+    bool quantizeVertices(std::vector<unsigned short> *vertices,
+                          std::vector<VertexElement> *elements,
+                          int *stride) const;
+
+    // Weld the duplicated vertices of a mesh parsed from JSON, reorder its triangles for the
+    // vertex cache and overdraw, then its vertices for fetch locality. before and after are the
+    // vertex cache stats of the indices. Return false if the mesh is loaded from a cache or has
+    // no indexed positions.
+    bool optimize(VertexCacheStats *before, VertexCacheStats *after);
+
+    // Free the attributes and unmap the cache, such as after the buffers are created from them.
+    void clear();
+
+  private:
+    bool parseCache(const uint8_t *base, size_t size, bool checkSourceHash, uint64_t sourceHash);
+    bool layoutVertices(bool quantize,
+                        std::vector<VertexElement> *elements,
+                        int *stride,
+                        size_t *vertexCount) const;
+    // Move vertex v to remap[v] in every float attribute, and rewrite the indices.
+    void remapVertices(const std::vector<unsigned int> &remap,
+                       size_t vertexCount,
+                       size_t newVertexCount,
+                       unsigned short *indices,
+                       size_t indexCount);
+    void packVertices(const std::vector<VertexElement> &elements,
+                      int stride,
+                      size_t vertexCount,
+                      uint8_t *vertices) const;
+
+    std::vector<std::pair<std::string, std::string>> mTextures;
+    std::vector<MeshAttribute> mAttributes;
+
+    // Backing storage of attributes loaded from JSON.
+    std::vector<std::vector<float>> mFloatStorage;
+    std::vector<std::vector<unsigned short>> mIndexStorage;
+
+    MappedFile mMappedFile;
+};
+
+// 64-bit FNV-1a hash of data, continued from hash, so several blobs can be hashed as one.
+constexpr uint64_t kHashSeed = 14695981039346656037ull;
+uint64_t hashData(const uint8_t *data, size_t size, uint64_t hash = kHashSeed);
+
+// 64-bit FNV-1a hash of the content of a file. Return false if the file can't be read.
+bool hashFile(const std::string &path, uint64_t *hash);
+
+// Load the mesh from the cache at cachePath if it's valid for the JSON model file at
+// jsonPath. Otherwise parse the JSON file and try to write the cache for the next launch.
+bool loadMesh(const std::string &jsonPath, const std::string &cachePath, Mesh *mesh);
+
+// Optimize a mesh parsed from the JSON model file at path, and print its vertex cache stats.
+void optimizeMesh(const std::string &path, Mesh *mesh);
+
+#endif  // !MESH_H
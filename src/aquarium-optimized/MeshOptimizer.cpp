@@ -0,0 +1,452 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshOptimizer.cpp: Implements vertex cache, overdraw and vertex fetch optimization of
+// triangle lists.
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Parameters of the Forsyth algorithm, the cache is modeled as LRU.
+constexpr int kForsythCacheSize    = 32;
+constexpr float kCacheDecayPower   = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// Size of the FIFO cache used to find cluster boundaries for overdraw optimization.
+constexpr unsigned int kClusterCacheSize = 16;
+
+float computeVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle
+        // doesn't just reuse the last edge and form long strips.
+        if (cachePosition < 3)
+        {
+            score = kLastTriangleScore;
+        }
+        else
+        {
+            float scale = 1.0f / (kForsythCacheSize - 3);
+            score       = std::pow(1.0f - (cachePosition - 3) * scale, kCacheDecayPower);
+        }
+    }
+
+    // Prefer vertices with few triangles left, so that they can leave the cache early.
+    score += kValenceBoostScale *
+             std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+    return score;
+}
+
+// FIFO cache simulation. A vertex is in the cache if less than cacheSize vertices are
+// inserted after it.
+class FifoCache
+{
+  public:
+    FifoCache(size_t vertexCount, unsigned int cacheSize)
+        : mInsertTime(vertexCount, 0), mTime(cacheSize + 1), mCacheSize(cacheSize)
+    {
+    }
+
+    // Return true on miss.
+    bool access(unsigned int vertex)
+    {
+        if (mTime - mInsertTime[vertex] > mCacheSize)
+        {
+            mInsertTime[vertex] = mTime++;
+            return true;
+        }
+        return false;
+    }
+
+    void reset() { mTime += mCacheSize + 1; }
+
+  private:
+    std::vector<unsigned int> mInsertTime;
+    unsigned int mTime;
+    unsigned int mCacheSize;
+};
+
+void computeTriangleNormal(const float *a, const float *b, const float *c, float *normal)
+{
+    float e0[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e1[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    // The length of the cross product is twice the area, so sums are area weighted.
+    normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+}  // namespace
+
+VertexCacheStats analyzeVertexCache(const unsigned short *indices,
+                                    size_t indexCount,
+                                    size_t vertexCount,
+                                    int cacheSize)
+{
+    VertexCacheStats stats = {vertexCount, 0.0f, 0.0f};
+    if (indexCount < 3 || vertexCount == 0)
+    {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, static_cast<unsigned int>(cacheSize));
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        misses += cache.access(indices[i]) ? 1 : 0;
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+    stats.atvr = static_cast<float>(misses) / vertexCount;
+    return stats;
+}
+
+size_t generateVertexRemap(const std::vector<std::pair<const float *, int>> &streams,
+                           size_t vertexCount,
+                           std::vector<unsigned int> *remap)
+{
+    remap->resize(vertexCount);
+
+    std::unordered_map<std::string, unsigned int> uniqueVertices;
+    uniqueVertices.reserve(vertexCount);
+    std::string key;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        key.clear();
+        for (const auto &stream : streams)
+        {
+            const float *data = stream.first + v * stream.second;
+            key.append(reinterpret_cast<const char *>(data), stream.second * sizeof(float));
+        }
+
+        auto inserted =
+            uniqueVertices.emplace(key, static_cast<unsigned int>(uniqueVertices.size()));
+        (*remap)[v] = inserted.first->second;
+    }
+
+    return uniqueVertices.size();
+}
+
+void optimizeVertexCache(unsigned short *indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles which use each vertex, the first remainingTriangles[v] ones aren't emitted yet.
+    std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remainingTriangles[indices[i]];
+    }
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = computeVertexScore(-1, remainingTriangles[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned short> output;
+    output.reserve(triangleCount * 3);
+
+    unsigned int cache[kForsythCacheSize + 3];
+    int cacheCount = 0;
+
+    long bestTriangle = static_cast<long>(
+        std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    while (bestTriangle >= 0)
+    {
+        const unsigned short *triangle = indices + bestTriangle * 3;
+        emitted[bestTriangle]          = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v     = triangle[k];
+            unsigned int *list = adjacency.data() + adjacencyOffsets[v];
+            unsigned int count = remainingTriangles[v];
+            for (unsigned int j = 0; j < count; ++j)
+            {
+                if (list[j] == static_cast<unsigned int>(bestTriangle))
+                {
+                    std::swap(list[j], list[count - 1]);
+                    break;
+                }
+            }
+            --remainingTriangles[v];
+        }
+
+        // The vertices of the triangle move to the front of the LRU cache.
+        unsigned int newCache[kForsythCacheSize + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+            {
+                newCache[newCount++] = triangle[k];
+            }
+        }
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        for (int i = 0; i < newCount; ++i)
+        {
+            unsigned int v    = newCache[i];
+            cachePositions[v] = i < kForsythCacheSize ? i : -1;
+            vertexScores[v]   = computeVertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+
+        // Only triangles touching the cache are candidates of the next triangle.
+        bestTriangle    = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < newCount; ++i)
+        {
+            unsigned int v           = newCache[i];
+            const unsigned int *list = adjacency.data() + adjacencyOffsets[v];
+            for (unsigned int j = 0; j < remainingTriangles[v]; ++j)
+            {
+                unsigned int t                  = list[j];
+                const unsigned short *candidate = indices + t * 3;
+                triangleScores[t] = vertexScores[candidate[0]] + vertexScores[candidate[1]] +
+                                    vertexScores[candidate[2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore    = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, kForsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // The cache doesn't touch any triangle left, restart from the best one of the rest.
+        if (bestTriangle < 0)
+        {
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                if (!emitted[t] && triangleScores[t] > bestScore)
+                {
+                    bestScore    = triangleScores[t];
+                    bestTriangle = static_cast<long>(t);
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(unsigned short *indices,
+                      size_t indexCount,
+                      const float *positions,
+                      int positionComponents,
+                      size_t vertexCount,
+                      float threshold)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || positionComponents < 3)
+    {
+        return;
+    }
+
+    // Hard boundaries are where all of the vertices of a triangle miss the cache, so the
+    // clusters can be reordered without adding misses.
+    std::vector<size_t> hardBoundaries;
+    FifoCache cache(vertexCount, kClusterCacheSize);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+        }
+        if (t == 0 || misses == 3)
+        {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // Soft boundaries split the hard clusters further, as soon as the ACMR of the triangles
+    // since the last boundary is close enough to the ACMR of the whole hard cluster.
+    std::vector<size_t> boundaries;
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+    {
+        size_t begin = hardBoundaries[c];
+        size_t end   = hardBoundaries[c + 1];
+
+        cache.reset();
+        size_t clusterMisses = 0;
+        for (size_t i = begin * 3; i < end * 3; ++i)
+        {
+            clusterMisses += cache.access(indices[i]) ? 1 : 0;
+        }
+        float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+        boundaries.push_back(begin);
+        cache.reset();
+        size_t start  = begin;
+        size_t misses = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+            }
+            float acmr = static_cast<float>(misses) / (t - start + 1);
+            if (t + 1 < end && acmr <= clusterAcmr * threshold)
+            {
+                boundaries.push_back(t + 1);
+                cache.reset();
+                start  = t + 1;
+                misses = 0;
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+
+    // Sort the clusters by how much they face away from the center of the mesh.
+    size_t clusterCount = boundaries.size() - 1;
+    std::vector<float> clusterData(clusterCount * 6, 0.0f);  // Centroid and normal.
+    float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+    float meshArea        = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float *centroid = clusterData.data() + c * 6;
+        float *normal   = centroid + 3;
+        float area      = 0.0f;
+        for (size_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+        {
+            const float *a = positions + indices[t * 3] * positionComponents;
+            const float *b = positions + indices[t * 3 + 1] * positionComponents;
+            const float *d = positions + indices[t * 3 + 2] * positionComponents;
+
+            float triangleNormal[3];
+            computeTriangleNormal(a, b, d, triangleNormal);
+            float triangleArea =
+                std::sqrt(triangleNormal[0] * triangleNormal[0] +
+                          triangleNormal[1] * triangleNormal[1] +
+                          triangleNormal[2] * triangleNormal[2]);
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += (a[k] + b[k] + d[k]) / 3.0f * triangleArea;
+                normal[k] += triangleNormal[k];
+            }
+            area += triangleArea;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            meshCentroid[k] += centroid[k];
+            centroid[k] = area > 0.0f ? centroid[k] / area : 0.0f;
+        }
+        meshArea += area;
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+        meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+    }
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        const float *centroid = clusterData.data() + c * 6;
+        const float *normal   = centroid + 3;
+        float length =
+            std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float dot = 0.0f;
+        for (int k = 0; k < 3; ++k)
+        {
+            dot += (centroid[k] - meshCentroid[k]) * normal[k];
+        }
+        sortKeys[c] = length > 0.0f ? dot / length : 0.0f;
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned short> output;
+    output.reserve(triangleCount * 3);
+    for (size_t c : order)
+    {
+        output.insert(output.end(), indices + boundaries[c] * 3, indices + boundaries[c + 1] * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<unsigned int> optimizeVertexFetch(unsigned short *indices,
+                                              size_t indexCount,
+                                              size_t vertexCount)
+{
+    std::vector<unsigned int> remap(vertexCount, UINT_MAX);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int &index = remap[indices[i]];
+        if (index == UINT_MAX)
+        {
+            index = next++;
+        }
+        indices[i] = static_cast<unsigned short>(index);
+    }
+
+    for (auto &index : remap)
+    {
+        if (index == UINT_MAX)
+        {
+            index = next++;
+        }
+    }
+
+    return remap;
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshOptimizer.h: Define reordering of triangle lists for the post transform vertex cache,
+// overdraw and vertex fetch, which runs once when a model is baked into its mesh cache.
+
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct VertexCacheStats
+{
+    size_t vertexCount;
+    // Average cache miss ratio, the count of transformed vertices per triangle. 0.5 is the
+    // best case of a regular grid, 3 is the worst.
+    float acmr;
+    // Average transform to vertex ratio, the count of transformed vertices per vertex. 1 is
+    // the best case.
+    float atvr;
+};
+
+// Simulate a FIFO post transform cache of cacheSize vertices.
+VertexCacheStats analyzeVertexCache(const unsigned short *indices,
+                                    size_t indexCount,
+                                    size_t vertexCount,
+                                    int cacheSize);
+
+// Find the vertices whose attributes are bitwise identical across all of the streams, each of
+// which is a pair of data and count of floats per vertex. Fill remap with the new index of each
+// vertex, where duplicates share the same index, and return the count of unique vertices.
+size_t generateVertexRemap(const std::vector<std::pair<const float *, int>> &streams,
+                           size_t vertexCount,
+                           std::vector<unsigned int> *remap);
+
+// Reorder triangles to reduce vertex cache misses, with the algorithm of Tom Forsyth's
+// "Linear-Speed Vertex Cache Optimisation".
+void optimizeVertexCache(unsigned short *indices, size_t indexCount, size_t vertexCount);
+
+// Split a cache optimized triangle list into clusters, and sort the clusters so that the
+// outward facing ones are drawn first, which lets them occlude the rest. A cluster ends where
+// the cache misses of its triangles so far don't exceed threshold times the cluster average,
+// so that the ACMR grows by about threshold at most.
+void optimizeOverdraw(unsigned short *indices,
+                      size_t indexCount,
+                      const float *positions,
+                      int positionComponents,
+                      size_t vertexCount,
+                      float threshold);
+
+// Renumber vertices in the order they are first referenced by the indices, which are
+// rewritten. Return the table of new index of each old vertex. Unreferenced vertices are
+// moved to the end.
+std::vector<unsigned int> optimizeVertexFetch(unsigned short *indices,
+                                              size_t indexCount,
+                                              size_t vertexCount);
+
+#endif  // !MESH_OPTIMIZER_H
@@ -10,7 +10,9 @@
 #include "Model.h"
 
 Model::Model()
-    : mProgram(nullptr),
+    : vertexStride(0),
+      boundingSphere(),
+      mProgram(nullptr),
       mBlend(false),
       mName(MODELMAX)
 {
@@ -15,6 +15,8 @@
 #include <vector>
 
 #include "Aquarium.h"
+#include "Frustum.h"
+#include "Mesh.h"
 
 class Program;
 class Context;
@@ -30,7 +32,9 @@ class Model
   public:
     Model();
     Model(MODELGROUP type, MODELNAME name, bool blend)
-        : mProgram(nullptr), mBlend(blend), mName(name) {}
+        : vertexStride(0), boundingSphere(), mProgram(nullptr), mBlend(blend), mName(name)
+    {
+    }
     virtual ~Model();
     virtual void prepareForDraw() const     = 0;
     virtual void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) = 0;
@@ -43,6 +47,16 @@ class Model
     std::unordered_map<std::string, Texture *> textureMap;
     std::unordered_map<std::string, Buffer *> bufferMap;
 
+    // Layout of bufferMap["vertices"] if the attributes are interleaved into one vertex buffer.
+    // Empty if each attribute has its own buffer.
+    std::vector<VertexElement> vertexElements;
+    int vertexStride;  // In bytes.
+
+    // Bounding sphere of the mesh in model space, and of each entry of worldmatrices in
+    // world space.
+    BoundingSphere boundingSphere;
+    std::vector<BoundingSphere> worldBoundingSpheres;
+
   protected:
     Program *mProgram;
     bool mBlend;
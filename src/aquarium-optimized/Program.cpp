@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Program.cpp: Read shader files of Programs.
+
+#include "Program.h"
+
+#include "ResourceHelper.h"
+
+void Program::loadSource(const ResourceHelper *resourceHelper)
+{
+    if (mSourceLoaded)
+    {
+        return;
+    }
+
+    Resource vertexShader;
+    if (resourceHelper->openResource(mVId, &vertexShader))
+    {
+        mVertexShaderCode.assign(reinterpret_cast<const char *>(vertexShader.data()),
+                                 vertexShader.size());
+    }
+
+    // Read the Fragment Shader code from the file
+    Resource fragmentShader;
+    if (resourceHelper->openResource(mFId, &fragmentShader))
+    {
+        mFragmentShaderCode.assign(reinterpret_cast<const char *>(fragmentShader.data()),
+                                   fragmentShader.size());
+    }
+
+    mSourceLoaded = true;
+}
@@ -8,24 +8,49 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H 1
 
+#include <cstdint>
 #include <string>
 
 enum UNIFORMNAME : short;
+class ResourceHelper;
 
 class Program
 {
   public:
     Program(){}
-    Program(const std::string &mVertexShader, const std::string &fragmentShader)
-        : mVId(mVertexShader), mFId(fragmentShader)
+    // features is the permutation key of the program, see ShaderPermutation.h.
+    Program(const std::string &mVertexShader, const std::string &fragmentShader, uint32_t features)
+        : mVId(mVertexShader), mFId(fragmentShader), mFeatures(features)
     {
     }
     virtual ~Program() {}
     virtual void setProgram() {}
 
+    // Read the shader files without touching the backend, so it's safe to call on a worker
+    // thread. loadProgram() reads them itself if this isn't called. The files are read through
+    // resourceHelper, which serves them from the asset pack.
+    void loadSource(const ResourceHelper *resourceHelper);
+    // Read and preprocess the shaders, and compile them if the backend can compile off the render
+    // thread. Safe to call on a worker thread. loadProgram() prepares them itself if this isn't
+    // called.
+    virtual void prepareProgram() {}
+    // Create the program from the prepared shaders. Must be called on the render thread. The
+    // backend may still be compiling the program when it returns.
+    virtual void loadProgram() = 0;
+    // Wait for the program to be compiled, and report errors. Must be called on the render thread
+    // after loadProgram(). Programs loaded one after another compile in parallel until then.
+    virtual void finishProgram() {}
+
+    uint32_t getFeatures() const { return mFeatures; }
+
   protected:
     std::string mVId;
     std::string mFId;
+    uint32_t mFeatures = 0;
+    std::string mVertexShaderCode;
+    std::string mFragmentShaderCode;
+    bool mSourceLoaded = false;
+    bool mPrepared     = false;
 };
 
 #endif // !PROGRAM_H
@@ -5,6 +5,7 @@
 //
 #include "ResourceHelper.h"
 
+#include <algorithm>
 #include <sstream>
 
 #ifdef _WIN32
@@ -21,6 +22,8 @@ const std::string slash = "/";
 
 static const char *shaderFolder   = "shaders";
 static const char *resourceFolder = "assets";
+// Packed by "aquarium_bake --pack".
+static const char *assetPackFile = "aquarium.pack";
 
 const std::vector<std::string> skyBoxUrls = {
     "GlobeOuter_EM_positive_x.jpg", "GlobeOuter_EM_negative_x.jpg", "GlobeOuter_EM_positive_y.jpg",
@@ -57,6 +60,30 @@ ResourceHelper::ResourceHelper(const std::string &mBackendName, const std::strin
     std::ostringstream imageStream;
     imageStream << mPath << resourceFolder << slash;
     mImagePath = imageStream.str();
+
+    // Resources are read from files if there isn't a pack.
+    mAssetPack.open(mPath + assetPackFile);
+}
+
+Resource::Resource() : mFile(), mData(nullptr), mSize(0) {}
+
+bool Resource::open(const std::string &path)
+{
+    if (!mFile.open(path))
+    {
+        return false;
+    }
+
+    mData = mFile.data();
+    mSize = mFile.size();
+    return true;
+}
+
+void Resource::setView(const uint8_t *data, size_t size)
+{
+    mFile.close();
+    mData = data;
+    mSize = size;
 }
 
 void ResourceHelper::getSkyBoxUrls(std::vector<std::string> *skyUrls) const
@@ -78,6 +105,15 @@ std::string ResourceHelper::getModelPath(const std::string &modelName) const
     return modelPath;
 }
 
+// The binary mesh cache is written next to the JSON model file.
+std::string ResourceHelper::getMeshCachePath(const std::string &modelName) const
+{
+    std::ostringstream cacheStream;
+    cacheStream << mImagePath << modelName << ".mesh";
+    std::string cachePath = cacheStream.str();
+    return cachePath;
+}
+
 std::string ResourceHelper::getProgramPath() const
 {
     std::ostringstream programStream;
@@ -86,3 +122,35 @@ std::string ResourceHelper::getProgramPath() const
     std::string programPath = programStream.str();
     return programPath;
 }
+
+// Assets are packed by their paths relative to the root, with '/' separators.
+bool ResourceHelper::findPackedResource(const std::string &path,
+                                        const uint8_t **data,
+                                        size_t *size) const
+{
+    if (!mAssetPack.isOpen() || path.compare(0, mPath.size(), mPath) != 0)
+    {
+        return false;
+    }
+
+    // Program paths of some backends have an empty shader version folder.
+    std::string name = path.substr(mPath.size());
+    std::replace(name.begin(), name.end(), '\\', '/');
+    name.erase(std::unique(name.begin(), name.end(),
+                           [](char a, char b) { return a == '/' && b == '/'; }),
+               name.end());
+    return mAssetPack.find(name, data, size);
+}
+
+bool ResourceHelper::openResource(const std::string &path, Resource *resource) const
+{
+    const uint8_t *data;
+    size_t size;
+    if (findPackedResource(path, &data, &size))
+    {
+        resource->setView(data, size);
+        return true;
+    }
+
+    return resource->open(path);
+}
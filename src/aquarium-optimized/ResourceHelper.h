@@ -4,22 +4,57 @@
 // found in the LICENSE file.
 //
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "common/AssetPack.h"
+#include "common/MappedFile.h"
+
+// The content of a resource file, which is either a view of a blob of the asset pack or the
+// file mapped by itself.
+class Resource
+{
+  public:
+    Resource();
+    // Map the file at path by itself.
+    bool open(const std::string &path);
+    // Point to memory which outlives the resource.
+    void setView(const uint8_t *data, size_t size);
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+
+  private:
+    MappedFile mFile;
+    const uint8_t *mData;
+    size_t mSize;
+};
+
 class ResourceHelper
 {
   public:
     ResourceHelper() {}
+    // Mount the asset pack at the root if there is one, so resources are read from the pack
+    // instead of opening every file.
     ResourceHelper(const std::string &mBackendName, const std::string &mShaderVersion);
     void getSkyBoxUrls(std::vector<std::string> *skyUrls) const;
     const std::string &getPropPlacementPath() const { return mPropPlacementPath; }
     const std::string &getImagePath() const { return mImagePath; }
     std::string getModelPath(const std::string &modelName) const;
+    std::string getMeshCachePath(const std::string &modelName) const;
     std::string getProgramPath() const;
     const std::string& getBackendName() const { return mBackendName; }
     const std::string& getShaderVersion() const { return mShaderVersion; }
 
+    bool hasAssetPack() const { return mAssetPack.isOpen(); }
+    // Find the blob of a resource in the asset pack, by the path returned by the getters above.
+    // The blob lives as long as the helper.
+    bool findPackedResource(const std::string &path, const uint8_t **data, size_t *size) const;
+    // Read a resource by the path returned by the getters above, from the asset pack if the pack
+    // has it, or from the file otherwise. It's safe to call on several threads.
+    bool openResource(const std::string &path, Resource *resource) const;
+
   private:
     std::string mPath;
     std::string mImagePath;
@@ -27,4 +62,5 @@ class ResourceHelper
     std::string mPropPlacementPath;
     std::string mBackendName;
     std::string mShaderVersion;
+    AssetPack mAssetPack;
 };
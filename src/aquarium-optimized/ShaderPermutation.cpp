@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderPermutation.cpp: Implement the permutation keys of programs.
+
+#include "ShaderPermutation.h"
+
+namespace {
+
+const struct
+{
+    SHADERFEATURE feature;
+    const char *name;
+} kFeatureNames[] = {
+    {FEATUREFOG, "fog"},
+    {FEATURENORMALMAP, "normalMap"},
+    {FEATUREREFLECTION, "reflection"},
+    {FEATUREINSTANCING, "instancing"},
+    {FEATUREFISHBEND, "fishBend"},
+    {FEATURESWAY, "sway"},
+    {FEATUREREFRACTION, "refraction"},
+    {FEATURETEXTUREARRAYS, "textureArrays"},
+};
+
+}  // namespace
+
+void getShaderFiles(uint32_t key, std::string *vsId, std::string *fsId)
+{
+    if (key & FEATUREFISHBEND)
+    {
+        if (key & FEATURETEXTUREARRAYS)
+        {
+            *vsId = "fishVertexShaderTextureArrays";
+        }
+        else if (key & FEATUREINSTANCING)
+        {
+            *vsId = "fishVertexShaderInstancedDraws";
+        }
+        else
+        {
+            *vsId = "fishVertexShader";
+        }
+        *fsId = (key & FEATUREREFLECTION) ? "fishReflectionFragmentShader"
+                                          : "fishNormalMapFragmentShader";
+        if (key & FEATURETEXTUREARRAYS)
+        {
+            *fsId += "TextureArrays";
+        }
+    }
+    else if (key & FEATURESWAY)
+    {
+        *vsId = "seaweedVertexShader";
+        *fsId = "seaweedFragmentShader";
+    }
+    else if (key & FEATUREREFRACTION)
+    {
+        *vsId = "innerRefractionMapVertexShader";
+        *fsId = "innerRefractionMapFragmentShader";
+    }
+    else if (key & FEATUREREFLECTION)
+    {
+        *vsId = "reflectionMapVertexShader";
+        *fsId = "reflectionMapFragmentShader";
+    }
+    else if (key & FEATURENORMALMAP)
+    {
+        *vsId = "normalMapVertexShader";
+        *fsId = "normalMapFragmentShader";
+    }
+    else
+    {
+        *vsId = "diffuseVertexShader";
+        *fsId = "diffuseFragmentShader";
+    }
+}
+
+ShaderVariant getShaderVariant(uint32_t key)
+{
+    ShaderVariant variant;
+    variant.removedTags.push_back((key & FEATURENORMALMAP) ? "noNormalMap" : "normalMap");
+    variant.removedTags.push_back((key & FEATUREREFLECTION) ? "noReflection" : "reflection");
+    return variant;
+}
+
+std::string getShaderFeatureNames(uint32_t key)
+{
+    std::string names;
+    for (const auto &feature : kFeatureNames)
+    {
+        if (key & feature.feature)
+        {
+            names += (names.empty() ? "" : "+") + std::string(feature.name);
+        }
+    }
+    return names.empty() ? "none" : names;
+}
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderPermutation.h: Define the permutation keys of programs. A key is a bitmask of the
+// features of a program, which selects its shader files and the tags masked out of them. Programs
+// are created once per key.
+
+#pragma once
+#ifndef SHADER_PERMUTATION_H
+#define SHADER_PERMUTATION_H 1
+
+#include <cstdint>
+#include <string>
+
+#include "common/ShaderPreprocessor.h"
+
+enum SHADERFEATURE : uint32_t
+{
+    FEATUREFOG           = 1 << 0,
+    FEATURENORMALMAP     = 1 << 1,
+    FEATUREREFLECTION    = 1 << 2,
+    FEATUREINSTANCING    = 1 << 3,  // Fish drawn by instanced draws.
+    FEATUREFISHBEND      = 1 << 4,  // Fish bend their bodies as they swim.
+    FEATURESWAY          = 1 << 5,  // Seaweed sways.
+    FEATUREREFRACTION    = 1 << 6,  // The inner tank refracts the skybox.
+    FEATURETEXTUREARRAYS = 1 << 7,  // Instanced fish sample their layers of texture arrays.
+};
+
+// The shader files of the program of key, relative to the program path.
+void getShaderFiles(uint32_t key, std::string *vsId, std::string *fsId);
+
+// Mask out the lines of the features which aren't in key. Backends add the substitutions of their
+// own, such as the fog code of OpenGL.
+ShaderVariant getShaderVariant(uint32_t key);
+
+// Readable features of key, such as "fog+normalMap", for logs.
+std::string getShaderFeatureNames(uint32_t key);
+
+#endif  // !SHADER_PERMUTATION_H
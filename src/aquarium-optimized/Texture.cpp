@@ -8,45 +8,398 @@
 #include "Texture.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <string>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AQUARIUM_MIPMAP_SSE2 1
+#endif
+
 #include "../common/AQUARIUM_ASSERT.h"
+#include "Mesh.h"
+#include "ResourceHelper.h"
+#include "TextureCache.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include "stb_image.h"
 #include "stb_image_resize.h"
 
+namespace {
+
+// Swap the rows in place, so no scratch row is allocated per image.
+void flipImageVertically(uint8_t *pixels, int width, int height)
+{
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+    {
+        uint8_t *topRow = pixels + top * rowSize;
+        std::swap_ranges(topRow, topRow + rowSize, pixels + bottom * rowSize);
+    }
+}
+
+// Force loading 3 channel images to 4 channel by stb becasue Dawn doesn't support 3 channel
+// formats currently. The group is discussing on whether webgpu shoud support 3 channel format.
+// https://github.com/gpuweb/gpuweb/issues/66#issuecomment-410021505
+// Images are flipped after decoding instead of by stbi_set_flip_vertically_on_load(), which is
+// a global state of stb and races when images are decoded on several threads. Only the
+// arguments are touched, so it's reentrant.
+uint8_t *decodeRGBA(const ResourceHelper *resourceHelper,
+                    const std::string &url,
+                    bool flip,
+                    int *width,
+                    int *height)
+{
+    Resource resource;
+    if (!resourceHelper->openResource(url, &resource))
+    {
+        return nullptr;
+    }
+
+    uint8_t *pixels = stbi_load_from_memory(resource.data(), static_cast<int>(resource.size()),
+                                            width, height, 0, 4);
+    if (pixels != nullptr && flip)
+    {
+        flipImageVertically(pixels, *width, *height);
+    }
+    return pixels;
+}
+
+
+struct MipLevel
+{
+    int width;
+    int height;
+    size_t rowPitch;
+    size_t offset;
+};
+
+// Levels are aligned in the chain, so rows of each level start on a vector boundary when the
+// row pitch is a multiple of it.
+size_t alignMipLevel(size_t offset)
+{
+    return (offset + 15) & ~static_cast<size_t>(15);
+}
+
+// Average 2x2 blocks of texels of row0 and row1 into dst. The second column is clamped to the
+// edge, so the last column of an odd width is dropped, and a 1 texel wide level is only
+// filtered vertically.
+void downsampleRow(const uint8_t *row0, const uint8_t *row1, int srcWidth, uint8_t *dst,
+                   int dstWidth)
+{
+    int x = 0;
+#if defined(AQUARIUM_MIPMAP_SSE2)
+    const __m128i zero     = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(2);
+    // 2 texels of dst from 4 texels of each source row.
+    for (; x + 1 < dstWidth && 2 * x + 3 < srcWidth; x += 2)
+    {
+        __m128i top    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 8 * x));
+        __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 8 * x));
+        // 16-bit sums of the columns, texels 0 and 1 in low, 2 and 3 in high.
+        __m128i low  = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+        // Add the even columns to the odd ones.
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+        sum         = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 4 * x), _mm_packus_epi16(sum, sum));
+    }
+#endif
+    for (; x < dstWidth; ++x)
+    {
+        int x0 = 4 * (2 * x);
+        int x1 = 4 * std::min(2 * x + 1, srcWidth - 1);
+        for (int c = 0; c < 4; ++c)
+        {
+            int sum        = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+            dst[4 * x + c] = static_cast<uint8_t>((sum + 2) >> 2);
+        }
+    }
+}
+
+// Tables to convert 8-bit sRGB values to linear floats, and 12-bit linear values back to sRGB.
+struct GammaTables
+{
+    GammaTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float value = i / 255.0f;
+            toLinear[i] = value <= 0.04045f ? value / 12.92f
+                                             : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 4096; ++i)
+        {
+            float value = i / 4095.0f;
+            float srgb  = value <= 0.0031308f ? value * 12.92f
+                                              : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+            toSrgb[i]   = static_cast<uint8_t>(srgb * 255.0f + 0.5f);
+        }
+    }
+
+    float toLinear[256];
+    uint8_t toSrgb[4096];
+};
+
+// Same as downsampleRow, but colors are averaged in linear space. Alpha is linear already.
+void downsampleRowGammaCorrect(const uint8_t *row0, const uint8_t *row1, int srcWidth,
+                               uint8_t *dst, int dstWidth)
+{
+    static const GammaTables tables;
+    for (int x = 0; x < dstWidth; ++x)
+    {
+        int x0 = 4 * (2 * x);
+        int x1 = 4 * std::min(2 * x + 1, srcWidth - 1);
+        for (int c = 0; c < 3; ++c)
+        {
+            float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+                        tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+            dst[4 * x + c] = tables.toSrgb[static_cast<int>(sum * (4095.0f / 4.0f) + 0.5f)];
+        }
+        int alpha      = row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3];
+        dst[4 * x + 3] = static_cast<uint8_t>((alpha + 2) >> 2);
+    }
+}
+
+}  // namespace
+
 Texture::Texture(const std::string &name, const std::string &url, bool flip)
     : mUrls(),
+    mDecodedPixels(1, nullptr),
+    mImageSizes(1),
     mWidth(0),
     mHeight(0),
     mFlip(flip),
-    mName(name)
+    mGenerateMipmaps(false),
+    mIs256Padding(false),
+    mStreamed(false),
+    mResidentMip(-1),
+    mName(name),
+    mLevelCount(0),
+    mCache(nullptr),
+    mSourceHash(0),
+    mHasSourceHash(false)
 {
     std::string urlpath = url;
     mUrls.push_back(urlpath);
 }
 
-// Force loading 3 channel images to 4 channel by stb becasue Dawn doesn't support 3 channel
-// formats currently. The group is discussing on whether webgpu shoud support 3 channel format.
-// https://github.com/gpuweb/gpuweb/issues/66#issuecomment-410021505
-bool Texture::loadImage(const std::vector<std::string> &urls, std::vector<uint8_t *>* pixels)
+Texture::~Texture()
+{
+    releaseLevels();
+}
+
+uint32_t Texture::getCacheFlags() const
 {
-    stbi_set_flip_vertically_on_load(mFlip);
-    for (auto filename : urls) {
-        uint8_t *pixel = stbi_load(filename.c_str(), &mWidth, &mHeight, 0, 4);
-        if (pixel == 0)
+    uint32_t flags = 0;
+    if (mFlip)
+    {
+        flags |= TEXTURE_CACHE_FLIPPED;
+    }
+    if (mIs256Padding)
+    {
+        flags |= TEXTURE_CACHE_PADDED_ROWS;
+    }
+    if (isMipmapped())
+    {
+        flags |= TEXTURE_CACHE_MIPMAPPED;
+    }
+    return flags;
+}
+
+bool Texture::hashSources(const ResourceHelper *resourceHelper)
+{
+    uint64_t hash = kHashSeed;
+    for (const auto &url : mUrls)
+    {
+        Resource resource;
+        if (!resourceHelper->openResource(url, &resource))
         {
-            std::cout << stderr << "Couldn't open input file" << filename << std::endl;
             return false;
         }
-        pixels->push_back(pixel);
+        hash = hashData(resource.data(), resource.size(), hash);
     }
+
+    mSourceHash    = hash;
+    mHasSourceHash = true;
     return true;
 }
 
+bool Texture::loadCache(const ResourceHelper *resourceHelper)
+{
+    if (!mHasSourceHash && !hashSources(resourceHelper))
+    {
+        return false;
+    }
+
+    Resource *cache = new Resource();
+    std::vector<const uint8_t *> levels;
+    int width;
+    int height;
+    int levelCount;
+    if (!resourceHelper->openResource(getTextureCachePath(mUrls, getCacheFlags()), cache) ||
+        !parseTextureCache(cache->data(), cache->size(), mSourceHash, getCacheFlags(),
+                           static_cast<uint32_t>(mUrls.size()), &width, &height, &levelCount,
+                           &levels))
+    {
+        delete cache;
+        return false;
+    }
+
+    mCache = cache;
+    mLevels.swap(levels);
+    mLevelCount = levelCount;
+    mWidth      = width;
+    mHeight     = height;
+    return true;
+}
+
+bool Texture::decodeImage(const ResourceHelper *resourceHelper, size_t index)
+{
+    int width;
+    int height;
+    uint8_t *pixels = decodeRGBA(resourceHelper, mUrls[index], mFlip, &width, &height);
+    if (pixels == nullptr)
+    {
+        return false;
+    }
+
+    // Other images may be decoded on other threads at the same time, so the size of the texture
+    // is set by loadImage().
+    mImageSizes[index]    = std::make_pair(width, height);
+    mDecodedPixels[index] = pixels;
+    return true;
+}
+
+bool Texture::loadImage(const ResourceHelper *resourceHelper)
+{
+    for (size_t i = 0; i < mUrls.size(); ++i)
+    {
+        if (mDecodedPixels[i] != nullptr)
+        {
+            continue;
+        }
+
+        int width;
+        int height;
+        mDecodedPixels[i] = decodeRGBA(resourceHelper, mUrls[i], mFlip, &width, &height);
+        if (mDecodedPixels[i] == nullptr)
+        {
+            std::cout << stderr << "Couldn't open input file" << mUrls[i] << std::endl;
+            return false;
+        }
+        mImageSizes[i] = std::make_pair(width, height);
+    }
+
+    mWidth  = 0;
+    mHeight = 0;
+    for (const auto &size : mImageSizes)
+    {
+        mWidth  = std::max(mWidth, size.first);
+        mHeight = std::max(mHeight, size.second);
+    }
+    return true;
+}
+
+bool Texture::prepareLevels(const ResourceHelper *resourceHelper)
+{
+    if (!mLevels.empty())
+    {
+        return true;
+    }
+    if (!loadImage(resourceHelper))
+    {
+        return false;
+    }
+
+    size_t rowSize  = static_cast<size_t>(mWidth) * 4;
+    size_t rowPitch = getMipmapRowPitch(mWidth, mIs256Padding);
+    mLevelStorage.resize(mUrls.size());
+    if (isMipmapped())
+    {
+        for (size_t i = 0; i < mDecodedPixels.size(); ++i)
+        {
+            std::vector<uint8_t *> levels;
+            generateMipmap(mDecodedPixels[i], mImageSizes[i].first, mImageSizes[i].second,
+                           &mLevelStorage[i], levels, mWidth, mHeight, mIs256Padding);
+            mLevels.insert(mLevels.end(), levels.begin(), levels.end());
+        }
+        DestoryImageData(mDecodedPixels);
+    }
+    else if (rowPitch == rowSize)
+    {
+        // The decoded images are uploaded as they are.
+        for (size_t i = 0; i < mImageSizes.size(); ++i)
+        {
+            ASSERT(mImageSizes[i].first == mWidth && mImageSizes[i].second == mHeight);
+        }
+        mLevels.assign(mDecodedPixels.begin(), mDecodedPixels.end());
+    }
+    else
+    {
+        for (size_t i = 0; i < mDecodedPixels.size(); ++i)
+        {
+            ASSERT(mImageSizes[i].first == mWidth && mImageSizes[i].second == mHeight);
+            mLevelStorage[i].resize(rowPitch * mHeight);
+            uint8_t *level = mLevelStorage[i].data();
+            for (int y = 0; y < mHeight; ++y)
+            {
+                memcpy(level + y * rowPitch, mDecodedPixels[i] + y * rowSize, rowSize);
+            }
+            mLevels.push_back(level);
+        }
+        DestoryImageData(mDecodedPixels);
+    }
+    mLevelCount = static_cast<int>(mLevels.size() / mUrls.size());
+
+    // The asset folder may be read only, the cache is only an optimization for the next
+    // launch.
+    if (mHasSourceHash || hashSources(resourceHelper))
+    {
+        writeTextureCache(getTextureCachePath(mUrls, getCacheFlags()), mSourceHash,
+                          getCacheFlags(), mWidth, mHeight, static_cast<uint32_t>(mUrls.size()),
+                          mLevelCount, mLevels);
+    }
+
+    return true;
+}
+
+void Texture::releaseLevels()
+{
+    mLevels.clear();
+    mLevelCount = 0;
+    std::vector<std::vector<uint8_t>>().swap(mLevelStorage);
+    DestoryImageData(mDecodedPixels);
+    delete mCache;
+    mCache = nullptr;
+}
+
+void Texture::getPlaceholderPixel(uint8_t *pixel) const
+{
+    bool isNormalMap = mName == "normalMap";
+    pixel[0]         = 128;
+    pixel[1]         = 128;
+    pixel[2]         = isNormalMap ? 255 : 128;
+    pixel[3]         = 255;
+}
+
+// Small enough to load every texture of the scene quickly, the streamer refines the textures of
+// the models on screen in the next frames.
+int Texture::getInitialStreamedMip() const
+{
+    constexpr int kInitialStreamedSize = 64;
+
+    int mip = 0;
+    for (int size = std::max(mWidth, mHeight); size > kInitialStreamedSize; size /= 2)
+    {
+        ++mip;
+    }
+    return mip;
+}
+
 bool Texture::isPowerOf2(int value)
 {
     return (value & (value - 1)) == 0;
@@ -62,70 +415,93 @@ void Texture::DestoryImageData(std::vector<uint8_t*>& pixelVec)
     }
 }
 
-void Texture::copyPaddingBuffer(unsigned char *dst, unsigned char *src, int width, int height, int kPadding)
+size_t Texture::getMipmapRowPitch(int width, bool is256padding)
 {
-    unsigned char *s = src;
-    unsigned char *d = dst;
-    for(int i = 0; i < height; ++i)
-    {
-        memcpy(d, s, width * 4);
-        s += width * 4;
-        d += kPadding * 4;
-    }
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    return is256padding ? (rowSize + 255) & ~static_cast<size_t>(255) : rowSize;
 }
 
-void Texture::generateMipmap(uint8_t *input_pixels,
+void Texture::generateMipmap(const uint8_t *input_pixels,
                              int input_w,
                              int input_h,
-                             int input_stride_in_bytes,
+                             std::vector<uint8_t> *storage,
                              std::vector<uint8_t *> &output_pixels,
                              int output_w,
                              int output_h,
-                             int output_stride_in_bytes,
-                             int num_channels,
-                             bool is256padding)
+                             bool is256padding,
+                             bool gammaCorrect)
 {
-    int mipmapLevel =
-        static_cast<uint32_t>(floor(log2(std::max(output_w, output_h)))) + 1;
-    output_pixels.resize(mipmapLevel);
-    int height      = output_h;
-    int width  = output_w;
+    // Lay out all of the levels first, so the chain is a single allocation.
+    std::vector<MipLevel> levels;
+    size_t size = 0;
+    int width   = output_w;
+    int height  = output_h;
+    while (true)
+    {
+        MipLevel level;
+        level.width    = width;
+        level.height   = height;
+        level.rowPitch = getMipmapRowPitch(width, is256padding);
+        level.offset   = size;
+        levels.push_back(level);
+
+        size = alignMipLevel(size + level.rowPitch * height);
+        if (width == 1 && height == 1)
+        {
+            break;
+        }
+        width  = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
 
-    if (!is256padding)
+    storage->resize(size);
+    uint8_t *base = storage->data();
+    output_pixels.resize(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i)
     {
-        for (int i = 0; i < mipmapLevel; ++i)
+        output_pixels[i] = base + levels[i].offset;
+    }
+
+    const MipLevel &baseLevel = levels[0];
+    if (input_w == output_w && input_h == output_h)
+    {
+        size_t inputRowSize = static_cast<size_t>(input_w) * 4;
+        for (int y = 0; y < input_h; ++y)
         {
-            output_pixels[i] = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
-            stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes,
-                               output_pixels[i], width, height, output_stride_in_bytes,
-                               num_channels);
-
-            height >>= 1;
-            width >>= 1;
-            if (height == 0)
-            {
-                height = 1;
-            }
+            memcpy(output_pixels[0] + y * baseLevel.rowPitch, input_pixels + y * inputRowSize,
+                   inputRowSize);
         }
     }
     else
     {
-        uint8_t *pixels = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
+        stbir_resize_uint8(input_pixels, input_w, input_h, 0, output_pixels[0], output_w,
+                           output_h, static_cast<int>(baseLevel.rowPitch), 4);
+    }
 
-        for (int i = 0; i < mipmapLevel; ++i)
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        const MipLevel &src      = levels[i - 1];
+        const MipLevel &dst      = levels[i];
+        const uint8_t *srcPixels = output_pixels[i - 1];
+        uint8_t *dstPixels       = output_pixels[i];
+
+        // Textures are filtered in parallel by the loader workers, so the rows of a level are
+        // filtered on the calling thread.
+        for (int y = 0; y < dst.height; ++y)
         {
-            output_pixels[i] = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
-            stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes, pixels, width,
-                               height, output_stride_in_bytes, num_channels);
-            copyPaddingBuffer(output_pixels[i], pixels, width, height, output_w);
-
-            height >>= 1;
-            width >>= 1;
-            if (height == 0)
+            // The second row is clamped to the edge like the columns.
+            int y1              = std::min(2 * y + 1, src.height - 1);
+            const uint8_t *row0 = srcPixels + 2 * y * src.rowPitch;
+            const uint8_t *row1 = srcPixels + y1 * src.rowPitch;
+            uint8_t *dstRow     = dstPixels + y * dst.rowPitch;
+            if (gammaCorrect)
+            {
+                downsampleRowGammaCorrect(row0, row1, src.width, dstRow, dst.width);
+            }
+            else
             {
-                height = 1;
+                downsampleRow(row0, row1, src.width, dstRow, dst.width);
             }
         }
-        free(pixels);
     }
 }
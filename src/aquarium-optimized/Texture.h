@@ -9,45 +9,136 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H 1
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+class Resource;
+class ResourceHelper;
+
 class Texture
 {
   public:
-    virtual ~Texture(){}
+    virtual ~Texture();
     Texture() {}
-    Texture(const std::string &name, const std::vector<std::string> &urls, bool flip) : mUrls(urls), mFlip(flip), mName(name) {}
+    Texture(const std::string &name, const std::vector<std::string> &urls, bool flip)
+        : mUrls(urls), mDecodedPixels(urls.size(), nullptr), mImageSizes(urls.size()), mWidth(0),
+          mHeight(0), mFlip(flip), mGenerateMipmaps(false), mIs256Padding(false), mStreamed(false),
+          mResidentMip(-1), mName(name), mLevelCount(0), mCache(nullptr), mSourceHash(0),
+          mHasSourceHash(false)
+    {
+    }
     Texture(const std::string &name, const std::string &url, bool flip);
     std::string getName() { return mName; }
+    // Count of image files, such as 6 faces of a cubemap or the layers of an array.
+    size_t getImageCount() const { return mUrls.size(); }
+    const std::vector<std::string> &getUrls() const { return mUrls; }
+    // Map the texture cache if it's built from the current image files with the layout of the
+    // backend. Return true if it's valid, then the images don't need to be decoded. Safe to call
+    // on a worker thread. The files are read through resourceHelper, which serves them from the
+    // asset pack.
+    bool loadCache(const ResourceHelper *resourceHelper);
+    // Decode the image file at index without touching the backend, so it's safe to call on a
+    // worker thread, and for different indexes on several threads at the same time.
+    bool decodeImage(const ResourceHelper *resourceHelper, size_t index);
+    // Lay out the decoded images as the levels to upload, decoding the missing ones and
+    // generating the mip chains, then write the texture cache for the next launch. Nothing is
+    // done if the levels are loaded from the cache. Safe to call on a worker thread.
+    // loadTexture() calls it if it hasn't been called.
+    bool prepareLevels(const ResourceHelper *resourceHelper);
+    // Create the backend texture. Must be called on the render thread.
     virtual void loadTexture() = 0;
-    void generateMipmap(uint8_t *input_pixels,
+    // Create the backend texture with a 1x1 placeholder, which is replaced by loadTexture()
+    // later. Backends advertising progressive loading implement it.
+    virtual void loadPlaceholder() {}
+
+    // A streamed texture generates its mip chain on the CPU, and keeps only the levels from its
+    // resident mip on the GPU. The levels are prepared again from the texture cache to refine or
+    // evict them. Must be set before the texture is loaded.
+    void setStreamed()
+    {
+        mStreamed        = true;
+        mGenerateMipmaps = true;
+    }
+    bool isStreamed() const { return mStreamed; }
+    // The finest mip on the GPU, or -1 until the texture is loaded.
+    int getResidentMip() const { return mResidentMip; }
+    // Replace the levels on the GPU by the levels from mip down to 1x1, preparing them if they
+    // aren't prepared. Must be called on the render thread. Backends advertising texture
+    // streaming implement it.
+    virtual void loadMips(int mip) {}
+    int getWidth() const { return mWidth; }
+    int getHeight() const { return mHeight; }
+    // Generate the mip chain of an RGBA8 image down to 1x1. The base level is output_w x
+    // output_h, and is resized from the input only if the sizes differ. Each of the other levels
+    // is box filtered from the previous one. All of the levels are written into one allocation
+    // in storage, and output_pixels points to each of them. Rows of a level are
+    // getMipmapRowPitch() bytes apart. With gammaCorrect, colors are averaged in linear space
+    // instead of as sRGB values.
+    void generateMipmap(const uint8_t *input_pixels,
                         int input_w,
                         int input_h,
-                        int input_stride_in_bytes,
+                        std::vector<uint8_t> *storage,
                         std::vector<uint8_t *> &output_pixels,
                         int output_w,
                         int output_h,
-                        int output_stride_in_bytes,
-                        int num_channels,
-                        bool is256padding);
+                        bool is256padding,
+                        bool gammaCorrect = false);
+    // With is256padding, rows are padded to multiples of 256 bytes, which is the row pitch
+    // alignment of buffer to texture copies on Dawn. Otherwise they are tightly packed.
+    static size_t getMipmapRowPitch(int width, bool is256padding);
 
   protected:
     bool isPowerOf2(int);
-    bool loadImage(const std::vector<std::string> &urls, std::vector<uint8_t *>* pixels);
+    // The mip a streamed texture is loaded with, before the streamer has seen its models.
+    int getInitialStreamedMip() const;
+    // A flat normal for normal maps, or gray for the others.
+    void getPlaceholderPixel(uint8_t *pixel) const;
+    // Decode the images which aren't decoded by decodeImage() yet. The texture is as large as
+    // the largest image.
+    bool loadImage(const ResourceHelper *resourceHelper);
     void DestoryImageData(std::vector<uint8_t *>& pixelVec);
-    void copyPaddingBuffer(unsigned char *dst,
-                           unsigned char *src,
-                           int width,
-                           int height,
-                           int kPadding);
+    // The levels of all of the layers, layer major. Rows of a level are getMipmapRowPitch()
+    // bytes apart. Valid from prepareLevels() until releaseLevels().
+    const std::vector<const uint8_t *> &getLevels() const { return mLevels; }
+    const uint8_t *getLevel(size_t layer, int level) const
+    {
+        return mLevels[layer * mLevelCount + level];
+    }
+    int getLevelCount() const { return mLevelCount; }
+    // Free the images and the levels once they are uploaded.
+    void releaseLevels();
 
     std::vector<std::string> mUrls;
+    std::vector<uint8_t *> mDecodedPixels;
+    std::vector<std::pair<int, int>> mImageSizes;  // Width and height of each decoded image.
     int mWidth;
     int mHeight;
     bool mFlip;
+    // Set by backends. Whether a mip chain of each layer is generated on the CPU, and whether
+    // rows of levels are padded to 256 bytes. The layers of a mipmapped texture are resized to
+    // its size if they are smaller, while the faces of a cubemap must have the same size.
+    bool mGenerateMipmaps;
+    bool mIs256Padding;
+    bool mStreamed;
+    int mResidentMip;
 
     std::string mName;
+
+  private:
+    bool isMipmapped() const { return mGenerateMipmaps; }
+    uint32_t getCacheFlags() const;
+    bool hashSources(const ResourceHelper *resourceHelper);
+
+    std::vector<const uint8_t *> mLevels;
+    int mLevelCount;
+    // Backing storage of the levels of each layer, unless they point into the decoded images or
+    // the cache.
+    std::vector<std::vector<uint8_t>> mLevelStorage;
+    Resource *mCache;
+    uint64_t mSourceHash;  // Of the image files.
+    bool mHasSourceHash;
 };
 
 #endif // !TEXTURE_H
@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureCache.cpp: Implement reading and writing of texture caches.
+
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "Texture.h"
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Count of levels of a chain down to 1x1, the same as Texture::generateMipmap().
+int getChainLength(int width, int height)
+{
+    int levelCount = 1;
+    while (width > 1 || height > 1)
+    {
+        width  = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+uint64_t getLevelSize(int width, int height, int level, uint32_t flags)
+{
+    int levelWidth  = std::max(width >> level, 1);
+    int levelHeight = std::max(height >> level, 1);
+    size_t rowPitch =
+        Texture::getMipmapRowPitch(levelWidth, (flags & TEXTURE_CACHE_PADDED_ROWS) != 0);
+    return static_cast<uint64_t>(rowPitch) * levelHeight;
+}
+
+}  // namespace
+
+std::string getTextureCachePath(const std::vector<std::string> &urls, uint32_t flags)
+{
+    std::string path = urls[0];
+    if (urls.size() > 1)
+    {
+        path += ".layers";
+    }
+    if (flags & TEXTURE_CACHE_FLIPPED)
+    {
+        path += ".flip";
+    }
+    if (flags & TEXTURE_CACHE_PADDED_ROWS)
+    {
+        path += ".pad256";
+    }
+    if (flags & TEXTURE_CACHE_MIPMAPPED)
+    {
+        path += ".mips";
+    }
+    return path + ".tex";
+}
+
+bool parseTextureCache(const uint8_t *data,
+                       size_t size,
+                       uint64_t sourceHash,
+                       uint32_t flags,
+                       uint32_t layerCount,
+                       int *width,
+                       int *height,
+                       int *levelCount,
+                       std::vector<const uint8_t *> *levels)
+{
+    if (size < sizeof(TextureCacheHeader))
+    {
+        return false;
+    }
+
+    TextureCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kTextureCacheMagic, sizeof(kTextureCacheMagic)) != 0 ||
+        header.version != kTextureCacheVersion || header.sourceHash != sourceHash ||
+        header.fileSize != size || header.flags != flags || header.layerCount != layerCount ||
+        header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+    {
+        return false;
+    }
+
+    int cacheWidth  = static_cast<int>(header.width);
+    int cacheHeight = static_cast<int>(header.height);
+    int chainLength = (flags & TEXTURE_CACHE_MIPMAPPED) ? getChainLength(cacheWidth, cacheHeight)
+                                                        : 1;
+    uint64_t entryCount = static_cast<uint64_t>(layerCount) * chainLength;
+    uint64_t tableEnd   = sizeof(TextureCacheHeader) + entryCount * sizeof(TextureCacheLevel);
+    if (header.levelCount != static_cast<uint32_t>(chainLength) || tableEnd > size)
+    {
+        return false;
+    }
+
+    const auto *entries = reinterpret_cast<const TextureCacheLevel *>(data + sizeof(header));
+    levels->clear();
+    for (uint32_t layer = 0; layer < layerCount; ++layer)
+    {
+        for (int level = 0; level < chainLength; ++level)
+        {
+            const TextureCacheLevel &entry = entries[layer * chainLength + level];
+            if (entry.offset % kTextureCacheLevelAlignment != 0 || entry.offset < tableEnd ||
+                entry.offset > size ||
+                entry.size != getLevelSize(cacheWidth, cacheHeight, level, flags) ||
+                entry.size > size - entry.offset)
+            {
+                levels->clear();
+                return false;
+            }
+            levels->push_back(data + entry.offset);
+        }
+    }
+
+    *width      = cacheWidth;
+    *height     = cacheHeight;
+    *levelCount = chainLength;
+
+    return true;
+}
+
+bool writeTextureCache(const std::string &path,
+                       uint64_t sourceHash,
+                       uint32_t flags,
+                       int width,
+                       int height,
+                       uint32_t layerCount,
+                       int levelCount,
+                       const std::vector<const uint8_t *> &levels)
+{
+    TextureCacheHeader header;
+    memcpy(header.magic, kTextureCacheMagic, sizeof(kTextureCacheMagic));
+    header.version    = kTextureCacheVersion;
+    header.sourceHash = sourceHash;
+    header.flags      = flags;
+    header.width      = static_cast<uint32_t>(width);
+    header.height     = static_cast<uint32_t>(height);
+    header.layerCount = layerCount;
+    header.levelCount = static_cast<uint32_t>(levelCount);
+    header.reserved   = 0;
+
+    std::vector<TextureCacheLevel> entries(levels.size());
+    uint64_t offset = sizeof(TextureCacheHeader) + entries.size() * sizeof(TextureCacheLevel);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        offset            = alignUp(offset, kTextureCacheLevelAlignment);
+        entries[i].offset = offset;
+        entries[i].size   = getLevelSize(width, height, static_cast<int>(i % levelCount), flags);
+        offset += entries[i].size;
+    }
+    header.fileSize = offset;
+
+    // Write to a temporary file first, so a reader never maps a partially written cache.
+    std::string tempPath = path + ".tmp";
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.good())
+    {
+        return false;
+    }
+
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(entries.data()),
+                 entries.size() * sizeof(TextureCacheLevel));
+
+    uint64_t written = sizeof(TextureCacheHeader) + entries.size() * sizeof(TextureCacheLevel);
+    const char padding[kTextureCacheLevelAlignment] = {};
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        stream.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+        stream.write(reinterpret_cast<const char *>(levels[i]),
+                     static_cast<std::streamsize>(entries[i].size));
+        written = entries[i].offset + entries[i].size;
+    }
+    stream.close();
+
+    if (stream.fail())
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureCache.h: Define the texture cache, which stores the RGBA8 levels of a texture ready to
+// upload, so a warm start neither decodes the images nor generates mip chains. It's a container
+// in the spirit of KTX2, laid out as below. All of the values are little endian.
+//   TextureCacheHeader
+//   TextureCacheLevel[layerCount * levelCount], layer major
+//   pixels of levels, each aligned to kTextureCacheLevelAlignment bytes
+// Rows of a level are Texture::getMipmapRowPitch() bytes apart, so the levels are uploaded
+// straight from the mapped pages.
+
+#pragma once
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr char kTextureCacheMagic[4]           = {'A', 'Q', 'T', 'X'};
+constexpr uint32_t kTextureCacheVersion        = 1;
+constexpr uint64_t kTextureCacheLevelAlignment = 256;
+
+// The layout of the levels, which is part of the key of a cache.
+enum TextureCacheFlags : uint32_t
+{
+    TEXTURE_CACHE_FLIPPED     = 1 << 0,
+    TEXTURE_CACHE_PADDED_ROWS = 1 << 1,  // Rows are padded to 256 bytes.
+    TEXTURE_CACHE_MIPMAPPED   = 1 << 2,  // Each layer has a full mip chain.
+};
+
+struct TextureCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layerCount;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct TextureCacheLevel
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+// The cache of the texture of the image files at urls, next to the first one. The flags are in
+// the name, so the variants of backends don't overwrite each other.
+std::string getTextureCachePath(const std::vector<std::string> &urls, uint32_t flags);
+
+// Validate a cache in memory, and point levels into it. Fail if the cache is corrupted, or is
+// not built from the source of sourceHash with flags and layerCount layers.
+bool parseTextureCache(const uint8_t *data,
+                       size_t size,
+                       uint64_t sourceHash,
+                       uint32_t flags,
+                       uint32_t layerCount,
+                       int *width,
+                       int *height,
+                       int *levelCount,
+                       std::vector<const uint8_t *> *levels);
+
+// Write the levels, layer major, into a cache at path.
+bool writeTextureCache(const std::string &path,
+                       uint64_t sourceHash,
+                       uint32_t flags,
+                       int width,
+                       int height,
+                       uint32_t layerCount,
+                       int levelCount,
+                       const std::vector<const uint8_t *> &levels);
+
+#endif  // !TEXTURE_CACHE_H
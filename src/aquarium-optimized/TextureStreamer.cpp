@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureStreamer.cpp: Implement the texture streamer.
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Model.h"
+#include "Texture.h"
+
+namespace {
+
+// Loads in flight at a time, so refining the whole scene doesn't stall a frame on uploads.
+constexpr int kMaxPendingLoads = 4;
+
+int getMipCount(int width, int height)
+{
+    int count = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2)
+    {
+        ++count;
+    }
+    return count;
+}
+
+// Bytes of the RGBA8 levels from mip down to 1x1.
+size_t getMipChainSize(int width, int height, int mip)
+{
+    int w = std::max(width >> mip, 1);
+    int h = std::max(height >> mip, 1);
+
+    size_t size = 0;
+    while (true)
+    {
+        size += static_cast<size_t>(w) * h * 4;
+        if (w == 1 && h == 1)
+        {
+            break;
+        }
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+    return size;
+}
+
+double toMB(size_t size)
+{
+    return size / (1024.0 * 1024.0);
+}
+
+}  // namespace
+
+TextureStreamer::TextureStreamer(const ResourceHelper *resourceHelper,
+                                 size_t budget,
+                                 int threadCount)
+    : mResourceHelper(resourceHelper), mTextures(), mStats(), mLoader(threadCount)
+{
+    mStats.budget = budget;
+}
+
+void TextureStreamer::addModel(const Model *model)
+{
+    for (const auto &entry : model->textureMap)
+    {
+        Texture *texture = entry.second;
+        if (texture == nullptr || !texture->isStreamed())
+        {
+            continue;
+        }
+
+        auto it = std::find_if(
+            mTextures.begin(), mTextures.end(),
+            [texture](const StreamedTexture &streamed) { return streamed.texture == texture; });
+        if (it == mTextures.end())
+        {
+            mTextures.push_back({texture, {}, 0, 0, 0, 0, 0, false});
+            it = mTextures.end() - 1;
+        }
+        it->models.push_back(model);
+    }
+    mStats.textureCount = static_cast<int>(mTextures.size());
+}
+
+void TextureStreamer::update(const float *viewProjection, float pixelsPerUnit)
+{
+    mLoader.poll();
+
+    for (StreamedTexture &streamed : mTextures)
+    {
+        if (streamed.width == 0)
+        {
+            if (streamed.texture->getResidentMip() < 0)
+            {
+                continue;
+            }
+            streamed.width    = streamed.texture->getWidth();
+            streamed.height   = streamed.texture->getHeight();
+            streamed.mipCount = getMipCount(streamed.width, streamed.height);
+        }
+        streamed.requiredMip = estimateRequiredMip(streamed, viewProjection, pixelsPerUnit);
+    }
+
+    fitBudget();
+
+    for (size_t i = 0; i < mTextures.size() && mStats.pendingLoads < kMaxPendingLoads; ++i)
+    {
+        StreamedTexture &streamed = mTextures[i];
+        if (streamed.width == 0 || streamed.loading ||
+            streamed.targetMip == streamed.texture->getResidentMip())
+        {
+            continue;
+        }
+
+        streamed.loading = true;
+        ++mStats.pendingLoads;
+
+        // The levels are mapped from the texture cache written by the first load, and are only
+        // decoded again if it's gone.
+        Texture *texture                     = streamed.texture;
+        const ResourceHelper *resourceHelper = mResourceHelper;
+        mLoader.submit(
+            [texture, resourceHelper]() {
+                if (!texture->loadCache(resourceHelper))
+                {
+                    texture->prepareLevels(resourceHelper);
+                }
+            },
+            [this, i]() {
+                StreamedTexture &streamed = mTextures[i];
+                int residentMip           = streamed.texture->getResidentMip();
+                if (streamed.targetMip < residentMip)
+                {
+                    ++mStats.loads;
+                }
+                else if (streamed.targetMip > residentMip)
+                {
+                    ++mStats.evictions;
+                }
+                streamed.texture->loadMips(streamed.targetMip);
+                streamed.loading = false;
+                --mStats.pendingLoads;
+            });
+    }
+
+    mStats.residentSize = 0;
+    for (const StreamedTexture &streamed : mTextures)
+    {
+        if (streamed.width != 0)
+        {
+            mStats.residentSize += getMipChainSize(streamed.width, streamed.height,
+                                                   streamed.texture->getResidentMip());
+        }
+    }
+}
+
+// The texture is assumed to be mapped once over its model, so the required mip is the coarsest
+// one with at least as many texels across as the model covers pixels on screen.
+int TextureStreamer::estimateRequiredMip(const StreamedTexture &streamed,
+                                         const float *viewProjection,
+                                         float pixelsPerUnit) const
+{
+    float diameter = 0.0f;
+    for (const Model *model : streamed.models)
+    {
+        if (model->worldBoundingSpheres.empty())
+        {
+            return 0;
+        }
+
+        for (const BoundingSphere &sphere : model->worldBoundingSpheres)
+        {
+            // w in clip space is the depth of the center, which is clamped to the near plane.
+            float w = sphere.center[0] * viewProjection[3] + sphere.center[1] * viewProjection[7] +
+                      sphere.center[2] * viewProjection[11] + viewProjection[15];
+            diameter =
+                std::max(diameter, 2.0f * sphere.radius * pixelsPerUnit / std::max(w, 1.0f));
+        }
+    }
+
+    int size = std::max(streamed.width, streamed.height);
+    int mip  = 0;
+    while (mip + 1 < streamed.mipCount && (size >> (mip + 1)) >= diameter)
+    {
+        ++mip;
+    }
+    return mip;
+}
+
+void TextureStreamer::fitBudget()
+{
+    size_t size = 0;
+    for (StreamedTexture &streamed : mTextures)
+    {
+        streamed.targetMip = streamed.requiredMip;
+        if (streamed.width != 0)
+        {
+            size += getMipChainSize(streamed.width, streamed.height, streamed.targetMip);
+        }
+    }
+    mStats.requiredSize = size;
+
+    while (size > mStats.budget)
+    {
+        StreamedTexture *coarsened = nullptr;
+        size_t saving              = 0;
+        for (StreamedTexture &streamed : mTextures)
+        {
+            if (streamed.width == 0 || streamed.targetMip + 1 >= streamed.mipCount)
+            {
+                continue;
+            }
+
+            size_t levelSize =
+                getMipChainSize(streamed.width, streamed.height, streamed.targetMip) -
+                getMipChainSize(streamed.width, streamed.height, streamed.targetMip + 1);
+            if (levelSize > saving)
+            {
+                coarsened = &streamed;
+                saving    = levelSize;
+            }
+        }
+        if (coarsened == nullptr)
+        {
+            break;
+        }
+
+        ++coarsened->targetMip;
+        size -= saving;
+    }
+    mStats.targetSize = size;
+
+    mStats.degradedTextures = 0;
+    for (const StreamedTexture &streamed : mTextures)
+    {
+        if (streamed.targetMip > streamed.requiredMip)
+        {
+            ++mStats.degradedTextures;
+        }
+    }
+}
+
+void TextureStreamer::printStats() const
+{
+    std::cout << "Texture streaming: " << mStats.textureCount << " textures, "
+              << toMB(mStats.residentSize) << " MB resident of a " << toMB(mStats.budget)
+              << " MB budget, " << toMB(mStats.requiredSize) << " MB required by the view, "
+              << mStats.degradedTextures << " textures coarser than required. "
+              << mStats.loads << " loads and " << mStats.evictions << " evictions." << std::endl;
+}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureStreamer.h: Define the texture streamer, which keeps only the mips of streamed textures
+// that the view needs on the GPU, within a memory budget. The finest mip a texture needs is
+// estimated each frame from the projected size of the models sampling it. The levels are
+// prepared on workers from the texture cache, and uploaded or evicted on the render thread.
+
+#pragma once
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H 1
+
+#include <cstddef>
+#include <vector>
+
+#include "AssetLoader.h"
+
+class Model;
+class ResourceHelper;
+class Texture;
+
+struct TextureStreamingStats
+{
+    int textureCount;
+    size_t budget;         // In bytes, as are the sizes below.
+    size_t requiredSize;   // Of the mips required by the view, regardless of the budget.
+    size_t targetSize;     // Of the mips required by the view, fitted into the budget.
+    size_t residentSize;   // On the GPU.
+    int degradedTextures;  // Coarser than required to fit into the budget.
+    int pendingLoads;
+    int loads;             // Counts of levels refined and evicted since the start.
+    int evictions;
+};
+
+class TextureStreamer
+{
+  public:
+    TextureStreamer(const ResourceHelper *resourceHelper, size_t budget, int threadCount);
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // Stream the streamed textures of the model. Their mips are estimated from its world
+    // bounding spheres. Models without them, such as fish, need the finest mips. Must be called
+    // before the first update().
+    void addModel(const Model *model);
+
+    // Estimate the mips needed by the view, fit them into the budget, and load or evict levels.
+    // pixelsPerUnit is the projected size in pixels of a unit at distance 1 from the eye. Must be
+    // called once a frame on the render thread.
+    void update(const float *viewProjection, float pixelsPerUnit);
+
+    const TextureStreamingStats &getStats() const { return mStats; }
+    void printStats() const;
+
+  private:
+    struct StreamedTexture
+    {
+        Texture *texture;
+        std::vector<const Model *> models;
+        // Snapshot of the size once the texture is loaded, as workers rewrite it while preparing
+        // levels. 0 until then.
+        int width;
+        int height;
+        int mipCount;
+        int requiredMip;
+        int targetMip;
+        bool loading;
+    };
+
+    int estimateRequiredMip(const StreamedTexture &streamed,
+                            const float *viewProjection,
+                            float pixelsPerUnit) const;
+    // Coarsen the target mips of the textures saving the most memory, until they fit.
+    void fitBudget();
+
+    const ResourceHelper *mResourceHelper;
+    std::vector<StreamedTexture> mTextures;
+    TextureStreamingStats mStats;
+
+    // Declared last, so workers are joined before the textures they prepare are forgotten.
+    AssetLoader mLoader;
+};
+
+#endif  // !TEXTURE_STREAMER_H
@@ -26,12 +26,12 @@ class BufferD3D12 : public Buffer
     BufferD3D12(ContextD3D12 *context,
                 int totalCmoponents,
                 int numComponents,
-                const std::vector<float> &buffer,
+                const float *buffer,
                 bool isIndex);
     BufferD3D12(ContextD3D12 *context,
                 int totalCmoponents,
                 int numComponents,
-                const std::vector<unsigned short> &buffer,
+                const unsigned short *buffer,
                 bool isIndex);
 
     ComPtr<ID3D12Resource> getBuffer() const { return mBuffer; }
@@ -48,7 +48,6 @@ class BufferD3D12 : public Buffer
 
   private:
     ComPtr<ID3D12Resource> mBuffer;
-    ComPtr<ID3D12Resource> mUploadBuffer;
     bool mIsIndex;
     int mTotoalComponents;
     uint32_t mStride;
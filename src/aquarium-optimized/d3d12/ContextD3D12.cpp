@@ -410,6 +410,7 @@ void ContextD3D12::DoFlush()
     ThrowIfFailed(mSwapChain->Present(1, 0));
 
     WaitForPreviousFrame();
+    releaseCompletedUploads();
 
     glfwPollEvents();
 }
@@ -437,6 +438,7 @@ void ContextD3D12::FlushInit()
         m_frameIndex = mSwapChain->GetCurrentBackBufferIndex();
 
         WaitForPreviousFrame();
+        releaseCompletedUploads();
     }
 }
 
@@ -466,7 +468,7 @@ void ContextD3D12::showWindow()
     glfwShowWindow(mWindow);
 }
 
-void ContextD3D12::showFPS(const FPSTimer &fpsTimer)
+void ContextD3D12::showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats)
 {
     // Start the Dear ImGui frame
     ImGui_ImplDX12_NewFrame();
@@ -496,6 +498,10 @@ void ContextD3D12::showFPS(const FPSTimer &fpsTimer)
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                     1000.0f / fpsTimer.getAverageFPS(), fpsTimer.getAverageFPS());
+
+        ImGui::Text("Models drawn %d, culled %d", cullingStats.drawnModels,
+                    cullingStats.culledModels);
+        ImGui::Text("Fish drawn %d, culled %d", cullingStats.drawnFish, cullingStats.culledFish);
         ImGui::End();
     }
 
@@ -584,56 +590,52 @@ Model *ContextD3D12::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME
     return model;
 }
 
-Buffer *ContextD3D12::createBuffer(int numComponents, std::vector<float> *buf, bool isIndex)
+Buffer *ContextD3D12::createBuffer(int numComponents, const float *buf, size_t size, bool isIndex)
 {
-    Buffer *buffer =
-        new BufferD3D12(this, static_cast<int>(buf->size()), numComponents, *buf, isIndex);
+    Buffer *buffer = new BufferD3D12(this, static_cast<int>(size), numComponents, buf, isIndex);
     return buffer;
 }
 
 Buffer *ContextD3D12::createBuffer(int numComponents,
-                                   std::vector<unsigned short> *buf,
+                                   const unsigned short *buf,
+                                   size_t size,
                                    bool isIndex)
 {
-    Buffer *buffer =
-        new BufferD3D12(this, static_cast<int>(buf->size()), numComponents, *buf, isIndex);
+    Buffer *buffer = new BufferD3D12(this, static_cast<int>(size), numComponents, buf, isIndex);
     return buffer;
 }
 
-Program *ContextD3D12::createProgram(const std::string &mVId, const std::string &mFId)
+Program *ContextD3D12::createProgram(const std::string &mVId,
+                                     const std::string &mFId,
+                                     uint32_t features)
 {
-    ProgramD3D12 *program = new ProgramD3D12(this, mVId, mFId);
-    program->loadProgram();
-
+    ProgramD3D12 *program = new ProgramD3D12(this, mVId, mFId, features);
     return program;
 }
 
 Texture *ContextD3D12::createTexture(const std::string &name, const std::string &url)
 {
     Texture *texture = new TextureD3D12(this, name, url);
-    texture->loadTexture();
     return texture;
 }
 
 Texture *ContextD3D12::createTexture(const std::string &name, const std::vector<std::string> &urls)
 {
     Texture *texture = new TextureD3D12(this, name, urls);
-    texture->loadTexture();
     return texture;
 }
 
 void ContextD3D12::initGeneralResources(Aquarium *aquarium)
 {
     // create common constant buffer, desc and view.
-    mLightBuffer =
-        createDefaultBuffer(&aquarium->lightUniforms,
-                            CalcConstantBufferByteSize(sizeof(LightUniforms)), mLightUploadBuffer);
+    mLightBuffer = createDefaultBuffer(&aquarium->lightUniforms,
+                                       CalcConstantBufferByteSize(sizeof(LightUniforms)));
     mLightView.BufferLocation = mLightBuffer->GetGPUVirtualAddress();
     mLightView.SizeInBytes    = CalcConstantBufferByteSize(sizeof(LightUniforms));
     buildCbvDescriptor(mLightView, &lightGPUHandle);
 
-    mFogBuffer = createDefaultBuffer(
-        &aquarium->fogUniforms, CalcConstantBufferByteSize(sizeof(FogUniforms)), mFogUploadBuffer);
+    mFogBuffer = createDefaultBuffer(&aquarium->fogUniforms,
+                                     CalcConstantBufferByteSize(sizeof(FogUniforms)));
     mFogView.BufferLocation = mFogBuffer->GetGPUVirtualAddress();
     mFogView.SizeInBytes    = CalcConstantBufferByteSize(
         sizeof(FogUniforms));  // CB size is required to be 256-byte aligned.
@@ -812,11 +814,10 @@ void ContextD3D12::createCommandList(ID3D12PipelineState *pInitialState,
                                              IID_PPV_ARGS(&commandList)));
 }
 
-ComPtr<ID3D12Resource> ContextD3D12::createDefaultBuffer(const void *initData,
-                                                         UINT64 byteSize,
-                                                         ComPtr<ID3D12Resource> &uploadBuffer) const
+ComPtr<ID3D12Resource> ContextD3D12::createDefaultBuffer(const void *initData, UINT64 byteSize)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
+    ComPtr<ID3D12Resource> uploadBuffer;
 
     CD3DX12_RESOURCE_DESC resourceDescriptor = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 
@@ -845,6 +846,7 @@ ComPtr<ID3D12Resource> ContextD3D12::createDefaultBuffer(const void *initData,
 
     stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST,
                     D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    releaseAfterUpload(std::move(uploadBuffer));
 
     return defaultBuffer;
 }
@@ -886,9 +888,8 @@ void ContextD3D12::createRootSignature(
 }
 
 void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
-                                 const std::vector<UINT8 *> &texture,
+                                 const std::vector<const UINT8 *> &texture,
                                  ComPtr<ID3D12Resource> &m_texture,
-                                 ComPtr<ID3D12Resource> &textureUploadHeap,
                                  int TextureWidth,
                                  int TextureHeight,
                                  int TexturePixelSize,
@@ -904,6 +905,7 @@ void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
         GetRequiredIntermediateSize(m_texture.Get(), 0, num2DSubresources);
 
     CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+    ComPtr<ID3D12Resource> textureUploadHeap;
     // Create the GPU upload buffer.
     ThrowIfFailed(mDevice->CreateCommittedResource(&uploadheapProperties, D3D12_HEAP_FLAG_NONE,
                                                    &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
@@ -926,6 +928,10 @@ void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
 
         TextureWidth >>= 1;
         TextureHeight >>= 1;
+        if (TextureWidth == 0)
+        {
+            TextureWidth = 1;
+        }
         if (TextureHeight == 0)
         {
             TextureHeight = 1;
@@ -937,6 +943,23 @@ void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
 
     stateTransition(m_texture, D3D12_RESOURCE_STATE_COPY_DEST,
                     D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    releaseAfterUpload(std::move(textureUploadHeap));
+}
+
+void ContextD3D12::releaseAfterUpload(ComPtr<ID3D12Resource> uploadResource)
+{
+    // The copy is recorded into mCommandList, which is executed before the next fence value is
+    // signaled by WaitForPreviousFrame().
+    mPendingUploads.emplace_back(mFenceValue + 1, std::move(uploadResource));
+}
+
+void ContextD3D12::releaseCompletedUploads()
+{
+    UINT64 completedValue = mFence->GetCompletedValue();
+    while (!mPendingUploads.empty() && mPendingUploads.front().first <= completedValue)
+    {
+        mPendingUploads.pop_front();
+    }
 }
 
 void ContextD3D12::createGraphicsPipelineState(
@@ -9,6 +9,9 @@
 #ifndef CONTEXTD3D12_H
 #define CONTEXTD3D12_H
 
+#include <deque>
+#include <utility>
+
 #include "../Context.h"
 
 #include "GLFW/glfw3.h"
@@ -34,19 +37,25 @@ class ContextD3D12 : public Context
     void DoFlush() override;
     void Terminate() override;
     void showWindow() override;
-    void showFPS(const FPSTimer &fpsTimer) override;
+    void showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats) override;
     void destoryImgUI() override;
 
     void FlushInit() override;
     void preFrame() override;
 
     Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
-    Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) override;
     Buffer *createBuffer(int numComponents,
-                         std::vector<unsigned short> *buffer,
+                         const float *buffer,
+                         size_t size,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const unsigned short *buffer,
+                         size_t size,
                          bool isIndex) override;
 
-    Program *createProgram(const std::string &mVId, const std::string &mFId) override;
+    Program *createProgram(const std::string &mVId,
+                           const std::string &mFId,
+                           uint32_t features) override;
 
     Texture *createTexture(const std::string &name, const std::string &url) override;
     Texture *createTexture(const std::string &name, const std::vector<std::string> &urls) override;
@@ -71,9 +80,8 @@ class ContextD3D12 : public Context
     void createCommandList(ID3D12PipelineState *pInitialState,
                            ComPtr<ID3D12GraphicsCommandList> &commandList);
 
-    ComPtr<ID3D12Resource> createDefaultBuffer(const void *initData,
-                                               UINT64 byteSize,
-                                               ComPtr<ID3D12Resource> &uploadBuffer) const;
+    // The intermediate upload buffer is released once the GPU copy is done.
+    ComPtr<ID3D12Resource> createDefaultBuffer(const void *initData, UINT64 byteSize);
     ComPtr<ID3D12Resource> createUploadBuffer(const void *initData, UINT64 byteSize) const;
     void createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC &pRootSignatureDesc,
                              ComPtr<ID3D12RootSignature> &rootSignature) const;
@@ -90,10 +98,11 @@ class ContextD3D12 : public Context
     void buildCbvDescriptor(const D3D12_CONSTANT_BUFFER_VIEW_DESC &cbvDesc,
                             D3D12_GPU_DESCRIPTOR_HANDLE *hGpuDescriptor);
     UINT CalcConstantBufferByteSize(UINT byteSize);
+    // The texture data is copied into an upload heap, so it can be freed on return. The heap is
+    // released once the GPU copy is done.
     void createTexture(const D3D12_RESOURCE_DESC &textureDesc,
-                       const std::vector<UINT8 *> &texture,
+                       const std::vector<const UINT8 *> &texture,
                        ComPtr<ID3D12Resource> &m_texture,
-                       ComPtr<ID3D12Resource> &textureUploadHeap,
                        int TextureWidth,
                        int TextureHeight,
                        int TexturePixelSize,
@@ -119,6 +128,10 @@ class ContextD3D12 : public Context
         IDXGIAdapter1 **ppAdapter,
         const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset);
     void WaitForPreviousFrame();
+    // Keep an upload resource alive until the command list recording its copy is executed and
+    // the fence passes the serial of the submit.
+    void releaseAfterUpload(ComPtr<ID3D12Resource> uploadResource);
+    void releaseCompletedUploads();
     void createDepthStencilView();
     void stateTransition(ComPtr<ID3D12Resource> &resource,
                          D3D12_RESOURCE_STATES preState,
@@ -148,6 +161,8 @@ class ContextD3D12 : public Context
     ComPtr<ID3D12Fence> mFence;
     UINT64 mFenceValue;
     HANDLE mFenceEvent;
+    // Upload resources and the fence values signaled after their copies are submitted.
+    std::deque<std::pair<UINT64, ComPtr<ID3D12Resource>>> mPendingUploads;
 
     D3D12_FEATURE_DATA_ROOT_SIGNATURE mRootSignature;
 
@@ -159,11 +174,9 @@ class ContextD3D12 : public Context
 
     D3D12_CONSTANT_BUFFER_VIEW_DESC mLightView;
     ComPtr<ID3D12Resource> mLightBuffer;
-    ComPtr<ID3D12Resource> mLightUploadBuffer;
 
     D3D12_CONSTANT_BUFFER_VIEW_DESC mFogView;
     ComPtr<ID3D12Resource> mFogBuffer;
-    ComPtr<ID3D12Resource> mFogUploadBuffer;
 
     ComPtr<ID3D12Resource> mSceneRenderTargetTexture;
     D3D12_RENDER_TARGET_VIEW_DESC mSceneRenderTargetView;
@@ -91,16 +91,15 @@ void FishModelInstancedDrawD3D12::init()
 
     // create constant buffer, desc.
     mFishVertexBuffer = mContextD3D12->createDefaultBuffer(
-        &mFishVertexUniforms, mContextD3D12->CalcConstantBufferByteSize(sizeof(FishVertexUniforms)),
-        mFishVertexUploadBuffer);
+        &mFishVertexUniforms,
+        mContextD3D12->CalcConstantBufferByteSize(sizeof(FishVertexUniforms)));
     mFishVertexView.BufferLocation = mFishVertexBuffer->GetGPUVirtualAddress();
     mFishVertexView.SizeInBytes    = mContextD3D12->CalcConstantBufferByteSize(
         sizeof(mFishVertexUniforms));  // CB size is required to be 256-byte aligned.
     mContextD3D12->buildCbvDescriptor(mFishVertexView, &mFishVertexGPUHandle);
     mLightFactorBuffer = mContextD3D12->createDefaultBuffer(
         &mLightFactorUniforms,
-        mContextD3D12->CalcConstantBufferByteSize(sizeof(LightFactorUniforms)),
-        mLightFactorUploadBuffer);
+        mContextD3D12->CalcConstantBufferByteSize(sizeof(LightFactorUniforms)));
     mLightFactorView.BufferLocation = mLightFactorBuffer->GetGPUVirtualAddress();
     mLightFactorView.SizeInBytes    = mContextD3D12->CalcConstantBufferByteSize(
         sizeof(LightFactorUniforms));  // CB size is required to be 256-byte aligned.
@@ -156,13 +155,13 @@ void FishModelInstancedDrawD3D12::prepareForDraw() const {}
 
 void FishModelInstancedDrawD3D12::draw()
 {
-    if (instance == 0)
+    if (mCurInstance == 0)
         return;
 
     CD3DX12_RANGE readRange(0, 0);
     UINT8 *m_pCbvDataBegin;
     mFishPersBuffer->Map(0, &readRange, reinterpret_cast<void **>(&m_pCbvDataBegin));
-    memcpy(m_pCbvDataBegin, mFishPers, sizeof(FishPer) * instance);
+    memcpy(m_pCbvDataBegin, mFishPers, sizeof(FishPer) * mCurInstance);
 
     auto &commandList = mContextD3D12->mCommandList;
 
@@ -179,7 +178,7 @@ void FishModelInstancedDrawD3D12::draw()
     commandList->IASetVertexBuffers(0, 6, mVertexBufferView);
     commandList->IASetIndexBuffer(&mIndicesBuffer->mIndexBufferView);
 
-    commandList->DrawIndexedInstanced(mIndicesBuffer->getTotalComponents(), instance, 0, 0, 0);
+    commandList->DrawIndexedInstanced(mIndicesBuffer->getTotalComponents(), mCurInstance, 0, 0, 0);
 }
 
 void FishModelInstancedDrawD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUniforms) {}
@@ -85,12 +85,10 @@ class FishModelInstancedDrawD3D12 : public FishModel
     D3D12_CONSTANT_BUFFER_VIEW_DESC mLightFactorView;
     D3D12_GPU_DESCRIPTOR_HANDLE mLightFactorGPUHandle;
     ComPtr<ID3D12Resource> mLightFactorBuffer;
-    ComPtr<ID3D12Resource> mLightFactorUploadBuffer;
 
     D3D12_CONSTANT_BUFFER_VIEW_DESC mFishVertexView;
     D3D12_GPU_DESCRIPTOR_HANDLE mFishVertexGPUHandle;
     ComPtr<ID3D12Resource> mFishVertexBuffer;
-    ComPtr<ID3D12Resource> mFishVertexUploadBuffer;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputElementDescs;
     D3D12_VERTEX_BUFFER_VIEW mVertexBufferView[6];
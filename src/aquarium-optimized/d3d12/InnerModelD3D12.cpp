@@ -56,8 +56,7 @@ void InnerModelD3D12::init()
 
     // create constant buffer, desc.
     mInnerBuffer = mContextD3D12->createDefaultBuffer(
-        &mInnerUniforms, mContextD3D12->CalcConstantBufferByteSize(sizeof(InnerUniforms)),
-        mInnerUploadBuffer);
+        &mInnerUniforms, mContextD3D12->CalcConstantBufferByteSize(sizeof(InnerUniforms)));
     mInnerView.BufferLocation = mInnerBuffer->GetGPUVirtualAddress();
     mInnerView.SizeInBytes    = mContextD3D12->CalcConstantBufferByteSize(
         sizeof(InnerUniforms));  // CB size is required to be 256-byte aligned.
@@ -60,7 +60,6 @@ class InnerModelD3D12 : public Model
     D3D12_CONSTANT_BUFFER_VIEW_DESC mInnerView;
     D3D12_GPU_DESCRIPTOR_HANDLE mInnerGPUHandle;
     ComPtr<ID3D12Resource> mInnerBuffer;
-    ComPtr<ID3D12Resource> mInnerUploadBuffer;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputElementDescs;
     D3D12_VERTEX_BUFFER_VIEW mVertexBufferView[5];
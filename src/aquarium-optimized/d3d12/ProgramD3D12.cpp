@@ -4,31 +4,37 @@
 // found in the LICENSE file.
 //
 #include <cstring>
-#include <fstream>
 
 #include "ContextD3D12.h"
 #include "ProgramD3D12.h"
 
-ProgramD3D12::ProgramD3D12(ContextD3D12 *context, const std::string &mVId, const std::string &mFId)
-    : Program(mVId, mFId), mVertexShader(nullptr), mPixelShader(nullptr), context(context)
+ProgramD3D12::ProgramD3D12(ContextD3D12 *context,
+                           const std::string &mVId,
+                           const std::string &mFId,
+                           uint32_t features)
+    : Program(mVId, mFId, features), mVertexShader(nullptr), mPixelShader(nullptr), context(context)
 {
 }
 
 ProgramD3D12::~ProgramD3D12() {}
 
-void ProgramD3D12::loadProgram()
+void ProgramD3D12::prepareProgram()
 {
-    std::ifstream VertexShaderStream(mVId, std::ios::in);
-    std::string VertexShaderCode((std::istreambuf_iterator<char>(VertexShaderStream)),
-                                 std::istreambuf_iterator<char>());
-    VertexShaderStream.close();
+    if (mPrepared)
+    {
+        return;
+    }
 
-    // Read the Fragment Shader code from the file
-    std::ifstream FragmentShaderStream(mFId, std::ios::in);
-    std::string FragmentShaderCode((std::istreambuf_iterator<char>(FragmentShaderStream)),
-                                   std::istreambuf_iterator<char>());
-    FragmentShaderStream.close();
+    loadSource(context->getResourceHelper());
+    std::string VertexShaderCode   = std::move(mVertexShaderCode);
+    std::string FragmentShaderCode = std::move(mFragmentShaderCode);
 
     mVertexShader = context->createShaderModule("VS", VertexShaderCode);
     mPixelShader  = context->createShaderModule("PS", FragmentShaderCode);
+    mPrepared     = true;
+}
+
+void ProgramD3D12::loadProgram()
+{
+    prepareProgram();
 }
@@ -26,10 +26,15 @@ class ProgramD3D12 : public Program
 {
   public:
     ProgramD3D12() {}
-    ProgramD3D12(ContextD3D12 *context, const std::string &mVId, const std::string &mFId);
+    ProgramD3D12(ContextD3D12 *context,
+                 const std::string &mVId,
+                 const std::string &mFId,
+                 uint32_t features);
     ~ProgramD3D12() override;
 
-    void loadProgram();
+    // HLSL is compiled on a worker, as D3DCompile() doesn't touch the device.
+    void prepareProgram() override;
+    void loadProgram() override;
     ComPtr<ID3DBlob> getVSModule() { return mVertexShader; }
     ComPtr<ID3DBlob> getFSModule() { return mPixelShader; }
 
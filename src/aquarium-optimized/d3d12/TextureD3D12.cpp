@@ -5,6 +5,7 @@
 //
 #include <algorithm>
 #include <cmath>
+#include <iostream>
 
 #include "ContextD3D12.h"
 #include "TextureD3D12.h"
@@ -19,6 +20,7 @@ TextureD3D12::TextureD3D12(ContextD3D12 *context, const std::string &name, const
       mSrvDesc({}),
       mContext(context)
 {
+    mGenerateMipmaps = true;
 }
 
 TextureD3D12::TextureD3D12(ContextD3D12 *context,
@@ -35,7 +37,12 @@ TextureD3D12::TextureD3D12(ContextD3D12 *context,
 
 void TextureD3D12::loadTexture()
 {
-    loadImage(mUrls, &mPixelVec);
+    if (!prepareLevels(mContext->getResourceHelper()))
+    {
+        std::cout << "Failed to load texture " << mName << "." << std::endl;
+        releaseLevels();
+        return;
+    }
 
     if (mTextureViewDimension == D3D12_SRV_DIMENSION_TEXTURECUBE)
     {
@@ -50,16 +57,13 @@ void TextureD3D12::loadTexture()
         textureDesc.SampleDesc.Quality  = 0;
         textureDesc.Dimension           = mTextureDimension;
 
-        mContext->createTexture(textureDesc, mPixelVec, mTexture, mTextureUploadHeap, mWidth,
-                                mHeight, 4u, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+        mContext->createTexture(textureDesc, getLevels(), mTexture, mWidth, mHeight, 4u,
+                                textureDesc.MipLevels, textureDesc.DepthOrArraySize);
     }
     else
     {
-        generateMipmap(mPixelVec[0], mWidth, mHeight, 0, mResizedVec, mWidth, mHeight, 0, 4, false);
-
         D3D12_RESOURCE_DESC textureDesc = {};
-        textureDesc.MipLevels =
-            static_cast<uint16_t>(std::floor(std::log2(std::max(mWidth, mHeight)))) + 1;
+        textureDesc.MipLevels          = static_cast<uint16_t>(getLevelCount());
         textureDesc.Format             = mFormat;
         textureDesc.Width              = mWidth;
         textureDesc.Height             = mHeight;
@@ -69,9 +73,12 @@ void TextureD3D12::loadTexture()
         textureDesc.SampleDesc.Quality = 0;
         textureDesc.Dimension          = mTextureDimension;
 
-        mContext->createTexture(textureDesc, mResizedVec, mTexture, mTextureUploadHeap, mWidth,
-                                mHeight, 4u, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+        mContext->createTexture(textureDesc, getLevels(), mTexture, mWidth, mHeight, 4u,
+                                textureDesc.MipLevels, textureDesc.DepthOrArraySize);
     }
+
+    // The images are copied into the upload heap, and aren't needed anymore.
+    releaseLevels();
 }
 
 // Allocate descriptors sequentially on deascriptor heap to bind root signature, create srv before
@@ -8,33 +8,28 @@
 #include "BufferDawn.h"
 #include "ContextDawn.h"
 
-// Copy size must be a multiple of 4 bytes on dawn mac backend.
+// Copy size must be a multiple of 4 bytes on dawn mac backend. Float data always is, uint16 data
+// is padded with one more index if the count is odd.
 BufferDawn::BufferDawn(ContextDawn *context,
                        int totalCmoponents,
                        int numComponents,
-                       std::vector<float> *buffer,
+                       const float *buffer,
                        bool isIndex)
     : mUsageBit(isIndex ? dawn::BufferUsageBit::Index : dawn::BufferUsageBit::Vertex),
       mTotoalComponents(totalCmoponents),
       mStride(0),
       mOffset(nullptr)
 {
-    mSize = numComponents * sizeof(float);
-    if (mTotoalComponents % 4 != 0)
-    {
-        int dummyCount = 4 - mTotoalComponents % 4;
-        for (int i = 0; i < dummyCount; i++)
-        {
-            buffer->push_back(0.0f);
-        }
-    }
-    mBuf = context->createBufferFromData(buffer->data(), sizeof(float) * static_cast<int>(buffer->size()), mUsageBit);
+    mSize         = numComponents * sizeof(float);
+    uint32_t size = sizeof(float) * mTotoalComponents;
+    mBuf          = context->createBuffer(size, mUsageBit | dawn::BufferUsageBit::CopyDst);
+    context->uploadBuffer(mBuf, buffer, size);
 }
 
 BufferDawn::BufferDawn(ContextDawn *context,
                        int totalCmoponents,
                        int numComponents,
-                       std::vector<unsigned short> *buffer,
+                       const unsigned short *buffer,
                        bool isIndex)
     : mUsageBit(isIndex ? dawn::BufferUsageBit::Index : dawn::BufferUsageBit::Vertex),
       mTotoalComponents(totalCmoponents),
@@ -42,16 +37,21 @@ BufferDawn::BufferDawn(ContextDawn *context,
       mOffset(nullptr)
 {
     mSize = numComponents * sizeof(unsigned short);
-    if (mTotoalComponents % 4 != 0)
+    if (mTotoalComponents % 2 != 0)
+    {
+        // The source may be read only mapped memory, pad a copy instead of the source.
+        std::vector<unsigned short> padded(buffer, buffer + mTotoalComponents);
+        padded.push_back(0);
+        uint32_t size = sizeof(unsigned short) * static_cast<uint32_t>(padded.size());
+        mBuf          = context->createBuffer(size, mUsageBit | dawn::BufferUsageBit::CopyDst);
+        context->uploadBuffer(mBuf, padded.data(), size);
+    }
+    else
     {
-        int dummyCount = 4 - mTotoalComponents % 4;
-        for (int i = 0; i < dummyCount; i++)
-        {
-            buffer->push_back(0.0f);
-        }
+        uint32_t size = sizeof(unsigned short) * mTotoalComponents;
+        mBuf          = context->createBuffer(size, mUsageBit | dawn::BufferUsageBit::CopyDst);
+        context->uploadBuffer(mBuf, buffer, size);
     }
-    mBuf = context->createBufferFromData(
-        buffer->data(), sizeof(unsigned short) * static_cast<int>(buffer->size()), mUsageBit);
 }
 
 BufferDawn::~BufferDawn()
@@ -6,7 +6,10 @@
 // DeviceDawn.cpp: Implements accessing functions to the graphics API of Dawn.
 
 #include <array>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -28,6 +31,7 @@
 #include "SeaweedModelDawn.h"
 #include "TextureDawn.h"
 
+#include "common/AQUARIUM_ASSERT.h"
 #include "common/Constants.h"
 #include "imgui.h"
 #include "imgui_impl_dawn.h"
@@ -36,6 +40,126 @@
 #include "utils/ComboRenderPipelineDescriptor.h"
 
 #include "../Aquarium.h"
+#include "../Mesh.h"
+
+namespace {
+
+dawn::VertexFormat getVertexFormat(const VertexElement &element)
+{
+    switch (element.format)
+    {
+        case VertexElementFormat::FLOAT16:
+            ASSERT(element.numComponents == 2 || element.numComponents == 4);
+            return element.numComponents == 2 ? dawn::VertexFormat::Half2
+                                              : dawn::VertexFormat::Half4;
+        case VertexElementFormat::SNORM16:
+            ASSERT(element.numComponents == 2 || element.numComponents == 4);
+            return element.numComponents == 2 ? dawn::VertexFormat::Short2Norm
+                                              : dawn::VertexFormat::Short4Norm;
+        case VertexElementFormat::UNORM16:
+            ASSERT(element.numComponents == 2 || element.numComponents == 4);
+            return element.numComponents == 2 ? dawn::VertexFormat::UShort2Norm
+                                              : dawn::VertexFormat::UShort4Norm;
+        default:
+        {
+            static const dawn::VertexFormat kFloatFormats[] = {
+                dawn::VertexFormat::Float, dawn::VertexFormat::Float2, dawn::VertexFormat::Float3,
+                dawn::VertexFormat::Float4};
+            ASSERT(element.numComponents >= 1 && element.numComponents <= 4);
+            return kFloatFormats[element.numComponents - 1];
+        }
+    }
+}
+
+bool isSameSampler(const dawn::SamplerDescriptor &a, const dawn::SamplerDescriptor &b)
+{
+    return a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV &&
+           a.addressModeW == b.addressModeW && a.magFilter == b.magFilter &&
+           a.minFilter == b.minFilter && a.mipmapFilter == b.mipmapFilter &&
+           a.lodMinClamp == b.lodMinClamp && a.lodMaxClamp == b.lodMaxClamp &&
+           a.compare == b.compare;
+}
+
+constexpr char kSpirvCacheMagic[4]   = {'A', 'Q', 'S', 'V'};
+constexpr uint32_t kSpirvCacheVersion = 1;
+
+struct SpirvCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;  // Of the source, the stage and the compiler.
+    uint32_t wordCount;
+    uint32_t reserved;
+};
+
+shaderc_shader_kind getShaderKind(utils::ShaderStage stage)
+{
+    switch (stage)
+    {
+        case utils::ShaderStage::Vertex:
+            return shaderc_glsl_vertex_shader;
+        case utils::ShaderStage::Fragment:
+            return shaderc_glsl_fragment_shader;
+        case utils::ShaderStage::Compute:
+            return shaderc_glsl_compute_shader;
+        default:
+            ASSERT(false);
+            return shaderc_glsl_vertex_shader;
+    }
+}
+
+// Modules are compiled with the default options, as utils::CreateShaderModule() does, so only
+// the version of the compiler and of SPIR-V it targets are hashed.
+uint64_t getSpirvCacheHash(utils::ShaderStage stage, const std::string &source)
+{
+    unsigned int version  = 0;
+    unsigned int revision = 0;
+    shaderc_get_spv_version(&version, &revision);
+    uint32_t key[] = {static_cast<uint32_t>(getShaderKind(stage)), version, revision};
+
+    uint64_t hash = hashData(reinterpret_cast<const uint8_t *>(key), sizeof(key));
+    return hashData(reinterpret_cast<const uint8_t *>(source.data()), source.size(), hash);
+}
+
+bool writeSpirvCache(const std::string &path,
+                     uint64_t hash,
+                     const uint32_t *words,
+                     uint32_t wordCount)
+{
+    SpirvCacheHeader header;
+    memcpy(header.magic, kSpirvCacheMagic, sizeof(kSpirvCacheMagic));
+    header.version   = kSpirvCacheVersion;
+    header.hash      = hash;
+    header.wordCount = wordCount;
+    header.reserved  = 0;
+
+    // Write to a temporary file first, so a reader never maps a partially written cache.
+    std::string tempPath = path + ".tmp";
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.good())
+    {
+        return false;
+    }
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(words), wordCount * sizeof(uint32_t));
+    stream.close();
+
+    if (stream.fail())
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
 
 ContextDawn::ContextDawn(BACKENDTYPE backendType)
     : queue(nullptr),
@@ -52,6 +176,21 @@ ContextDawn::ContextDawn(BACKENDTYPE backendType)
       mPipeline(nullptr),
       mBindGroup(nullptr),
       mPreferredSwapChainFormat(dawn::TextureFormat::RGBA8Unorm),
+      mUploadEncoder(nullptr),
+      mUploadCount(0),
+      mStagingAllocator(this),
+      mUploadFence(nullptr),
+      mUploadSerial(0),
+      mBoundPipeline(nullptr),
+      mRenderPassStats(),
+      mFishTextureArrayStates(),
+      mSamplers(),
+      mSamplerRequestCount(0),
+      mBindGroupCount(0),
+      mBindGroupCreationTime(0.0),
+      mSpirvCacheHits(0),
+      mSpirvCacheMisses(0),
+      mShaderCompileTime(0.0),
       mEnableMSAA(false)
 {
     mResourceHelper = new ResourceHelper("dawn", "");
@@ -75,7 +214,15 @@ ContextDawn::~ContextDawn()
     mLightBuffer              = nullptr;
     mFogBuffer                = nullptr;
     mCommandEncoder          = nullptr;
-    mCommandBuffers.clear();
+    mUploadEncoder           = nullptr;
+    mUploadFence             = nullptr;
+    mBoundPipeline           = nullptr;
+    for (auto &bindGroup : mBoundBindGroups)
+    {
+        bindGroup = nullptr;
+    }
+    mFishTextureArrayStates.clear();
+    mSamplers.clear();
     mRenderPass              = nullptr;
     mRenderPassDescriptor    = {};
     groupLayoutGeneral       = nullptr;
@@ -185,6 +332,10 @@ bool ContextDawn::initialize(
     mDevice = dawn::Device::Acquire(backendDevice);
 
     queue = mDevice.CreateQueue();
+    dawn::FenceDescriptor fenceDescriptor;
+    fenceDescriptor.nextInChain  = nullptr;
+    fenceDescriptor.initialValue = mUploadSerial;
+    mUploadFence                 = queue.CreateFence(&fenceDescriptor);
     dawn::SwapChainDescriptor swapChainDesc;
     swapChainDesc.implementation = binding->GetSwapChainImplementation();
     mSwapchain                   = mDevice.CreateSwapChain(&swapChainDesc);
@@ -291,19 +442,27 @@ void ContextDawn::initAvailableToggleBitset(BACKENDTYPE backendType)
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::DISCRETEGPU));
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::INTEGRATEDGPU));
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFULLSCREENMODE));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFISHTEXTUREARRAYS));
 }
 
 Texture *ContextDawn::createTexture(const std::string &name, const std::string &url)
 {
     Texture *texture = new TextureDawn(this, name, url);
-    texture->loadTexture();
     return texture;
 }
 
 Texture *ContextDawn::createTexture(const std::string &name, const std::vector<std::string> &urls)
 {
     Texture *texture = new TextureDawn(this, name, urls);
-    texture->loadTexture();
+    return texture;
+}
+
+Texture *ContextDawn::createTextureArray(const std::string &name,
+                                         const std::vector<std::string> &urls)
+{
+    Texture *texture = new TextureDawn(this, name, urls, dawn::TextureViewDimension::e2DArray);
     return texture;
 }
 
@@ -317,6 +476,23 @@ dawn::Sampler ContextDawn::createSampler(const dawn::SamplerDescriptor &descript
     return mDevice.CreateSampler(&descriptor);
 }
 
+// The scene only samples with a few sampler states, so a linear search is enough.
+dawn::Sampler ContextDawn::getSampler(const dawn::SamplerDescriptor &descriptor)
+{
+    ++mSamplerRequestCount;
+    for (const auto &sampler : mSamplers)
+    {
+        if (isSameSampler(sampler.first, descriptor))
+        {
+            return sampler.second;
+        }
+    }
+
+    dawn::Sampler sampler = createSampler(descriptor);
+    mSamplers.emplace_back(descriptor, sampler);
+    return sampler;
+}
+
 dawn::Buffer ContextDawn::createBufferFromData(const void *pixels, int size, dawn::BufferUsageBit usage) const
 {
     return utils::CreateBufferFromData(mDevice, pixels, size, usage);
@@ -339,18 +515,115 @@ dawn::TextureCopyView ContextDawn::createTextureCopyView(dawn::Texture texture,
     return utils::CreateTextureCopyView(texture, level, slice, origin);
 }
 
-dawn::CommandBuffer ContextDawn::copyBufferToTexture(const dawn::BufferCopyView &bufferCopyView, const dawn::TextureCopyView &textureCopyView, const dawn::Extent3D& ext3D) const
+dawn::CommandEncoder ContextDawn::getUploadEncoder()
+{
+    if (mUploadCount == 0)
+    {
+        // Reuse the staging buffers of the uploads which the queue is done with.
+        mStagingAllocator.recycle(mUploadFence.GetCompletedValue());
+        mUploadEncoder = mDevice.CreateCommandEncoder();
+    }
+    ++mUploadCount;
+    return mUploadEncoder;
+}
+
+void ContextDawn::uploadBuffer(const dawn::Buffer &buffer, const void *data, uint32_t size)
+{
+    dawn::CommandEncoder encoder = getUploadEncoder();
+    dawn::Buffer stagingBuffer;
+    uint32_t offset;
+    mStagingAllocator.allocate(data, size, &stagingBuffer, &offset);
+    encoder.CopyBufferToBuffer(stagingBuffer, offset, buffer, 0, size);
+}
+
+void ContextDawn::uploadTexture(const dawn::Texture &texture,
+                                uint32_t level,
+                                uint32_t slice,
+                                const void *pixels,
+                                uint32_t rowPitch,
+                                uint32_t width,
+                                uint32_t height)
+{
+    dawn::CommandEncoder encoder = getUploadEncoder();
+    dawn::Buffer stagingBuffer;
+    uint32_t offset;
+    mStagingAllocator.allocate(pixels, rowPitch * height, &stagingBuffer, &offset);
+
+    dawn::BufferCopyView bufferCopyView =
+        createBufferCopyView(stagingBuffer, offset, rowPitch, height);
+    dawn::TextureCopyView textureCopyView = createTextureCopyView(texture, level, slice, {0, 0, 0});
+    dawn::Extent3D copySize               = {width, height, 1};
+    encoder.CopyBufferToTexture(&bufferCopyView, &textureCopyView, &copySize);
+}
+
+bool ContextDawn::compileSpirv(utils::ShaderStage stage,
+                               const std::string &str,
+                               const std::string &cachePath,
+                               SpirvShader *shader) const
 {
-    dawn::CommandEncoder encoder = mDevice.CreateCommandEncoder();
-    encoder.CopyBufferToTexture(&bufferCopyView, &textureCopyView, &ext3D);
-    dawn::CommandBuffer copy = encoder.Finish();
-    return copy;
+    uint64_t hash       = getSpirvCacheHash(stage, str);
+    shader->cached      = false;
+    shader->compileTime = 0.0;
+
+    // SPIR-V doesn't depend on the device, so caches can be packed into the asset pack.
+    Resource cache;
+    if (mResourceHelper->openResource(cachePath, &cache) &&
+        cache.size() >= sizeof(SpirvCacheHeader))
+    {
+        SpirvCacheHeader header;
+        memcpy(&header, cache.data(), sizeof(header));
+        if (memcmp(header.magic, kSpirvCacheMagic, sizeof(kSpirvCacheMagic)) == 0 &&
+            header.version == kSpirvCacheVersion && header.hash == hash &&
+            cache.size() == sizeof(header) + header.wordCount * sizeof(uint32_t))
+        {
+            // The words are copied out, as a view of the cache may not be aligned to 4 bytes.
+            shader->words.resize(header.wordCount);
+            memcpy(shader->words.data(), cache.data() + sizeof(header),
+                   shader->words.size() * sizeof(uint32_t));
+            shader->cached = true;
+            return true;
+        }
+    }
+
+    // A compiler is created for each shader, as compilers can't be shared between threads.
+    auto start = std::chrono::steady_clock::now();
+    shaderc::Compiler compiler;
+    shaderc::SpvCompilationResult result =
+        compiler.CompileGlslToSpv(str.c_str(), str.size(), getShaderKind(stage), cachePath.c_str());
+    shader->compileTime =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        std::cerr << result.GetErrorMessage();
+        return false;
+    }
+
+    shader->words.assign(result.cbegin(), result.cend());
+    writeSpirvCache(cachePath, hash, shader->words.data(),
+                    static_cast<uint32_t>(shader->words.size()));
+    return true;
 }
 
-dawn::ShaderModule ContextDawn::createShaderModule(utils::ShaderStage stage,
-                                                   const std::string &str) const
+dawn::ShaderModule ContextDawn::createShaderModule(const SpirvShader &shader)
 {
-    return utils::CreateShaderModule(mDevice, stage, str.c_str());
+    if (shader.cached)
+    {
+        ++mSpirvCacheHits;
+    }
+    else
+    {
+        ++mSpirvCacheMisses;
+        mShaderCompileTime += shader.compileTime;
+    }
+    if (shader.words.empty())
+    {
+        return {};
+    }
+
+    dawn::ShaderModuleDescriptor descriptor;
+    descriptor.codeSize = static_cast<uint32_t>(shader.words.size());
+    descriptor.code     = shader.words.data();
+    return mDevice.CreateShaderModule(&descriptor);
 }
 
 dawn::BindGroupLayout ContextDawn::MakeBindGroupLayout(
@@ -433,6 +706,39 @@ dawn::RenderPipeline ContextDawn::createRenderPipeline(
     return mPipeline;
 }
 
+void ContextDawn::setInterleavedVertexInput(utils::ComboVertexInputDescriptor *descriptor,
+                                            const std::vector<VertexElement> &elements,
+                                            int stride,
+                                            int locationCount) const
+{
+    static const char *const kLocationNames[] = {"position", "normal", "texCoord", "tangent",
+                                                 "binormal"};
+
+    uint32_t attributeCount = 0;
+    for (const auto &element : elements)
+    {
+        for (int location = 0; location < locationCount; ++location)
+        {
+            if (element.name != kLocationNames[location])
+            {
+                continue;
+            }
+
+            auto &attribute          = descriptor->cAttributes[attributeCount];
+            attribute.format         = getVertexFormat(element);
+            attribute.shaderLocation = location;
+            attribute.offset         = element.offset;
+            ++attributeCount;
+        }
+    }
+
+    descriptor->cBuffers[0].attributeCount = attributeCount;
+    descriptor->cBuffers[0].stride         = stride;
+    descriptor->cBuffers[0].attributes     = &descriptor->cAttributes[0];
+    descriptor->bufferCount                = 1;
+    descriptor->indexFormat                = dawn::IndexFormat::Uint16;
+}
+
 dawn::TextureView ContextDawn::createMultisampledRenderTargetView() const
 {
     dawn::TextureDescriptor descriptor;
@@ -480,11 +786,59 @@ void ContextDawn::setBufferData(const dawn::Buffer& buffer, uint32_t start, uint
     buffer.SetSubData(start, size, reinterpret_cast<const uint8_t*>(pixels));
 }
 
+void ContextDawn::setPipeline(const dawn::RenderPipeline &pipeline) const
+{
+    if (pipeline.Get() == mBoundPipeline.Get())
+    {
+        ++mRenderPassStats.skippedStateChanges;
+        return;
+    }
+
+    mRenderPass.SetPipeline(pipeline);
+    mBoundPipeline = pipeline;
+    ++mRenderPassStats.pipelineSwitches;
+}
+
+void ContextDawn::setBindGroup(uint32_t index,
+                               const dawn::BindGroup &bindGroup,
+                               uint32_t dynamicOffsetCount,
+                               const uint64_t *dynamicOffsets) const
+{
+    ASSERT(index < kBindGroupCount);
+    if (dynamicOffsetCount == 0 && bindGroup.Get() == mBoundBindGroups[index].Get())
+    {
+        ++mRenderPassStats.skippedStateChanges;
+        return;
+    }
+
+    mRenderPass.SetBindGroup(index, bindGroup, dynamicOffsetCount, dynamicOffsets);
+    mBoundBindGroups[index] = bindGroup;
+    ++mRenderPassStats.bindGroupSwitches;
+}
+
+void ContextDawn::drawIndexed(uint32_t indexCount, uint32_t instanceCount) const
+{
+    mRenderPass.DrawIndexed(indexCount, instanceCount, 0, 0, 0);
+    ++mRenderPassStats.drawCalls;
+}
+
+ContextDawn::FishTextureArrayState *ContextDawn::getFishTextureArrayState(
+    const TextureDawn *diffuse) const
+{
+    return &mFishTextureArrayStates[diffuse];
+}
+
 dawn::BindGroup ContextDawn::makeBindGroup(
     const dawn::BindGroupLayout &layout,
     std::initializer_list<utils::BindingInitializationHelper> bindingsInitializer) const
 {
-    return utils::MakeBindGroup(mDevice, layout, bindingsInitializer);
+    auto start = std::chrono::steady_clock::now();
+    dawn::BindGroup bindGroup = utils::MakeBindGroup(mDevice, layout, bindingsInitializer);
+    mBindGroupCreationTime +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++mBindGroupCount;
+
+    return bindGroup;
 }
 
 void ContextDawn::initGeneralResources(Aquarium* aquarium)
@@ -534,24 +888,26 @@ void ContextDawn::updateWorldlUniforms(Aquarium* aquarium)
                   &aquarium->lightWorldPositionUniform);
 }
 
-Buffer *ContextDawn::createBuffer(int numComponents, std::vector<float> *buf, bool isIndex)
+Buffer *ContextDawn::createBuffer(int numComponents, const float *buf, size_t size, bool isIndex)
 {
-    Buffer *buffer = new BufferDawn(this, static_cast<int>(buf->size()), numComponents, buf, isIndex);
+    Buffer *buffer = new BufferDawn(this, static_cast<int>(size), numComponents, buf, isIndex);
     return buffer;
 }
 
-Buffer *ContextDawn::createBuffer(int numComponents, std::vector<unsigned short> *buf, bool isIndex)
+Buffer *ContextDawn::createBuffer(int numComponents,
+                                  const unsigned short *buf,
+                                  size_t size,
+                                  bool isIndex)
 {
-    Buffer *buffer =
-        new BufferDawn(this, static_cast<int>(buf->size()), numComponents, buf, isIndex);
+    Buffer *buffer = new BufferDawn(this, static_cast<int>(size), numComponents, buf, isIndex);
     return buffer;
 }
 
-Program *ContextDawn::createProgram(const std::string &mVId, const std::string &mFId)
+Program *ContextDawn::createProgram(const std::string &mVId,
+                                    const std::string &mFId,
+                                    uint32_t features)
 {
-    ProgramDawn *program = new ProgramDawn(this, mVId, mFId);
-    program->loadProgram();
-
+    ProgramDawn *program = new ProgramDawn(this, mVId, mFId, features);
     return program;
 }
 
@@ -580,16 +936,53 @@ void ContextDawn::DoFlush()
 
     mSwapchain.Present(mBackbuffer);
 
+    // Drop the staging buffers once the queue is done copying from them. Ticking the device
+    // lets the fence advance.
+    if (mStagingAllocator.hasReleasable())
+    {
+        mDevice.Tick();
+        mStagingAllocator.releaseCompleted(mUploadFence.GetCompletedValue());
+    }
+
     glfwPollEvents();
 }
 
 void ContextDawn::FlushInit()
 {
-    queue.Submit(mCommandBuffers.size(), mCommandBuffers.data());
+    if (mUploadCount == 0)
+    {
+        return;
+    }
+
+    dawn::CommandBuffer uploads = mUploadEncoder.Finish();
+    queue.Submit(1, &uploads);
+    mUploadEncoder = nullptr;
+
+    // The staging buffers are released by DoFlush() once the fence passes the serial.
+    queue.Signal(mUploadFence, ++mUploadSerial);
+    mStagingAllocator.submit(mUploadSerial);
+
+    std::cout << "Submitted " << mUploadCount << " uploads in 1 command buffer from "
+              << mStagingAllocator.getStagingBufferCount() << " staging buffers of "
+              << mStagingAllocator.getStagingBufferSize() / (1024 * 1024) << " MB." << std::endl;
+    mUploadCount = 0;
 }
 
 void ContextDawn::Terminate()
 {
+    // The overlay isn't shown on Linux, so the counts of the last frame are printed as well.
+    std::cout << "Last frame recorded " << mRenderPassStats.drawCalls << " draw calls, "
+              << mRenderPassStats.pipelineSwitches << " pipeline switches and "
+              << mRenderPassStats.bindGroupSwitches << " bind group switches, and skipped "
+              << mRenderPassStats.skippedStateChanges << " redundant state changes."
+              << std::endl;
+    std::cout << "Created " << mSamplers.size() << " samplers for " << mSamplerRequestCount
+              << " textures, and " << mBindGroupCount << " bind groups in "
+              << mBindGroupCreationTime * 1000.0 << "ms." << std::endl;
+    std::cout << "SPIR-V cache: " << mSpirvCacheHits << " hits, " << mSpirvCacheMisses
+              << " misses, " << mShaderCompileTime * 1000.0 << "ms compiling on workers."
+              << std::endl;
+
     glfwTerminate();
 }
 
@@ -598,7 +991,7 @@ void ContextDawn::showWindow()
     glfwShowWindow(mWindow);
 }
 
-void ContextDawn::showFPS(const FPSTimer &fpsTimer)
+void ContextDawn::showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats)
 {
     // TODO(yizhou): Dawn doesn't support recreating swap chain if framebuffer size is changed. This will cause 
     // 'AcquireNextImage' returns an error code on linux vulkan backend. The error is 'VK_ERROR_OUT_OF_DATE_KHR'.
@@ -633,6 +1026,13 @@ void ContextDawn::showFPS(const FPSTimer &fpsTimer)
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                     1000.0f / fpsTimer.getAverageFPS(), fpsTimer.getAverageFPS());
+
+        ImGui::Text("Models drawn %d, culled %d", cullingStats.drawnModels,
+                    cullingStats.culledModels);
+        ImGui::Text("Fish drawn %d, culled %d", cullingStats.drawnFish, cullingStats.culledFish);
+        ImGui::Text("Draw calls %d, pipeline switches %d, bind group switches %d, skipped %d",
+                    mRenderPassStats.drawCalls, mRenderPassStats.pipelineSwitches,
+                    mRenderPassStats.bindGroupSwitches, mRenderPassStats.skippedStateChanges);
         ImGui::End();
     }
 
@@ -680,6 +1080,14 @@ void ContextDawn::preFrame()
     }
 
     mRenderPass = mCommandEncoder.BeginRenderPass(&mRenderPassDescriptor);
+
+    // Nothing is bound in a new render pass.
+    mBoundPipeline = nullptr;
+    for (auto &bindGroup : mBoundBindGroups)
+    {
+        bindGroup = nullptr;
+    }
+    mRenderPassStats = {};
 }
 
 Model * ContextDawn::createModel(Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend)
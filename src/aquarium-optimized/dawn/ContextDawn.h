@@ -9,19 +9,32 @@
 #ifndef CONTEXTDAWN_H
 #define CONTEXTDAWN_H
 
+#include <map>
+
 #include <dawn/dawncpp.h>
 #include <dawn_native/DawnNative.h>
 
 #include "GLFW/glfw3.h"
+#include "utils/ComboRenderPipelineDescriptor.h"
 #include "utils/DawnHelpers.h"
 
 #include "../Context.h"
+#include "../Mesh.h"
+#include "StagingAllocatorDawn.h"
 
 class TextureDawn;
 class BufferDawn;
 class ProgramDawn;
 enum BACKENDTYPE: short;
 
+// The SPIR-V of a shader, read from the cache or compiled on a worker.
+struct SpirvShader
+{
+    std::vector<uint32_t> words;  // Empty if the shader failed to compile.
+    bool cached;
+    double compileTime;  // In seconds.
+};
+
 class ContextDawn : public Context
 {
   public:
@@ -37,37 +50,63 @@ class ContextDawn : public Context
     void FlushInit() override;
     void Terminate() override;
     void showWindow() override;
-    void showFPS(const FPSTimer &fpsTimer) override;
+    void showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats) override;
     void destoryImgUI() override;
 
     void preFrame() override;
 
     Model *createModel(Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
-    Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) override;
     Buffer *createBuffer(int numComponents,
-                         std::vector<unsigned short> *buffer,
+                         const float *buffer,
+                         size_t size,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const unsigned short *buffer,
+                         size_t size,
                          bool isIndex) override;
 
-    Program *createProgram(const std::string &mVId, const std::string &mFId) override;
+    Program *createProgram(const std::string &mVId,
+                           const std::string &mFId,
+                           uint32_t features) override;
 
     Texture *createTexture(const std::string &name, const std::string &url) override;
     Texture *createTexture(const std::string &name, const std::vector<std::string> &urls) override;
+    Texture *createTextureArray(const std::string &name,
+                                const std::vector<std::string> &urls) override;
     dawn::Texture createTexture(const dawn::TextureDescriptor &descriptor) const;
     dawn::Sampler createSampler(const dawn::SamplerDescriptor &descriptor) const;
+    // Get the sampler of the descriptor, which is shared by all of the textures sampled with the
+    // same state, so bind groups referencing them don't differ by their samplers.
+    dawn::Sampler getSampler(const dawn::SamplerDescriptor &descriptor);
     dawn::Buffer createBufferFromData(const void* pixels, int size, dawn::BufferUsageBit usage) const;
     dawn::BufferCopyView createBufferCopyView(const dawn::Buffer &buffer,
         uint32_t offset,
         uint32_t rowPitch,
         uint32_t imageHeight) const;
-    dawn::CommandBuffer copyBufferToTexture(const dawn::BufferCopyView &bufferCopyView,
-                                            const dawn::TextureCopyView &textureCopyView,
-                                            const dawn::Extent3D &ext3D) const;
+    // Stage data, and record a copy from it into buffer, which needs CopyDst usage.
+    void uploadBuffer(const dawn::Buffer &buffer, const void *data, uint32_t size);
+    // Stage height rows of pixels rowPitch bytes apart, and record a copy from them into a level
+    // and an array layer of texture. rowPitch must be a multiple of 256.
+    void uploadTexture(const dawn::Texture &texture,
+                       uint32_t level,
+                       uint32_t slice,
+                       const void *pixels,
+                       uint32_t rowPitch,
+                       uint32_t width,
+                       uint32_t height);
 
     dawn::TextureCopyView createTextureCopyView(dawn::Texture texture,
                                                 uint32_t level,
                                                 uint32_t slice,
                                                 dawn::Origin3D origin);
-    dawn::ShaderModule createShaderModule(utils::ShaderStage stage, const std::string &str) const;
+    // Read the SPIR-V cached at cachePath if it's compiled from the same source for the same
+    // stage by the same compiler, otherwise compile the source and cache its SPIR-V. Doesn't touch
+    // the device, so it's safe to call on a worker thread.
+    bool compileSpirv(utils::ShaderStage stage,
+                      const std::string &str,
+                      const std::string &cachePath,
+                      SpirvShader *shader) const;
+    dawn::ShaderModule createShaderModule(const SpirvShader &shader);
     dawn::BindGroupLayout  MakeBindGroupLayout(
         std::initializer_list<dawn::BindGroupLayoutBinding> bindingsInitializer) const;
     dawn::PipelineLayout MakeBasicPipelineLayout(
@@ -77,6 +116,13 @@ class ContextDawn : public Context
         ProgramDawn *mProgramDawn,
         const dawn::VertexInputDescriptor &mVertexInputDescriptor,
         bool enableBlend) const;
+    // Describe an interleaved vertex buffer in slot 0. Attributes are mapped to the shader
+    // locations of position, normal, texCoord, tangent and binormal, and only the first
+    // locationCount locations are used. stride is the size of a vertex in bytes.
+    void setInterleavedVertexInput(utils::ComboVertexInputDescriptor *descriptor,
+                                   const std::vector<VertexElement> &elements,
+                                   int stride,
+                                   int locationCount) const;
     dawn::TextureView createMultisampledRenderTargetView() const;
     dawn::TextureView createDepthStencilView() const;
     dawn::Buffer createBuffer(uint32_t size, dawn::BufferUsageBit bit) const;
@@ -90,7 +136,32 @@ class ContextDawn : public Context
     const dawn::Device &getDevice() const { return mDevice; }
     const dawn::RenderPassEncoder &getRenderPass() const { return mRenderPass; }
 
-    std::vector<dawn::CommandBuffer> mCommandBuffers;
+    // Record the state into the render pass unless it's bound already, and count the commands
+    // of the frame. Bind groups with dynamic offsets are always recorded.
+    void setPipeline(const dawn::RenderPipeline &pipeline) const;
+    void setBindGroup(uint32_t index,
+                      const dawn::BindGroup &bindGroup,
+                      uint32_t dynamicOffsetCount    = 0,
+                      const uint64_t *dynamicOffsets = nullptr) const;
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount) const;
+
+    // Objects shared by the instanced fish species sampling the same texture arrays. They are
+    // created by the first species, and reused by the others.
+    struct FishTextureArrayState
+    {
+        dawn::BindGroupLayout groupLayoutModel;
+        dawn::PipelineLayout pipelineLayout;
+        dawn::RenderPipeline pipeline;
+        // Vertex layout of the species the pipeline is created for.
+        std::vector<VertexElement> vertexElements;
+        int vertexStride;
+        dawn::Buffer fishVertexBuffer;
+        dawn::Buffer lightFactorBuffer;
+        dawn::BindGroup bindGroupModel;
+    };
+    // Keyed by the diffuse texture array.
+    FishTextureArrayState *getFishTextureArrayState(const TextureDawn *diffuse) const;
+
     dawn::Queue queue;
 
     dawn::BindGroupLayout groupLayoutGeneral;
@@ -108,6 +179,7 @@ class ContextDawn : public Context
         const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset);
     void initAvailableToggleBitset(BACKENDTYPE backendType) override;
     static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
+    dawn::CommandEncoder getUploadEncoder();
 
     // TODO(jiawei.shao@intel.com): remove dawn::TextureUsageBit::CopyDst when the bug in Dawn is
     // fixed.
@@ -130,6 +202,38 @@ class ContextDawn : public Context
     dawn::BindGroup mBindGroup;
     dawn::TextureFormat mPreferredSwapChainFormat;
 
+    // Uploads are recorded into one encoder and submitted by FlushInit().
+    dawn::CommandEncoder mUploadEncoder;
+    int mUploadCount;
+    StagingAllocatorDawn mStagingAllocator;
+    dawn::Fence mUploadFence;
+    uint64_t mUploadSerial;
+
+    // Commands recorded into the render pass of the frame.
+    struct RenderPassStats
+    {
+        int drawCalls;
+        int pipelineSwitches;
+        int bindGroupSwitches;
+        int skippedStateChanges;
+    };
+    static constexpr uint32_t kBindGroupCount = 4;
+    // State bound in the render pass. Models record through a const context, so it's mutable.
+    mutable dawn::RenderPipeline mBoundPipeline;
+    mutable dawn::BindGroup mBoundBindGroups[kBindGroupCount];
+    mutable RenderPassStats mRenderPassStats;
+    mutable std::map<const TextureDawn *, FishTextureArrayState> mFishTextureArrayStates;
+
+    std::vector<std::pair<dawn::SamplerDescriptor, dawn::Sampler>> mSamplers;
+    int mSamplerRequestCount;
+    // Bind groups are made by models through a const context.
+    mutable int mBindGroupCount;
+    mutable double mBindGroupCreationTime;  // In seconds.
+
+    int mSpirvCacheHits;
+    int mSpirvCacheMisses;
+    double mShaderCompileTime;  // In seconds, spent in shaderc on misses.
+
     dawn::Buffer mLightWorldPositionBuffer;
     dawn::Buffer mLightBuffer;
     dawn::Buffer mFogBuffer;
@@ -76,6 +76,8 @@ class FishModelDawn : public FishModel
     BufferDawn *mBiNormalBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
 
   private:
     utils::ComboVertexInputDescriptor mVertexInputDescriptor;
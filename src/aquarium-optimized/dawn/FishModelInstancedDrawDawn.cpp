@@ -7,6 +7,38 @@
 
 #include "BufferDawn.h"
 #include "FishModelInstancedDrawDawn.h"
+#include "TextureDawn.h"
+
+namespace {
+
+// The vertex uniforms of all of the species sharing texture arrays are in one uniform buffer,
+// indexed by the layer of the species. std140 pads each of them to a vec4.
+constexpr uint32_t kFishVertexUniformsStride = 16;
+constexpr int kMaxFishTextureLayers          = 8;
+
+bool isSameVertexLayout(const std::vector<VertexElement> &elements,
+                        int stride,
+                        const std::vector<VertexElement> &otherElements,
+                        int otherStride)
+{
+    if (stride != otherStride || elements.size() != otherElements.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const VertexElement &element = elements[i];
+        const VertexElement &other   = otherElements[i];
+        if (element.name != other.name || element.format != other.format ||
+            element.numComponents != other.numComponents || element.offset != other.offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
 
 FishModelInstancedDrawDawn::FishModelInstancedDrawDawn(const Context *context,
                                                        Aquarium *aquarium,
@@ -47,58 +79,84 @@ void FishModelInstancedDrawDawn::init()
     mTangentBuffer  = static_cast<BufferDawn *>(bufferMap["tangent"]);
     mBiNormalBuffer = static_cast<BufferDawn *>(bufferMap["binormal"]);
     mIndicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
+    mVertexBuffer   = static_cast<BufferDawn *>(bufferMap["vertices"]);
 
     mFishPersBuffer = mContextDawn->createBuffer(
         sizeof(FishPer) * instance, dawn::BufferUsageBit::Vertex | dawn::BufferUsageBit::CopyDst);
 
-    mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
-    mVertexInputDescriptor.cAttributes[0].offset         = 0;
-    mVertexInputDescriptor.cBuffers[0].attributes        = &mVertexInputDescriptor.cAttributes[0];
-    mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
-    mVertexInputDescriptor.cAttributes[1].offset         = 0;
-    mVertexInputDescriptor.cBuffers[1].attributes        = &mVertexInputDescriptor.cAttributes[1];
-    mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
-    mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
-    mVertexInputDescriptor.cAttributes[2].offset         = 0;
-    mVertexInputDescriptor.cBuffers[2].attributes        = &mVertexInputDescriptor.cAttributes[2];
-    mVertexInputDescriptor.cBuffers[3].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[3].stride            = mTangentBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[3].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[3].shaderLocation = 3;
-    mVertexInputDescriptor.cAttributes[3].offset         = 0;
-    mVertexInputDescriptor.cBuffers[3].attributes        = &mVertexInputDescriptor.cAttributes[3];
-    mVertexInputDescriptor.cBuffers[4].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[4].stride            = mBiNormalBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[4].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[4].shaderLocation = 4;
-    mVertexInputDescriptor.cAttributes[4].offset         = offsetof(FishPer, worldPosition);
-    mVertexInputDescriptor.cBuffers[4].attributes        = &mVertexInputDescriptor.cAttributes[4];
-    mVertexInputDescriptor.cBuffers[5].attributeCount    = 4;
-    mVertexInputDescriptor.cBuffers[5].stride            = sizeof(FishPer);
-    mVertexInputDescriptor.cAttributes[5].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[5].shaderLocation = 5;
-    mVertexInputDescriptor.cAttributes[5].offset         = 0;
-    mVertexInputDescriptor.cAttributes[6].format         = dawn::VertexFormat::Float;
-    mVertexInputDescriptor.cAttributes[6].shaderLocation = 6;
-    mVertexInputDescriptor.cAttributes[6].offset         = offsetof(FishPer, scale);
-    mVertexInputDescriptor.cAttributes[7].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[7].shaderLocation = 7;
-    mVertexInputDescriptor.cAttributes[7].offset         = offsetof(FishPer, nextPosition);
-    mVertexInputDescriptor.cAttributes[8].format         = dawn::VertexFormat::Float;
-    mVertexInputDescriptor.cAttributes[8].shaderLocation = 8;
-    mVertexInputDescriptor.cAttributes[9].offset         = offsetof(FishPer, time);
-    mVertexInputDescriptor.cBuffers[5].attributes        = &mVertexInputDescriptor.cAttributes[5];
-    mVertexInputDescriptor.cBuffers[5].stepMode          = dawn::InputStepMode::Instance;
-    mVertexInputDescriptor.bufferCount                   = 6;
-    mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    if (mVertexBuffer != nullptr)
+    {
+        mContextDawn->setInterleavedVertexInput(&mVertexInputDescriptor, vertexElements,
+                                                vertexStride, 5);
+    }
+    else
+    {
+        mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
+        mVertexInputDescriptor.cAttributes[0].offset         = 0;
+        mVertexInputDescriptor.cBuffers[0].attributes = &mVertexInputDescriptor.cAttributes[0];
+        mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
+        mVertexInputDescriptor.cAttributes[1].offset         = 0;
+        mVertexInputDescriptor.cBuffers[1].attributes = &mVertexInputDescriptor.cAttributes[1];
+        mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
+        mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
+        mVertexInputDescriptor.cAttributes[2].offset         = 0;
+        mVertexInputDescriptor.cBuffers[2].attributes = &mVertexInputDescriptor.cAttributes[2];
+        mVertexInputDescriptor.cBuffers[3].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[3].stride            = mTangentBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[3].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[3].shaderLocation = 3;
+        mVertexInputDescriptor.cAttributes[3].offset         = 0;
+        mVertexInputDescriptor.cBuffers[3].attributes = &mVertexInputDescriptor.cAttributes[3];
+        mVertexInputDescriptor.cBuffers[4].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[4].stride            = mBiNormalBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[4].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[4].shaderLocation = 4;
+        mVertexInputDescriptor.cAttributes[4].offset         = offsetof(FishPer, worldPosition);
+        mVertexInputDescriptor.cBuffers[4].attributes = &mVertexInputDescriptor.cAttributes[4];
+        mVertexInputDescriptor.bufferCount                   = 5;
+        mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    }
+
+    // Per instance attributes are in the buffer after the vertex buffers. The layer is only read
+    // with texture arrays.
+    bool useTextureArrays =
+        mDiffuseTexture->getTextureViewDimension() == dawn::TextureViewDimension::e2DArray;
+    uint32_t instanceSlot = mVertexInputDescriptor.bufferCount;
+    mVertexInputDescriptor.cBuffers[instanceSlot].attributeCount = useTextureArrays ? 5 : 4;
+    mVertexInputDescriptor.cBuffers[instanceSlot].stride         = sizeof(FishPer);
+    mVertexInputDescriptor.cAttributes[5].format                 = dawn::VertexFormat::Float3;
+    mVertexInputDescriptor.cAttributes[5].shaderLocation         = 5;
+    mVertexInputDescriptor.cAttributes[5].offset                 = 0;
+    mVertexInputDescriptor.cAttributes[6].format                 = dawn::VertexFormat::Float;
+    mVertexInputDescriptor.cAttributes[6].shaderLocation         = 6;
+    mVertexInputDescriptor.cAttributes[6].offset                 = offsetof(FishPer, scale);
+    mVertexInputDescriptor.cAttributes[7].format                 = dawn::VertexFormat::Float3;
+    mVertexInputDescriptor.cAttributes[7].shaderLocation         = 7;
+    mVertexInputDescriptor.cAttributes[7].offset                 = offsetof(FishPer, nextPosition);
+    mVertexInputDescriptor.cAttributes[8].format                 = dawn::VertexFormat::Float;
+    mVertexInputDescriptor.cAttributes[8].shaderLocation         = 8;
+    mVertexInputDescriptor.cAttributes[8].offset                 = offsetof(FishPer, time);
+    mVertexInputDescriptor.cAttributes[9].format                 = dawn::VertexFormat::Float;
+    mVertexInputDescriptor.cAttributes[9].shaderLocation         = 9;
+    mVertexInputDescriptor.cAttributes[9].offset                 = offsetof(FishPer, layer);
+    mVertexInputDescriptor.cBuffers[instanceSlot].attributes =
+        &mVertexInputDescriptor.cAttributes[5];
+    mVertexInputDescriptor.cBuffers[instanceSlot].stepMode       = dawn::InputStepMode::Instance;
+    mVertexInputDescriptor.bufferCount                           = instanceSlot + 1;
+
+    if (useTextureArrays)
+    {
+        initTextureArrays();
+        return;
+    }
 
     if (mSkyboxTexture && mReflectionTexture)
     {
@@ -175,30 +233,135 @@ void FishModelInstancedDrawDawn::init()
                                 &mFishVertexUniforms);
 }
 
+// Species sampling the same texture arrays share the bind group of the model, and the pipeline
+// if their vertex layouts match, so drawing them one after another doesn't switch either.
+void FishModelInstancedDrawDawn::initTextureArrays()
+{
+    ASSERT(mTextureLayer < kMaxFishTextureLayers);
+
+    mGroupLayoutPer = mContextDawn->MakeBindGroupLayout({
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+    });
+
+    ContextDawn::FishTextureArrayState *state =
+        mContextDawn->getFishTextureArrayState(mDiffuseTexture);
+    if (state->bindGroupModel.Get() == nullptr)
+    {
+        uint32_t fishVertexSize = kFishVertexUniformsStride * kMaxFishTextureLayers;
+        state->fishVertexBuffer = mContextDawn->createBuffer(
+            fishVertexSize, dawn::BufferUsageBit::CopyDst | dawn::BufferUsageBit::Uniform);
+        state->lightFactorBuffer = mContextDawn->createBufferFromData(
+            &mLightFactorUniforms, sizeof(LightFactorUniforms),
+            dawn::BufferUsageBit::CopyDst | dawn::BufferUsageBit::Uniform);
+
+        if (mSkyboxTexture && mReflectionTexture)
+        {
+            state->groupLayoutModel = mContextDawn->MakeBindGroupLayout({
+                {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+                {1, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer},
+                {2, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
+                {3, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
+                {4, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+                {5, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+                {6, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+                {7, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+            });
+            state->bindGroupModel = mContextDawn->makeBindGroup(
+                state->groupLayoutModel,
+                {{0, state->fishVertexBuffer, 0, fishVertexSize},
+                 {1, state->lightFactorBuffer, 0, sizeof(LightFactorUniforms)},
+                 {2, mReflectionTexture->getSampler()},
+                 {3, mSkyboxTexture->getSampler()},
+                 {4, mDiffuseTexture->getTextureView()},
+                 {5, mNormalTexture->getTextureView()},
+                 {6, mReflectionTexture->getTextureView()},
+                 {7, mSkyboxTexture->getTextureView()}});
+        }
+        else
+        {
+            state->groupLayoutModel = mContextDawn->MakeBindGroupLayout({
+                {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+                {1, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer},
+                {2, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
+                {3, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+                {4, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
+            });
+            state->bindGroupModel = mContextDawn->makeBindGroup(
+                state->groupLayoutModel,
+                {{0, state->fishVertexBuffer, 0, fishVertexSize},
+                 {1, state->lightFactorBuffer, 0, sizeof(LightFactorUniforms)},
+                 {2, mDiffuseTexture->getSampler()},
+                 {3, mDiffuseTexture->getTextureView()},
+                 {4, mNormalTexture->getTextureView()}});
+        }
+
+        state->pipelineLayout = mContextDawn->MakeBasicPipelineLayout({
+            mContextDawn->groupLayoutGeneral,
+            mContextDawn->groupLayoutWorld,
+            state->groupLayoutModel,
+            mGroupLayoutPer,
+        });
+        state->pipeline = mContextDawn->createRenderPipeline(
+            state->pipelineLayout, mProgramDawn, mVertexInputDescriptor, mBlend);
+        state->vertexElements = vertexElements;
+        state->vertexStride   = vertexStride;
+    }
+
+    mGroupLayoutModel  = state->groupLayoutModel;
+    mPipelineLayout    = state->pipelineLayout;
+    mBindGroupModel    = state->bindGroupModel;
+    mFishVertexBuffer  = state->fishVertexBuffer;
+    mLightFactorBuffer = state->lightFactorBuffer;
+
+    // Quantized attributes may have other formats than those of the first species.
+    if (isSameVertexLayout(vertexElements, vertexStride, state->vertexElements,
+                           state->vertexStride))
+    {
+        mPipeline = state->pipeline;
+    }
+    else
+    {
+        mPipeline = mContextDawn->createRenderPipeline(mPipelineLayout, mProgramDawn,
+                                                       mVertexInputDescriptor, mBlend);
+    }
+
+    mContextDawn->setBufferData(mFishVertexBuffer, kFishVertexUniformsStride * mTextureLayer,
+                                sizeof(FishVertexUniforms), &mFishVertexUniforms);
+}
+
 void FishModelInstancedDrawDawn::prepareForDraw() const {}
 
 void FishModelInstancedDrawDawn::draw()
 {
-    if (instance == 0)
+    if (mCurInstance == 0)
         return;
 
     uint64_t vertexBufferOffsets[1] = {0};
 
-    mContextDawn->setBufferData(mFishPersBuffer, 0, sizeof(FishPer) * instance, mFishPers);
+    mContextDawn->setBufferData(mFishPersBuffer, 0, sizeof(FishPer) * mCurInstance, mFishPers);
+
+    mContextDawn->setPipeline(mPipeline);
+    mContextDawn->setBindGroup(0, mContextDawn->bindGroupGeneral);
+    mContextDawn->setBindGroup(1, mContextDawn->bindGroupWorld);
+    mContextDawn->setBindGroup(2, mBindGroupModel);
 
     dawn::RenderPassEncoder pass = mContextDawn->getRenderPass();
-    pass.SetPipeline(mPipeline);
-    pass.SetBindGroup(0, mContextDawn->bindGroupGeneral, 0, nullptr);
-    pass.SetBindGroup(1, mContextDawn->bindGroupWorld, 0, nullptr);
-    pass.SetBindGroup(2, mBindGroupModel, 0, nullptr);
-    pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(5, 1, &mFishPersBuffer, vertexBufferOffsets);
+    if (mVertexBuffer != nullptr)
+    {
+        pass.SetVertexBuffers(0, 1, &mVertexBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(1, 1, &mFishPersBuffer, vertexBufferOffsets);
+    }
+    else
+    {
+        pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(5, 1, &mFishPersBuffer, vertexBufferOffsets);
+    }
     pass.SetIndexBuffer(mIndicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(mIndicesBuffer->getTotalComponents(), instance, 0, 0, 0);
+    mContextDawn->drawIndexed(mIndicesBuffer->getTotalComponents(), mCurInstance);
 }
 
 void FishModelInstancedDrawDawn::updatePerInstanceUniforms(const WorldUniforms &worldUniforms) {}
@@ -221,6 +384,7 @@ void FishModelInstancedDrawDawn::updateFishPerUniforms(float x,
     mFishPers[index].nextPosition[2]  = nextZ;
     mFishPers[index].scale            = scale;
     mFishPers[index].time             = time;
+    mFishPers[index].layer            = static_cast<float>(mTextureLayer);
 }
 
 FishModelInstancedDrawDawn::~FishModelInstancedDrawDawn()
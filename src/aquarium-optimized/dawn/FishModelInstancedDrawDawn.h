@@ -60,6 +60,7 @@ class FishModelInstancedDrawDawn : public FishModel
         float scale;
         float nextPosition[3];
         float time;
+        float layer;  // Of the species in the fish texture arrays.
     };
     FishPer *mFishPers;
 
@@ -75,8 +76,12 @@ class FishModelInstancedDrawDawn : public FishModel
     BufferDawn *mBiNormalBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
 
   private:
+    void initTextureArrays();
+
     utils::ComboVertexInputDescriptor mVertexInputDescriptor;
     dawn::RenderPipeline mPipeline;
 
@@ -48,11 +48,18 @@ void GenericModelDawn::init()
     mTangentBuffer  = static_cast<BufferDawn *>(bufferMap["tangent"]);
     mBiNormalBuffer = static_cast<BufferDawn *>(bufferMap["binormal"]);
     mIndicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
+    mVertexBuffer   = static_cast<BufferDawn *>(bufferMap["vertices"]);
 
     // Generic models use reflection, normal or diffuse shaders, of which groupLayouts are
     // diiferent in texture binding.  MODELGLOBEBASE use diffuse shader though it contains
     // normal and reflection textures.
-    if (mNormalTexture && mName != MODELNAME::MODELGLOBEBASE)
+    if (mVertexBuffer != nullptr)
+    {
+        int locationCount = mNormalTexture && mName != MODELNAME::MODELGLOBEBASE ? 5 : 3;
+        mContextDawn->setInterleavedVertexInput(&mVertexInputDescriptor, vertexElements,
+                                                vertexStride, locationCount);
+    }
+    else if (mNormalTexture && mName != MODELNAME::MODELGLOBEBASE)
     {
         mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
         mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
@@ -215,22 +222,29 @@ void GenericModelDawn::draw()
     uint64_t vertexBufferOffsets[1] = {0};
 
     dawn::RenderPassEncoder pass = mContextDawn->getRenderPass();
-    pass.SetPipeline(mPipeline);
-    pass.SetBindGroup(0, mContextDawn->bindGroupGeneral, 0, nullptr);
-    pass.SetBindGroup(1, mContextDawn->bindGroupWorld, 0, nullptr);
-    pass.SetBindGroup(2, mBindGroupModel, 0, nullptr);
-    pass.SetBindGroup(3, mBindGroupPer, 0, nullptr);
-    pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
-    // diffuseShader doesn't have to input tangent buffer or binormal buffer.
-    if (mTangentBuffer && mBiNormalBuffer && mName != MODELNAME::MODELGLOBEBASE)
+    mContextDawn->setPipeline(mPipeline);
+    mContextDawn->setBindGroup(0, mContextDawn->bindGroupGeneral);
+    mContextDawn->setBindGroup(1, mContextDawn->bindGroupWorld);
+    mContextDawn->setBindGroup(2, mBindGroupModel);
+    mContextDawn->setBindGroup(3, mBindGroupPer);
+    if (mVertexBuffer != nullptr)
+    {
+        pass.SetVertexBuffers(0, 1, &mVertexBuffer->getBuffer(), vertexBufferOffsets);
+    }
+    else
     {
-        pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
-        pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
+        // diffuseShader doesn't have to input tangent buffer or binormal buffer.
+        if (mTangentBuffer && mBiNormalBuffer && mName != MODELNAME::MODELGLOBEBASE)
+        {
+            pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
+            pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
+        }
     }
     pass.SetIndexBuffer(mIndicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(mIndicesBuffer->getTotalComponents(), instance, 0, 0, 0);
+    mContextDawn->drawIndexed(mIndicesBuffer->getTotalComponents(), instance);
     instance = 0;
 }
 
@@ -44,6 +44,8 @@ class GenericModelDawn : public Model
     BufferDawn *mBiNormalBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
 
     struct LightFactorUniforms
     {
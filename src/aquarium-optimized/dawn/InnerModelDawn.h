@@ -49,6 +49,8 @@ class InnerModelDawn : public Model
     BufferDawn *mBiNormalBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
 
   private:
     utils::ComboVertexInputDescriptor mVertexInputDescriptor;
@@ -45,39 +45,48 @@ void OutsideModelDawn::init()
     mTangentBuffer  = static_cast<BufferDawn *>(bufferMap["tangent"]);
     mBiNormalBuffer = static_cast<BufferDawn *>(bufferMap["binormal"]);
     mIndicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
+    mVertexBuffer   = static_cast<BufferDawn *>(bufferMap["vertices"]);
 
-    mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
-    mVertexInputDescriptor.cAttributes[0].offset         = 0;
-    mVertexInputDescriptor.cBuffers[0].attributes        = &mVertexInputDescriptor.cAttributes[0];
-    mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
-    mVertexInputDescriptor.cAttributes[1].offset         = 0;
-    mVertexInputDescriptor.cBuffers[1].attributes        = &mVertexInputDescriptor.cAttributes[1];
-    mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
-    mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
-    mVertexInputDescriptor.cAttributes[2].offset         = 0;
-    mVertexInputDescriptor.cBuffers[2].attributes        = &mVertexInputDescriptor.cAttributes[2];
-    mVertexInputDescriptor.cBuffers[3].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[3].stride            = mTangentBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[3].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[3].shaderLocation = 3;
-    mVertexInputDescriptor.cAttributes[3].offset         = 0;
-    mVertexInputDescriptor.cBuffers[3].attributes        = &mVertexInputDescriptor.cAttributes[3];
-    mVertexInputDescriptor.cBuffers[4].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[4].stride            = mBiNormalBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[4].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[4].shaderLocation = 4;
-    mVertexInputDescriptor.cAttributes[4].offset         = 0;
-    mVertexInputDescriptor.cBuffers[4].attributes        = &mVertexInputDescriptor.cAttributes[4];
-    mVertexInputDescriptor.bufferCount                   = 5;
-    mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    if (mVertexBuffer != nullptr)
+    {
+        mContextDawn->setInterleavedVertexInput(&mVertexInputDescriptor, vertexElements,
+                                                vertexStride, 5);
+    }
+    else
+    {
+        mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
+        mVertexInputDescriptor.cAttributes[0].offset         = 0;
+        mVertexInputDescriptor.cBuffers[0].attributes = &mVertexInputDescriptor.cAttributes[0];
+        mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
+        mVertexInputDescriptor.cAttributes[1].offset         = 0;
+        mVertexInputDescriptor.cBuffers[1].attributes = &mVertexInputDescriptor.cAttributes[1];
+        mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
+        mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
+        mVertexInputDescriptor.cAttributes[2].offset         = 0;
+        mVertexInputDescriptor.cBuffers[2].attributes = &mVertexInputDescriptor.cAttributes[2];
+        mVertexInputDescriptor.cBuffers[3].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[3].stride            = mTangentBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[3].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[3].shaderLocation = 3;
+        mVertexInputDescriptor.cAttributes[3].offset         = 0;
+        mVertexInputDescriptor.cBuffers[3].attributes = &mVertexInputDescriptor.cAttributes[3];
+        mVertexInputDescriptor.cBuffers[4].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[4].stride            = mBiNormalBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[4].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[4].shaderLocation = 4;
+        mVertexInputDescriptor.cAttributes[4].offset         = 0;
+        mVertexInputDescriptor.cBuffers[4].attributes = &mVertexInputDescriptor.cAttributes[4];
+        mVertexInputDescriptor.bufferCount                   = 5;
+        mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    }
 
     mGroupLayoutPer = mContextDawn->MakeBindGroupLayout({
         {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
@@ -132,22 +141,29 @@ void OutsideModelDawn::draw()
     uint64_t vertexBufferOffsets[1] = {0};
 
     dawn::RenderPassEncoder pass = mContextDawn->getRenderPass();
-    pass.SetPipeline(mPipeline);
-    pass.SetBindGroup(0, mContextDawn->bindGroupGeneral, 0, nullptr);
-    pass.SetBindGroup(1, mContextDawn->bindGroupWorld, 0, nullptr);
-    pass.SetBindGroup(2, mBindGroupModel, 0, nullptr);
-    pass.SetBindGroup(3, mBindGroupPer, 0, nullptr);
-    pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
-    // diffuseShader doesn't have to input tangent buffer or binormal buffer.
-    if (mTangentBuffer && mBiNormalBuffer)
+    mContextDawn->setPipeline(mPipeline);
+    mContextDawn->setBindGroup(0, mContextDawn->bindGroupGeneral);
+    mContextDawn->setBindGroup(1, mContextDawn->bindGroupWorld);
+    mContextDawn->setBindGroup(2, mBindGroupModel);
+    mContextDawn->setBindGroup(3, mBindGroupPer);
+    if (mVertexBuffer != nullptr)
+    {
+        pass.SetVertexBuffers(0, 1, &mVertexBuffer->getBuffer(), vertexBufferOffsets);
+    }
+    else
     {
-        pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
-        pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
+        // diffuseShader doesn't have to input tangent buffer or binormal buffer.
+        if (mTangentBuffer && mBiNormalBuffer)
+        {
+            pass.SetVertexBuffers(3, 1, &mTangentBuffer->getBuffer(), vertexBufferOffsets);
+            pass.SetVertexBuffers(4, 1, &mBiNormalBuffer->getBuffer(), vertexBufferOffsets);
+        }
     }
     pass.SetIndexBuffer(mIndicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(mIndicesBuffer->getTotalComponents(), 1, 0, 0, 0);
+    mContextDawn->drawIndexed(mIndicesBuffer->getTotalComponents(), 1);
 }
 
 void OutsideModelDawn::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
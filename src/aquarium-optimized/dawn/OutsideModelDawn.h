@@ -40,6 +40,8 @@ public:
     BufferDawn *mBiNormalBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
 
     struct LightFactorUniforms
     {
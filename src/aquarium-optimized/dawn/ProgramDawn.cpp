@@ -4,16 +4,24 @@
 // found in the LICENSE file.
 //
 
-#include <fstream>
-#include <regex>
 #include <string>
 
 #include "ContextDawn.h"
 #include "ProgramDawn.h"
 #include "common/AQUARIUM_ASSERT.h"
 
-ProgramDawn::ProgramDawn(ContextDawn *context, const std::string &mVId, const std::string &mFId)
-    : Program(mVId, mFId), mVsModule(nullptr), mFsModule(nullptr), context(context)
+#include "../ShaderPermutation.h"
+
+ProgramDawn::ProgramDawn(ContextDawn *context,
+                         const std::string &mVId,
+                         const std::string &mFId,
+                         uint32_t features)
+    : Program(mVId, mFId, features),
+      mVsSpirv(),
+      mFsSpirv(),
+      mVsModule(nullptr),
+      mFsModule(nullptr),
+      context(context)
 {
 }
 
@@ -23,24 +31,38 @@ ProgramDawn::~ProgramDawn()
     mFsModule = nullptr;
 }
 
+void ProgramDawn::prepareProgram()
+{
+    if (mPrepared)
+    {
+        return;
+    }
+
+    loadSource(context->getResourceHelper());
+    std::string VertexShaderCode   = std::move(mVertexShaderCode);
+    std::string FragmentShaderCode = std::move(mFragmentShaderCode);
+
+    ShaderVariant variant = getShaderVariant(mFeatures);
+
+    ShaderPreprocessor *preprocessor = context->getShaderPreprocessor();
+    VertexShaderCode   = preprocessor->preprocess(mVId, VertexShaderCode, variant);
+    FragmentShaderCode = preprocessor->preprocess(mFId, FragmentShaderCode, variant);
+
+    // Each permutation is cached next to its shader files, as a file may be instantiated with
+    // several keys.
+    std::string suffix = "." + std::to_string(mFeatures) + ".spv";
+    context->compileSpirv(utils::ShaderStage::Vertex, VertexShaderCode, mVId + suffix, &mVsSpirv);
+    context->compileSpirv(utils::ShaderStage::Fragment, FragmentShaderCode, mFId + suffix,
+                          &mFsSpirv);
+    mPrepared = true;
+}
+
 void ProgramDawn::loadProgram()
 {
-    std::ifstream VertexShaderStream(mVId, std::ios::in);
-    std::string VertexShaderCode((std::istreambuf_iterator<char>(VertexShaderStream)),
-        std::istreambuf_iterator<char>());
-    VertexShaderStream.close();
-
-    // Read the Fragment Shader code from the file
-    std::ifstream FragmentShaderStream(mFId, std::ios::in);
-    std::string FragmentShaderCode((std::istreambuf_iterator<char>(FragmentShaderStream)),
-        std::istreambuf_iterator<char>());
-    FragmentShaderStream.close();
-
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noReflection)"), "");
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noNormalMap)"), "");
-
-    mVsModule = context->createShaderModule(utils::ShaderStage::Vertex, VertexShaderCode);
-    mFsModule = context->createShaderModule(utils::ShaderStage::Fragment, FragmentShaderCode);
+    prepareProgram();
+
+    mVsModule = context->createShaderModule(mVsSpirv);
+    mFsModule = context->createShaderModule(mFsSpirv);
+    mVsSpirv  = {};
+    mFsSpirv  = {};
 }
@@ -16,24 +16,30 @@
 #include <unordered_map>
 
 #include "BufferDawn.h"
+#include "ContextDawn.h"
 #include "TextureDawn.h"
 
 #include "../Aquarium.h"
 
-class ContextDawn;
-
 class ProgramDawn : public Program
 {
 public:
     ProgramDawn() {}
-    ProgramDawn(ContextDawn *context, const std::string &mVId, const std::string &mFId);
+    ProgramDawn(ContextDawn *context,
+                const std::string &mVId,
+                const std::string &mFId,
+                uint32_t features);
     ~ProgramDawn() override;
 
-    void loadProgram();
+    void prepareProgram() override;
+    void loadProgram() override;
     dawn::ShaderModule getVSModule() { return mVsModule; }
     dawn::ShaderModule getFSModule() { return mFsModule; }
 
   private:
+    // Compiled on a worker by prepareProgram().
+    SpirvShader mVsSpirv;
+    SpirvShader mFsSpirv;
     dawn::ShaderModule mVsModule;
     dawn::ShaderModule mFsModule;
 
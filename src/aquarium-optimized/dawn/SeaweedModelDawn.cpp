@@ -43,27 +43,36 @@ void SeaweedModelDawn::init()
     mNormalBuffer   = static_cast<BufferDawn *>(bufferMap["normal"]);
     mTexCoordBuffer = static_cast<BufferDawn *>(bufferMap["texCoord"]);
     mIndicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
-
-    mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
-    mVertexInputDescriptor.cAttributes[0].offset         = 0;
-    mVertexInputDescriptor.cBuffers[0].attributes        = &mVertexInputDescriptor.cAttributes[0];
-    mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
-    mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
-    mVertexInputDescriptor.cAttributes[1].offset         = 0;
-    mVertexInputDescriptor.cBuffers[1].attributes        = &mVertexInputDescriptor.cAttributes[1];
-    mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
-    mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
-    mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
-    mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
-    mVertexInputDescriptor.cAttributes[2].offset         = 0;
-    mVertexInputDescriptor.cBuffers[2].attributes        = &mVertexInputDescriptor.cAttributes[2];
-    mVertexInputDescriptor.bufferCount                   = 3;
-    mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    mVertexBuffer   = static_cast<BufferDawn *>(bufferMap["vertices"]);
+
+    if (mVertexBuffer != nullptr)
+    {
+        mContextDawn->setInterleavedVertexInput(&mVertexInputDescriptor, vertexElements,
+                                                vertexStride, 3);
+    }
+    else
+    {
+        mVertexInputDescriptor.cBuffers[0].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[0].stride            = mPositionBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[0].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[0].shaderLocation = 0;
+        mVertexInputDescriptor.cAttributes[0].offset         = 0;
+        mVertexInputDescriptor.cBuffers[0].attributes = &mVertexInputDescriptor.cAttributes[0];
+        mVertexInputDescriptor.cBuffers[1].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[1].stride            = mNormalBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[1].format         = dawn::VertexFormat::Float3;
+        mVertexInputDescriptor.cAttributes[1].shaderLocation = 1;
+        mVertexInputDescriptor.cAttributes[1].offset         = 0;
+        mVertexInputDescriptor.cBuffers[1].attributes = &mVertexInputDescriptor.cAttributes[1];
+        mVertexInputDescriptor.cBuffers[2].attributeCount    = 1;
+        mVertexInputDescriptor.cBuffers[2].stride            = mTexCoordBuffer->getDataSize();
+        mVertexInputDescriptor.cAttributes[2].format         = dawn::VertexFormat::Float2;
+        mVertexInputDescriptor.cAttributes[2].shaderLocation = 2;
+        mVertexInputDescriptor.cAttributes[2].offset         = 0;
+        mVertexInputDescriptor.cBuffers[2].attributes = &mVertexInputDescriptor.cAttributes[2];
+        mVertexInputDescriptor.bufferCount                   = 3;
+        mVertexInputDescriptor.indexFormat                   = dawn::IndexFormat::Uint16;
+    }
 
     mGroupLayoutModel = mContextDawn->MakeBindGroupLayout({
         {0, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer},
@@ -124,16 +133,23 @@ void SeaweedModelDawn::draw()
     uint64_t vertexBufferOffsets[1] = {0};
 
     dawn::RenderPassEncoder pass = mContextDawn->getRenderPass();
-    pass.SetPipeline(mPipeline);
-    pass.SetBindGroup(0, mContextDawn->bindGroupGeneral, 0, nullptr);
-    pass.SetBindGroup(1, mContextDawn->bindGroupWorld, 0, nullptr);
-    pass.SetBindGroup(2, mBindGroupModel, 0, nullptr);
-    pass.SetBindGroup(3, mBindGroupPer, 0, nullptr);
-    pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
+    mContextDawn->setPipeline(mPipeline);
+    mContextDawn->setBindGroup(0, mContextDawn->bindGroupGeneral);
+    mContextDawn->setBindGroup(1, mContextDawn->bindGroupWorld);
+    mContextDawn->setBindGroup(2, mBindGroupModel);
+    mContextDawn->setBindGroup(3, mBindGroupPer);
+    if (mVertexBuffer != nullptr)
+    {
+        pass.SetVertexBuffers(0, 1, &mVertexBuffer->getBuffer(), vertexBufferOffsets);
+    }
+    else
+    {
+        pass.SetVertexBuffers(0, 1, &mPositionBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(1, 1, &mNormalBuffer->getBuffer(), vertexBufferOffsets);
+        pass.SetVertexBuffers(2, 1, &mTexCoordBuffer->getBuffer(), vertexBufferOffsets);
+    }
     pass.SetIndexBuffer(mIndicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(mIndicesBuffer->getTotalComponents(), instance, 0, 0, 0);
+    mContextDawn->drawIndexed(mIndicesBuffer->getTotalComponents(), instance);
     instance = 0;
 }
 
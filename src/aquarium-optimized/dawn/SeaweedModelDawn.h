@@ -38,6 +38,8 @@ class SeaweedModelDawn : public SeaweedModel
     BufferDawn *mTexCoordBuffer;
 
     BufferDawn *mIndicesBuffer;
+    // Interleaved vertex buffer, or nullptr if the attributes are in separate buffers.
+    BufferDawn *mVertexBuffer;
     void updateSeaweedModelTime(float time) override;
 
     struct LightFactorUniforms
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// StagingAllocatorDawn.cpp: Implements the linear staging allocator of dawn.
+
+#include "StagingAllocatorDawn.h"
+
+#include <algorithm>
+
+#include "ContextDawn.h"
+
+namespace {
+
+// A 1024x1024 texture with its mip chain fits in one chunk. Larger uploads get a chunk of
+// their own.
+constexpr uint32_t kStagingChunkSize = 8 * 1024 * 1024;
+// Row pitch and offset alignment of buffer to texture copies.
+constexpr uint32_t kStagingAlignment = 256;
+
+uint32_t alignStaging(uint32_t value)
+{
+    return (value + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+}
+
+}  // namespace
+
+StagingAllocatorDawn::StagingAllocatorDawn(ContextDawn *context)
+    : mContext(context),
+      mCurrent({nullptr, 0, 0, 0}),
+      mStagingBufferCount(0),
+      mStagingBufferSize(0)
+{
+}
+
+StagingAllocatorDawn::~StagingAllocatorDawn()
+{
+    mCurrent.buffer = nullptr;
+    mFilled.clear();
+    mSubmitted.clear();
+    mFree.clear();
+}
+
+void StagingAllocatorDawn::allocate(const void *data,
+                                    uint32_t size,
+                                    dawn::Buffer *buffer,
+                                    uint32_t *offset)
+{
+    uint32_t start = alignStaging(mCurrent.used);
+    if (mCurrent.size == 0 || start + size > mCurrent.size)
+    {
+        if (mCurrent.used > 0)
+        {
+            mFilled.push_back(mCurrent);
+        }
+        else if (mCurrent.size > 0)
+        {
+            mFree.push_back(mCurrent);
+        }
+        mCurrent = acquireChunk(size);
+        start    = 0;
+    }
+
+    mContext->setBufferData(mCurrent.buffer, start, size, data);
+    mCurrent.used = start + size;
+
+    *buffer = mCurrent.buffer;
+    *offset = start;
+}
+
+void StagingAllocatorDawn::submit(uint64_t serial)
+{
+    for (Chunk &chunk : mFilled)
+    {
+        chunk.serial = serial;
+        mSubmitted.push_back(chunk);
+    }
+    mFilled.clear();
+
+    // The rest of the current chunk can't be reused before the copies from it are done.
+    if (mCurrent.used > 0)
+    {
+        mCurrent.serial = serial;
+        mSubmitted.push_back(mCurrent);
+        mCurrent = {nullptr, 0, 0, 0};
+    }
+}
+
+void StagingAllocatorDawn::recycle(uint64_t completedSerial)
+{
+    while (!mSubmitted.empty() && mSubmitted.front().serial <= completedSerial)
+    {
+        Chunk chunk = mSubmitted.front();
+        mSubmitted.pop_front();
+        chunk.used = 0;
+        mFree.push_back(chunk);
+    }
+}
+
+void StagingAllocatorDawn::releaseCompleted(uint64_t completedSerial)
+{
+    while (!mSubmitted.empty() && mSubmitted.front().serial <= completedSerial)
+    {
+        mSubmitted.pop_front();
+    }
+    mFree.clear();
+}
+
+StagingAllocatorDawn::Chunk StagingAllocatorDawn::acquireChunk(uint32_t minSize)
+{
+    auto it = std::find_if(mFree.begin(), mFree.end(),
+                           [minSize](const Chunk &chunk) { return chunk.size >= minSize; });
+    if (it != mFree.end())
+    {
+        Chunk chunk = *it;
+        mFree.erase(it);
+        return chunk;
+    }
+
+    Chunk chunk;
+    chunk.size   = std::max(kStagingChunkSize, alignStaging(minSize));
+    chunk.used   = 0;
+    chunk.serial = 0;
+    chunk.buffer = mContext->createBuffer(
+        chunk.size, dawn::BufferUsageBit::CopySrc | dawn::BufferUsageBit::CopyDst);
+    ++mStagingBufferCount;
+    mStagingBufferSize += chunk.size;
+    return chunk;
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// StagingAllocatorDawn.h: Defines the staging memory of uploads on dawn. Data is sub-allocated
+// linearly from large staging buffers, which are recycled by the uploads of a burst, and
+// released once the queue has executed the copies from them.
+
+#pragma once
+#ifndef STAGINGALLOCATORDAWN_H
+#define STAGINGALLOCATORDAWN_H 1
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <dawn/dawncpp.h>
+
+class ContextDawn;
+
+class StagingAllocatorDawn
+{
+  public:
+    explicit StagingAllocatorDawn(ContextDawn *context);
+    ~StagingAllocatorDawn();
+
+    // Copy size bytes of data into staging memory, and return the staging buffer and the offset
+    // to copy from. Offsets are aligned to 256 bytes for texture copies.
+    void allocate(const void *data, uint32_t size, dawn::Buffer *buffer, uint32_t *offset);
+    // Called after the copies from the allocations so far are submitted. The queue signals
+    // serial when they are done.
+    void submit(uint64_t serial);
+    // Reuse the staging buffers of the submits up to completedSerial.
+    void recycle(uint64_t completedSerial);
+    // Destroy the staging buffers of the submits up to completedSerial, and the free ones, so
+    // staging memory isn't kept alive after the uploads are done.
+    void releaseCompleted(uint64_t completedSerial);
+    // True if there are staging buffers which releaseCompleted() may destroy.
+    bool hasReleasable() const { return !mSubmitted.empty() || !mFree.empty(); }
+
+    // Counts of the staging buffers created so far.
+    int getStagingBufferCount() const { return mStagingBufferCount; }
+    uint64_t getStagingBufferSize() const { return mStagingBufferSize; }
+
+  private:
+    struct Chunk
+    {
+        dawn::Buffer buffer;
+        uint32_t size;
+        uint32_t used;
+        uint64_t serial;
+    };
+
+    Chunk acquireChunk(uint32_t minSize);
+
+    ContextDawn *mContext;
+    Chunk mCurrent;
+    std::vector<Chunk> mFilled;    // Full, but not submitted yet.
+    std::deque<Chunk> mSubmitted;  // In the order of serials.
+    std::vector<Chunk> mFree;
+
+    int mStagingBufferCount;
+    uint64_t mStagingBufferSize;
+};
+
+#endif  // !STAGINGALLOCATORDAWN_H
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <iostream>
 
 #include "ContextDawn.h"
 #include "TextureDawn.h"
@@ -15,8 +16,6 @@
 
 TextureDawn::~TextureDawn() {
 
-    DestoryImageData(mPixelVec);
-    DestoryImageData(mResizedVec);
     mTextureView = nullptr;
     mTexture     = nullptr;
     mSampler     = nullptr;
@@ -32,6 +31,8 @@ TextureDawn::TextureDawn(ContextDawn *context, const std::string &name, const st
       mTextureView(nullptr),
       mContext(context)
 {
+    mGenerateMipmaps = true;
+    mIs256Padding    = true;
 }
 
 TextureDawn::TextureDawn(ContextDawn *context,
@@ -43,13 +44,36 @@ TextureDawn::TextureDawn(ContextDawn *context,
       mFormat(dawn::TextureFormat::RGBA8Unorm),
       mContext(context)
 {
+    mIs256Padding = true;
+}
+
+TextureDawn::TextureDawn(ContextDawn *context,
+                         const std::string &name,
+                         const std::vector<std::string> &urls,
+                         dawn::TextureViewDimension viewDimension)
+    : Texture(name, urls, true),
+      mTextureDimension(dawn::TextureDimension::e2D),
+      mTextureViewDimension(viewDimension),
+      mTexture(nullptr),
+      mSampler(nullptr),
+      mFormat(dawn::TextureFormat::RGBA8Unorm),
+      mTextureView(nullptr),
+      mContext(context)
+{
+    ASSERT(viewDimension == dawn::TextureViewDimension::e2DArray);
+    mGenerateMipmaps = true;
+    mIs256Padding    = true;
 }
 
 void TextureDawn::loadTexture()
 {
     dawn::SamplerDescriptor samplerDesc;
-    const int kPadding = 256;
-    loadImage(mUrls, &mPixelVec);
+    if (!prepareLevels(mContext->getResourceHelper()))
+    {
+        std::cout << "Failed to load texture " << mName << "." << std::endl;
+        releaseLevels();
+        return;
+    }
 
     if (mTextureViewDimension == dawn::TextureViewDimension::Cube)
     {
@@ -65,17 +89,10 @@ void TextureDawn::loadTexture()
         descriptor.usage = dawn::TextureUsageBit::CopyDst | dawn::TextureUsageBit::Sampled;
         mTexture                   = mContext->createTexture(descriptor);
 
+        uint32_t rowPitch = static_cast<uint32_t>(getMipmapRowPitch(mWidth, true));
         for (unsigned int i = 0; i < 6; i++)
         {
-            dawn::Buffer stagingBuffer = mContext->createBufferFromData(
-                mPixelVec[i], mWidth * mHeight * 4, dawn::BufferUsageBit::CopySrc);
-            dawn::BufferCopyView bufferCopyView =
-                mContext->createBufferCopyView(stagingBuffer, 0, mWidth * 4, mHeight);
-            dawn::TextureCopyView textureCopyView =
-                mContext->createTextureCopyView(mTexture, 0, i, {0, 0, 0});
-            dawn::Extent3D copySize = { static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight), 1 };
-            mContext->mCommandBuffers.emplace_back(
-                mContext->copyBufferToTexture(bufferCopyView, textureCopyView, copySize));
+            mContext->uploadTexture(mTexture, 0, i, getLevel(i, 0), rowPitch, mWidth, mHeight);
         }
 
         dawn::TextureViewDescriptor viewDescriptor;
@@ -99,28 +116,19 @@ void TextureDawn::loadTexture()
         samplerDesc.lodMaxClamp  = 1000.0f;
         samplerDesc.compare = dawn::CompareFunction::Never;
 
-        mSampler = mContext->createSampler(samplerDesc);
+        mSampler = mContext->getSampler(samplerDesc);
     }
-    else  // dawn::TextureViewDimension::e2D
+    else  // dawn::TextureViewDimension::e2D or e2DArray
     {
-        int resizedWidth;
-        if (mWidth % kPadding == 0)
-        {
-            resizedWidth = mWidth;
-        }
-        else
-        {
-            resizedWidth = (mWidth / 256 + 1) * 256;
-        }
-        generateMipmap(mPixelVec[0], mWidth, mHeight, 0, mResizedVec, resizedWidth, mHeight, 0, 4,
-                       true);
-
+        // The texture keeps its width. Rows of the levels are padded to the row pitch
+        // alignment of Dawn instead of resampling the image to an aligned width.
+        uint32_t layerCount = static_cast<uint32_t>(getImageCount());
         dawn::TextureDescriptor descriptor;
         descriptor.dimension = mTextureDimension;
-        descriptor.size.width  = resizedWidth;
+        descriptor.size.width  = mWidth;
         descriptor.size.height = mHeight;
         descriptor.size.depth = 1;
-        descriptor.arrayLayerCount = 1;
+        descriptor.arrayLayerCount = layerCount;
         descriptor.sampleCount = 1;
         descriptor.format = mFormat;
         descriptor.mipLevelCount   = static_cast<uint32_t>(std::floor(
@@ -129,32 +137,21 @@ void TextureDawn::loadTexture()
         descriptor.usage = dawn::TextureUsageBit::CopyDst | dawn::TextureUsageBit::Sampled;
         mTexture         = mContext->createTexture(descriptor);
 
-        int count = 0;
-        for (unsigned int i = 0; i < descriptor.mipLevelCount; ++i, ++count)
+        for (unsigned int i = 0; i < descriptor.mipLevelCount; ++i)
         {
-            int height                 = mHeight >> i;
-            int width                  = resizedWidth >> i;
-            if (height == 0)
+            uint32_t height   = static_cast<uint32_t>(std::max(mHeight >> i, 1));
+            uint32_t width    = static_cast<uint32_t>(std::max(mWidth >> i, 1));
+            uint32_t rowPitch = static_cast<uint32_t>(getMipmapRowPitch(width, true));
+            for (uint32_t layer = 0; layer < layerCount; ++layer)
             {
-                height = 1;
+                mContext->uploadTexture(mTexture, i, layer, getLevel(layer, i), rowPitch, width,
+                                        height);
             }
-
-            dawn::Buffer stagingBuffer = mContext->createBufferFromData(
-                mResizedVec[i], resizedWidth * height * 4, dawn::BufferUsageBit::CopySrc);
-            dawn::BufferCopyView bufferCopyView =
-                mContext->createBufferCopyView(stagingBuffer, 0, resizedWidth * 4, height);
-            dawn::TextureCopyView textureCopyView =
-                mContext->createTextureCopyView(mTexture, i, 0, {0, 0, 0});
-            dawn::Extent3D copySize = {static_cast<uint32_t>(width),
-                                       static_cast<uint32_t>(height),
-                                       1};
-            mContext->mCommandBuffers.emplace_back(
-                mContext->copyBufferToTexture(bufferCopyView, textureCopyView, copySize));
         }
 
         dawn::TextureViewDescriptor viewDescriptor;
         viewDescriptor.nextInChain = nullptr;
-        viewDescriptor.dimension = dawn::TextureViewDimension::e2D;
+        viewDescriptor.dimension = mTextureViewDimension;
         viewDescriptor.format = mFormat;
         viewDescriptor.baseMipLevel = 0;
         viewDescriptor.mipLevelCount =
@@ -162,7 +159,7 @@ void TextureDawn::loadTexture()
                 std::floor(static_cast<float>(std::log2(std::min(mWidth, mHeight))))) +
             1;
         viewDescriptor.baseArrayLayer = 0;
-        viewDescriptor.arrayLayerCount = 1;
+        viewDescriptor.arrayLayerCount = layerCount;
 
         mTextureView = mTexture.CreateView(&viewDescriptor);
 
@@ -184,9 +181,10 @@ void TextureDawn::loadTexture()
             samplerDesc.mipmapFilter = dawn::FilterMode::Nearest;
         }
 
-        mSampler = mContext->createSampler(samplerDesc);
+        mSampler = mContext->getSampler(samplerDesc);
     }
 
-    // TODO(yizhou): check if the pixel destory should delay or fence
+    // The images are copied into the staging memory, so they aren't needed anymore.
+    releaseLevels();
 }
 
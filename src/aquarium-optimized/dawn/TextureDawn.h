@@ -23,6 +23,11 @@ class TextureDawn : public Texture
     TextureDawn(ContextDawn *context,
                 const std::string &name,
                 const std::vector<std::string> &urls);
+    // A 2D texture array with a layer for each of urls.
+    TextureDawn(ContextDawn *context,
+                const std::string &name,
+                const std::vector<std::string> &urls,
+                dawn::TextureViewDimension viewDimension);
 
     const dawn::Texture &getTextureId() const { return mTexture; }
     const dawn::Sampler &getSampler() const { return mSampler; }
@@ -33,14 +38,12 @@ class TextureDawn : public Texture
     void loadTexture() override;
 
   private:
-    dawn::TextureDimension mTextureDimension;  // texture 2D or CubeMap
+    dawn::TextureDimension mTextureDimension;  // texture 2D, 2D array or CubeMap
     dawn::TextureViewDimension mTextureViewDimension;
     dawn::Texture mTexture;
     dawn::Sampler mSampler;
     dawn::TextureFormat mFormat;
     dawn::TextureView mTextureView;
-    std::vector<unsigned char *> mPixelVec;
-    std::vector<unsigned char *> mResizedVec;
     ContextDawn *mContext;
 };
 
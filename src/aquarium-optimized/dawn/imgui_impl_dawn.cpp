@@ -267,7 +267,7 @@ bool ImGui_ImplDawn_CreateDeviceObjects()
     const ResourceHelper *resourceHelper = mContextDawn->getResourceHelper();
     const std::string &programPath       = resourceHelper->getProgramPath();
     mProgramDawn = new ProgramDawn(mContextDawn, programPath + "imguiVertexShader",
-                                   programPath + "imguiFragmentShader");
+                                   programPath + "imguiFragmentShader", 0);
     mProgramDawn->loadProgram();
 
     const dawn::ShaderModule &mVsModule = mProgramDawn->getVSModule();
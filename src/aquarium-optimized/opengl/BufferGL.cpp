@@ -28,16 +28,16 @@ BufferGL::BufferGL(ContextGL *context,
     mBuf = mContext->generateBuffer();
 }
 
-void BufferGL::loadBuffer(const std::vector<float> &buf)
+void BufferGL::loadBuffer(const float *buf, size_t size)
 {
     mContext->bindBuffer(mTarget, mBuf);
-    mContext->uploadBuffer(mTarget, buf);
+    mContext->uploadBuffer(mTarget, buf, size);
 }
 
-void BufferGL::loadBuffer(const std::vector<unsigned short> &buf)
+void BufferGL::loadBuffer(const unsigned short *buf, size_t size)
 {
     mContext->bindBuffer(mTarget, mBuf);
-    mContext->uploadBuffer(mTarget, buf);
+    mContext->uploadBuffer(mTarget, buf, size);
 }
 
 BufferGL::~BufferGL()
@@ -49,8 +49,8 @@ class BufferGL : public Buffer
     int getStride() const { return mStride; }
     void *getOffset() const { return mOffset; }
     unsigned int getTarget() const { return mTarget; }
-    void loadBuffer(const std::vector<float> &buf);
-    void loadBuffer(const std::vector<unsigned short> &buf);
+    void loadBuffer(const float *buf, size_t size);
+    void loadBuffer(const unsigned short *buf, size_t size);
 
   private:
     ContextGL *mContext;
@@ -8,18 +8,26 @@
 #include "common/AQUARIUM_ASSERT.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include "BufferGL.h"
 #include "ContextGL.h"
 #include "FishModelGL.h"
+#include "FishModelInstancedDrawGL.h"
 #include "GenericModelGL.h"
 #include "InnerModelGL.h"
 #include "OutsideModelGL.h"
 #include "ProgramGL.h"
 #include "SeaweedModelGL.h"
 #include "TextureGL.h"
+#include "UniformBufferGL.h"
+
+#include "../Mesh.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -30,7 +38,67 @@
 #include <GLFW/glfw3native.h>
 #endif
 
-ContextGL::ContextGL(BACKENDTYPE backendType) : mWindow(nullptr)
+namespace {
+
+constexpr char kProgramBinaryMagic[4]   = {'A', 'Q', 'P', 'B'};
+constexpr uint32_t kProgramBinaryVersion = 1;
+
+struct ProgramBinaryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;  // Of the sources and the driver.
+    uint32_t format;
+    uint32_t length;
+    double compileTime;  // In seconds, spent compiling the program when the cache was written.
+};
+
+uint64_t hashString(const std::string &str, uint64_t hash)
+{
+    // Hash the size too, so the strings hashed one after another can't be split differently.
+    uint64_t size = str.size();
+    hash          = hashData(reinterpret_cast<const uint8_t *>(&size), sizeof(size), hash);
+    return hashData(reinterpret_cast<const uint8_t *>(str.data()), str.size(), hash);
+}
+
+double getSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+ContextGL::ContextGL(BACKENDTYPE backendType)
+    : mWindow(nullptr),
+      mSamplers(),
+      mSamplerRequestCount(0),
+      mProgramBinaryHash(0),
+      mProgramCacheHits(0),
+      mProgramCacheMisses(0),
+      mProgramCompileTime(0.0),
+      mProgramCompileTimeSaved(0.0),
+      mParallelShaderCompile(false),
+#ifdef GL_GLEXT_PROTOTYPES
+      mUseUniformBlocks(false),
+#else
+      mUseUniformBlocks(true),
+#endif
+      mUniformBufferAlignment(1),
+      mLightWorldPositionBuffer(nullptr),
+      mLightBuffer(nullptr),
+      mFogBuffer(nullptr),
+      mCurrentProgram(0),
+      mCurrentVertexArray(0),
+      mBlendEnabled(false),
+      mActiveTextureUnit(0),
+      mBoundTextures(),
+      mBoundSamplers(),
+      mBoundBuffers(),
+      mBoundUniformBuffers(),
+      mUniformValues(),
+      mCurrentUniformValues(nullptr),
+      mStateCacheStats({0, 0}),
+      mTotalStateCacheStats({0, 0})
 {
     initAvailableToggleBitset(backendType);
 }
@@ -236,9 +304,77 @@ bool ContextGL::initialize(BACKENDTYPE backend,
     mRenderer    = renderer.substr(0, index);
     std::cout << mRenderer << std::endl;
 
+    initProgramBinaryHash();
+    initParallelShaderCompile();
+
+    if (mUseUniformBlocks)
+    {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        mUniformBufferAlignment = std::max(alignment, 1);
+    }
+
     return true;
 }
 
+void ContextGL::initParallelShaderCompile()
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    std::string extension;
+    for (GLint i = 0; i < extensionCount && extension.empty(); ++i)
+    {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 ||
+            strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+        {
+            extension = name;
+        }
+    }
+    if (extension.empty())
+    {
+        return;
+    }
+
+    // Let the driver pick the count of compiler threads.
+#ifdef GL_GLES_PROTOTYPES
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#else
+    typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+    const char *procName = extension == "GL_KHR_parallel_shader_compile"
+                               ? "glMaxShaderCompilerThreadsKHR"
+                               : "glMaxShaderCompilerThreadsARB";
+    auto maxShaderCompilerThreads =
+        reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress(procName));
+    if (maxShaderCompilerThreads == nullptr)
+    {
+        return;
+    }
+    maxShaderCompilerThreads(0xFFFFFFFF);
+#endif
+    mParallelShaderCompile = true;
+}
+
+void ContextGL::initProgramBinaryHash()
+{
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0)
+    {
+        mProgramBinaryHash = 0;
+        return;
+    }
+    std::vector<GLint> formats(formatCount);
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+    uint64_t hash = hashString(reinterpret_cast<const char *>(glGetString(GL_RENDERER)), kHashSeed);
+    hash          = hashString(reinterpret_cast<const char *>(glGetString(GL_VERSION)), hash);
+    hash          = hashData(reinterpret_cast<const uint8_t *>(formats.data()),
+                             formats.size() * sizeof(GLint), hash);
+    // 0 means caching is disabled.
+    mProgramBinaryHash = hash == 0 ? 1 : hash;
+}
+
 #ifdef GL_GLEXT_PROTOTYPES
 EGLContext ContextGL::createContext(EGLContext share) const
 {
@@ -319,14 +455,12 @@ EGLBoolean ContextGL::FindEGLConfig(EGLDisplay dpy, const EGLint *attrib_list, E
 Texture *ContextGL::createTexture(const std::string &name, const std::string &url)
 {
     TextureGL *texture = new TextureGL(this, name, url);
-    texture->loadTexture();
     return texture;
 }
 
 Texture *ContextGL::createTexture(const std::string &name, const std::vector<std::string> &urls)
 {
     TextureGL *texture = new TextureGL(this, name, urls);
-    texture->loadTexture();
     return texture;
 }
 
@@ -339,21 +473,40 @@ unsigned int ContextGL::generateTexture()
 
 void ContextGL::bindTexture(unsigned int target, unsigned int textureId)
 {
+    if (mBoundTextures.size() <= mActiveTextureUnit)
+    {
+        mBoundTextures.resize(mActiveTextureUnit + 1, 0);
+        mBoundSamplers.resize(mActiveTextureUnit + 1, 0);
+    }
+    if (skipRedundantCall(mBoundTextures[mActiveTextureUnit] == textureId))
+    {
+        return;
+    }
     glBindTexture(target, textureId);
+    mBoundTextures[mActiveTextureUnit] = textureId;
 }
 
 void ContextGL::deleteTexture(unsigned int texture)
 {
     glDeleteTextures(1, &texture);
+    // Deleting a texture unbinds it from all of the units.
+    for (unsigned int &bound : mBoundTextures)
+    {
+        if (bound == texture)
+        {
+            bound = 0;
+        }
+    }
 }
 
 void ContextGL::uploadTexture(unsigned int target,
                               unsigned int format,
                               int width,
                               int height,
-                              unsigned char *pixels)
+                              const unsigned char *pixels,
+                              int level)
 {
-    glTexImage2D(target, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glTexImage2D(target, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
@@ -367,6 +520,29 @@ void ContextGL::generateMipmap(unsigned int target)
     glGenerateMipmap(target);
 }
 
+unsigned int ContextGL::getSampler(int minFilter, int magFilter, int wrap)
+{
+    ++mSamplerRequestCount;
+    auto key = std::make_tuple(minFilter, magFilter, wrap);
+    auto it  = mSamplers.find(key);
+    if (it != mSamplers.end())
+    {
+        return it->second;
+    }
+
+    unsigned int sampler;
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, minFilter);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, magFilter);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, wrap);
+    ASSERT(glGetError() == GL_NO_ERROR);
+
+    mSamplers[key] = sampler;
+    return sampler;
+}
+
 void ContextGL::initState()
 {
     glEnable(GL_DEPTH_TEST);
@@ -381,32 +557,50 @@ void ContextGL::initState()
 void ContextGL::initAvailableToggleBitset(BACKENDTYPE backendType)
 {
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEMSAAx4));
-    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::UPATEANDDRAWFOREACHMODEL));
+    // Without uniform blocks, the uniforms of every instance are set right before its draw.
+    if (!mUseUniformBlocks)
+    {
+        mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::UPATEANDDRAWFOREACHMODEL));
+    }
+    else
+    {
+        // The instanced vertex shader sources the fish from attributes, it's only ported to the
+        // 4.5 shaders.
+        mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    }
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFULLSCREENMODE));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINTERLEAVEDVERTEXBUFFER));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEQUANTIZEDVERTEXATTRIBUTES));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEPROGRESSIVELOADING));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLETEXTURESTREAMING));
 }
 
-Buffer *ContextGL::createBuffer(int numComponents, std::vector<float> *buf, bool isIndex)
+Buffer *ContextGL::createBuffer(int numComponents, const float *buf, size_t size, bool isIndex)
 {
-    BufferGL *buffer = new BufferGL(this, static_cast<int>(buf->size()), numComponents, isIndex, GL_FLOAT, false);
-    buffer->loadBuffer(*buf);
+    BufferGL *buffer =
+        new BufferGL(this, static_cast<int>(size), numComponents, isIndex, GL_FLOAT, false);
+    buffer->loadBuffer(buf, size);
 
     return buffer;
 }
 
-Buffer *ContextGL::createBuffer(int numComponents, std::vector<unsigned short> *buf, bool isIndex)
+Buffer *ContextGL::createBuffer(int numComponents,
+                                const unsigned short *buf,
+                                size_t size,
+                                bool isIndex)
 {
-    BufferGL *buffer = new BufferGL(this, static_cast<int>(buf->size()), numComponents, isIndex,
+    BufferGL *buffer = new BufferGL(this, static_cast<int>(size), numComponents, isIndex,
                                     GL_UNSIGNED_SHORT, true);
-    buffer->loadBuffer(*buf);
+    buffer->loadBuffer(buf, size);
 
     return buffer;
 }
 
-Program *ContextGL::createProgram(const std::string &mVId, const std::string &mFId)
+Program *ContextGL::createProgram(const std::string &mVId,
+                                  const std::string &mFId,
+                                  uint32_t features)
 {
-    ProgramGL *program = new ProgramGL(this, mVId, mFId);
-    program->loadProgram();
-
+    ProgramGL *program = new ProgramGL(this, mVId, mFId, features);
     return program;
 }
 
@@ -438,6 +632,30 @@ void ContextGL::DoFlush()
 
 void ContextGL::Terminate()
 {
+    std::cout << "Program binary cache: " << mProgramCacheHits << " hits, " << mProgramCacheMisses
+              << " misses, " << mProgramCompileTime << " s compiling, "
+              << mProgramCompileTimeSaved << " s saved"
+              << (mParallelShaderCompile ? ", compiled in parallel by the driver." : ".")
+              << std::endl;
+    std::cout << "Created " << mSamplers.size() << " sampler objects for "
+              << mSamplerRequestCount << " textures." << std::endl;
+    mTotalStateCacheStats.issued += mStateCacheStats.issued;
+    mTotalStateCacheStats.skipped += mStateCacheStats.skipped;
+    std::cout << "State cache: " << mTotalStateCacheStats.issued << " calls issued, "
+              << mTotalStateCacheStats.skipped << " redundant calls skipped." << std::endl;
+    for (const auto &sampler : mSamplers)
+    {
+        glDeleteSamplers(1, &sampler.second);
+    }
+    mSamplers.clear();
+
+    delete mLightWorldPositionBuffer;
+    delete mLightBuffer;
+    delete mFogBuffer;
+    mLightWorldPositionBuffer = nullptr;
+    mLightBuffer              = nullptr;
+    mFogBuffer                = nullptr;
+
     glfwTerminate();
 }
 
@@ -448,7 +666,7 @@ void ContextGL::showWindow()
     glfwShowWindow(mWindow);
 }
 
-void ContextGL::showFPS(const FPSTimer &fpsTimer)
+void ContextGL::showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats)
 {
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
@@ -481,6 +699,12 @@ void ContextGL::showFPS(const FPSTimer &fpsTimer)
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                     1000.0f / fpsTimer.getAverageFPS(), fpsTimer.getAverageFPS());
+
+        ImGui::Text("Models drawn %d, culled %d", cullingStats.drawnModels,
+                    cullingStats.culledModels);
+        ImGui::Text("Fish drawn %d, culled %d", cullingStats.drawnFish, cullingStats.culledFish);
+        ImGui::Text("GL state calls issued %d, skipped %d", mStateCacheStats.issued,
+                    mStateCacheStats.skipped);
         ImGui::End();
     }
 
@@ -511,8 +735,25 @@ int ContextGL::getAttribLocation(unsigned int programId, const std::string &name
     return index;
 }
 
+bool ContextGL::skipRedundantCall(bool redundant) const
+{
+    if (redundant)
+    {
+        ++mStateCacheStats.skipped;
+        return true;
+    }
+    ++mStateCacheStats.issued;
+    return false;
+}
+
 void ContextGL::enableBlend(bool flag) const
 {
+    if (skipRedundantCall(mBlendEnabled == flag))
+    {
+        return;
+    }
+    mBlendEnabled = flag;
+
     if (flag)
     {
         glEnable(GL_BLEND);
@@ -532,6 +773,15 @@ void ContextGL::drawElements(const BufferGL &buffer) const
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
+void ContextGL::drawElementsInstanced(const BufferGL &buffer, int instanceCount) const
+{
+    GLint totalComponents = buffer.getTotalComponents();
+    GLenum type           = buffer.getType();
+    glDrawElementsInstanced(GL_TRIANGLES, totalComponents, type, 0, instanceCount);
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+}
+
 Model *ContextGL::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend)
 {
     Model *model;
@@ -540,6 +790,9 @@ Model *ContextGL::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME nam
         case MODELGROUP::FISH:
             model = new FishModelGL(this, aquarium, type, name, blend);
             break;
+        case MODELGROUP::FISHINSTANCEDDRAW:
+            model = new FishModelInstancedDrawGL(this, aquarium, type, name, blend);
+            break;
         case MODELGROUP::GENERIC:
             model = new GenericModelGL(this, aquarium, type, name, blend);
             break;
@@ -562,6 +815,10 @@ Model *ContextGL::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME nam
 
 void ContextGL::preFrame()
 {
+    mTotalStateCacheStats.issued += mStateCacheStats.issued;
+    mTotalStateCacheStats.skipped += mStateCacheStats.skipped;
+    mStateCacheStats = {0, 0};
+
     glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
     glEnable(GL_DEPTH_TEST);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -569,9 +826,71 @@ void ContextGL::preFrame()
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
+void ContextGL::initGeneralResources(Aquarium *aquarium)
+{
+    if (!mUseUniformBlocks)
+    {
+        return;
+    }
+
+    mLightWorldPositionBuffer = new UniformBufferGL(this, sizeof(LightWorldPositionUniform));
+    mLightBuffer              = new UniformBufferGL(this, sizeof(LightUniforms));
+    mFogBuffer                = new UniformBufferGL(this, sizeof(FogUniforms));
+
+    mLightBuffer->setElement(0, &aquarium->lightUniforms);
+    mLightBuffer->upload(1);
+}
+
+void ContextGL::updateWorldlUniforms(Aquarium *aquarium)
+{
+    if (!mUseUniformBlocks)
+    {
+        return;
+    }
+
+    mLightWorldPositionBuffer->setElement(0, &aquarium->lightWorldPositionUniform);
+    mLightWorldPositionBuffer->upload(1);
+    mFogBuffer->setElement(0, &aquarium->fogUniforms);
+    mFogBuffer->upload(1);
+    bindGeneralUniformBuffers();
+}
+
+void ContextGL::bindGeneralUniformBuffers() const
+{
+    mLightWorldPositionBuffer->bind(UNIFORMBLOCKLIGHTWORLDPOSITION, 0);
+    mLightBuffer->bind(UNIFORMBLOCKLIGHT, 0);
+    mFogBuffer->bind(UNIFORMBLOCKFOG, 0);
+}
+
 void ContextGL::setUniform(int index, const float *v, int type) const
 {
     ASSERT(index != -1);
+    int count = 0;
+    switch (type)
+    {
+        case GL_FLOAT:
+            count = 1;
+            break;
+        case GL_FLOAT_VEC2:
+            count = 2;
+            break;
+        case GL_FLOAT_VEC3:
+            count = 3;
+            break;
+        case GL_FLOAT_VEC4:
+            count = 4;
+            break;
+        case GL_FLOAT_MAT4:
+            count = 16;
+            break;
+        default:
+            break;
+    }
+    if (count != 0 && skipRedundantCall(cacheUniformValue(index, v, count)))
+    {
+        return;
+    }
+
     switch (type)
     {
         case GL_FLOAT:
@@ -608,12 +927,63 @@ void ContextGL::setUniform(int index, const float *v, int type) const
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
+bool ContextGL::cacheUniformValue(int location, const float *v, int count) const
+{
+    ASSERT(mCurrentUniformValues != nullptr);
+    std::vector<std::vector<float>> &values = *mCurrentUniformValues;
+    if (values.size() <= static_cast<size_t>(location))
+    {
+        values.resize(location + 1);
+    }
+
+    std::vector<float> &value = values[location];
+    if (value.size() == static_cast<size_t>(count) && std::equal(v, v + count, value.begin()))
+    {
+        return true;
+    }
+    value.assign(v, v + count);
+    return false;
+}
+
+void ContextGL::setActiveTexture(unsigned int unit) const
+{
+    if (skipRedundantCall(mActiveTextureUnit == unit))
+    {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    mActiveTextureUnit = unit;
+}
+
 void ContextGL::setTexture(const TextureGL &texture, int index, int unit) const
 {
     ASSERT(index != -1);
-    glUniform1i(index, unit);
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(texture.getTarget(), texture.getTextureId());
+    // The unit of a sampler uniform is cached with the values of the float uniforms, a location
+    // has a single type.
+    float unitValue = static_cast<float>(unit);
+    if (!skipRedundantCall(cacheUniformValue(index, &unitValue, 1)))
+    {
+        glUniform1i(index, unit);
+    }
+
+    if (mBoundTextures.size() <= static_cast<size_t>(unit))
+    {
+        mBoundTextures.resize(unit + 1, 0);
+        mBoundSamplers.resize(unit + 1, 0);
+    }
+    // A texture is bound to the target it was created with, so binding another texture of
+    // another target on the unit leaves it bound.
+    if (!skipRedundantCall(mBoundTextures[unit] == texture.getTextureId()))
+    {
+        setActiveTexture(unit);
+        glBindTexture(texture.getTarget(), texture.getTextureId());
+        mBoundTextures[unit] = texture.getTextureId();
+    }
+    if (!skipRedundantCall(mBoundSamplers[unit] == texture.getSamplerId()))
+    {
+        glBindSampler(unit, texture.getSamplerId());
+        mBoundSamplers[unit] = texture.getSamplerId();
+    }
 
     ASSERT(glGetError() == GL_NO_ERROR);
 }
@@ -621,7 +991,7 @@ void ContextGL::setTexture(const TextureGL &texture, int index, int unit) const
 void ContextGL::setAttribs(const BufferGL &bufferGL, int index) const
 {
     ASSERT(index != -1);
-    glBindBuffer(bufferGL.getTarget(), bufferGL.getBuffer());
+    bindBuffer(bufferGL.getTarget(), bufferGL.getBuffer());
 
     glEnableVertexAttribArray(index);
     glVertexAttribPointer(index, bufferGL.getNumComponents(), bufferGL.getType(),
@@ -630,12 +1000,29 @@ void ContextGL::setAttribs(const BufferGL &bufferGL, int index) const
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
+void ContextGL::setInstancedAttrib(unsigned int buf,
+                                   int index,
+                                   int numComponents,
+                                   int stride,
+                                   size_t offset) const
+{
+    ASSERT(index != -1);
+    bindBuffer(GL_ARRAY_BUFFER, buf);
+
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, numComponents, GL_FLOAT, false, stride,
+                          reinterpret_cast<void *>(offset));
+    glVertexAttribDivisor(index, 1);
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+}
+
 void ContextGL::setIndices(const BufferGL &bufferGL) const
 {
     glBindBuffer(bufferGL.getTarget(), bufferGL.getBuffer());
 }
 
-unsigned int ContextGL::generateVAO()
+unsigned int ContextGL::generateVAO() const
 {
     unsigned int vao;
     glGenVertexArrays(1, &vao);
@@ -644,45 +1031,169 @@ unsigned int ContextGL::generateVAO()
 
 void ContextGL::bindVAO(unsigned int vao) const
 {
+    if (skipRedundantCall(mCurrentVertexArray == vao))
+    {
+        return;
+    }
     glBindVertexArray(vao);
+    mCurrentVertexArray = vao;
 }
 
-void ContextGL::deleteVAO(unsigned int mVAO)
+void ContextGL::deleteVAO(unsigned int mVAO) const
 {
     glDeleteVertexArrays(1, &mVAO);
+    // Deleting the bound VAO binds 0.
+    if (mCurrentVertexArray == mVAO)
+    {
+        mCurrentVertexArray = 0;
+    }
+}
+
+unsigned int ContextGL::createVertexArray(unsigned int programId,
+                                          const BufferGL &vertexBuffer,
+                                          const std::vector<VertexElement> &elements,
+                                          int stride,
+                                          const BufferGL &indexBuffer) const
+{
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    bindVAO(vao);
+    bindBuffer(vertexBuffer.getTarget(), vertexBuffer.getBuffer());
+
+    for (const auto &element : elements)
+    {
+        // Attributes which aren't used by the program are skipped, e.g. tangent and binormal
+        // of the diffuse program.
+        int index = getAttribLocation(programId, element.name);
+        if (index == -1)
+        {
+            continue;
+        }
+
+        GLenum type    = GL_FLOAT;
+        bool normalize = false;
+        switch (element.format)
+        {
+            case VertexElementFormat::FLOAT16:
+                type = GL_HALF_FLOAT;
+                break;
+            case VertexElementFormat::SNORM16:
+                type      = GL_SHORT;
+                normalize = true;
+                break;
+            case VertexElementFormat::UNORM16:
+                type      = GL_UNSIGNED_SHORT;
+                normalize = true;
+                break;
+            default:
+                break;
+        }
+
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, element.numComponents, type, normalize, stride,
+                              reinterpret_cast<void *>(static_cast<intptr_t>(element.offset)));
+    }
+
+    // The element array binding is a state of the VAO.
+    glBindBuffer(indexBuffer.getTarget(), indexBuffer.getBuffer());
+    bindVAO(0);
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+
+    return vao;
 }
 
-unsigned int ContextGL::generateBuffer()
+unsigned int ContextGL::generateBuffer() const
 {
     unsigned int buf;
     glGenBuffers(1, &buf);
     return buf;
 }
 
-void ContextGL::deleteBuffer(unsigned int buf)
+void ContextGL::deleteBuffer(unsigned int buf) const
 {
     glDeleteBuffers(1, &buf);
+    // Deleting a buffer unbinds it from all of the binding points.
+    for (auto &bound : mBoundBuffers)
+    {
+        if (bound.second == buf)
+        {
+            bound.second = 0;
+        }
+    }
+    for (BufferRangeGL &range : mBoundUniformBuffers)
+    {
+        if (range.buf == buf)
+        {
+            range = {0, 0, 0};
+        }
+    }
 }
 
-void ContextGL::bindBuffer(unsigned int target, unsigned int buf)
+void ContextGL::bindBuffer(unsigned int target, unsigned int buf) const
 {
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+    {
+        glBindBuffer(target, buf);
+        return;
+    }
+
+    unsigned int &bound = mBoundBuffers[target];
+    if (skipRedundantCall(bound == buf))
+    {
+        return;
+    }
     glBindBuffer(target, buf);
+    bound = buf;
+}
+
+void ContextGL::uploadBuffer(unsigned int target, const float *buf, size_t size)
+{
+    glBufferData(target, sizeof(GLfloat) * size, buf, GL_STATIC_DRAW);
+
+    ASSERT(glGetError() == GL_NO_ERROR);
 }
 
-void ContextGL::uploadBuffer(unsigned int target, const std::vector<float> &buf)
+void ContextGL::uploadBuffer(unsigned int target, const unsigned short *buf, size_t size)
 {
-    glBufferData(target, sizeof(GLfloat) * buf.size(), buf.data(), GL_STATIC_DRAW);
+    glBufferData(target, sizeof(GLushort) * size, buf, GL_STATIC_DRAW);
 
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
-void ContextGL::uploadBuffer(unsigned int target, const std::vector<unsigned short> &buf)
+void ContextGL::uploadStreamBuffer(unsigned int target,
+                                   unsigned int buf,
+                                   const void *data,
+                                   size_t size) const
 {
-    glBufferData(target, sizeof(GLushort) * buf.size(), buf.data(), GL_STATIC_DRAW);
+    // Respecify the whole store, so the driver can give a new one to the buffer instead of
+    // waiting for the draws of the previous frame reading the old one.
+    bindBuffer(target, buf);
+    glBufferData(target, size, data, GL_STREAM_DRAW);
 
     ASSERT(glGetError() == GL_NO_ERROR);
 }
 
+void ContextGL::bindUniformBuffer(unsigned int binding,
+                                  unsigned int buf,
+                                  size_t offset,
+                                  size_t size) const
+{
+    if (mBoundUniformBuffers.size() <= binding)
+    {
+        mBoundUniformBuffers.resize(binding + 1, {0, 0, 0});
+    }
+    BufferRangeGL &bound = mBoundUniformBuffers[binding];
+    if (skipRedundantCall(bound.buf == buf && bound.offset == offset && bound.size == size))
+    {
+        return;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buf, offset, size);
+    bound = {buf, offset, size};
+    // The generic binding point is bound as well.
+    mBoundBuffers[GL_UNIFORM_BUFFER] = buf;
+}
+
 unsigned int ContextGL::generateProgram()
 {
     return glCreateProgram();
@@ -690,60 +1201,217 @@ unsigned int ContextGL::generateProgram()
 
 void ContextGL::setProgram(unsigned int program)
 {
+    if (skipRedundantCall(mCurrentProgram == program))
+    {
+        return;
+    }
     glUseProgram(program);
+    mCurrentProgram       = program;
+    mCurrentUniformValues = &mUniformValues[program];
 }
 
 void ContextGL::deleteProgram(unsigned int program)
 {
+    // The program in use is only deleted once it's no longer in use, unbind it so its id is
+    // cached again if the driver gives it to another program.
+    if (mCurrentProgram == program)
+    {
+        setProgram(0);
+    }
     glDeleteProgram(program);
+    mUniformValues.erase(program);
 }
 
-bool ContextGL::compileProgram(unsigned int programId,
-                               const std::string &VertexShaderCode,
-                               const std::string &FragmentShaderCode)
+void ContextGL::bindUniformBlocks(unsigned int programId) const
 {
-    // Create the shaders
-    GLuint VertexShaderID   = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+    static const std::pair<const char *, UNIFORMBLOCKBINDING> kUniformBlocks[] = {
+        {"LightWorldPositionUniform", UNIFORMBLOCKLIGHTWORLDPOSITION},
+        {"LightUniforms", UNIFORMBLOCKLIGHT},
+        {"FogUniforms", UNIFORMBLOCKFOG},
+        {"FishVertexUniforms", UNIFORMBLOCKMODELVERTEX},
+        {"LightFactorUniforms", UNIFORMBLOCKMODELFRAGMENT},
+        {"InnerUniforms", UNIFORMBLOCKMODELFRAGMENT},
+        {"WorldUniforms", UNIFORMBLOCKINSTANCE},
+        {"FishPer", UNIFORMBLOCKINSTANCE},
+        {"SeaweedPer", UNIFORMBLOCKINSTANCE},
+    };
 
-    GLint Result = GL_FALSE;
-    int InfoLogLength;
+    // Programs declare the blocks they use, and blocks unused by the shaders are optimized away.
+    for (const auto &block : kUniformBlocks)
+    {
+        GLuint index = glGetUniformBlockIndex(programId, block.first);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(programId, index, block.second);
+        }
+    }
+}
+
+bool ContextGL::loadProgramBinary(unsigned int programId,
+                                  const std::string &cachePath,
+                                  uint64_t hash)
+{
+    std::ifstream stream(cachePath, std::ios::in | std::ios::binary);
+    ProgramBinaryHeader header;
+    if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, kProgramBinaryMagic, sizeof(kProgramBinaryMagic)) != 0 ||
+        header.version != kProgramBinaryVersion || header.hash != hash)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!stream.read(binary.data(), binary.size()))
+    {
+        return false;
+    }
+
+    // The driver may still reject a binary of a format it reports, such as after an update
+    // which doesn't change the version string. The program is then linked from the sources.
+    auto start = std::chrono::steady_clock::now();
+    glProgramBinary(programId, header.format, binary.data(), header.length);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(programId, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        return false;
+    }
+
+    mProgramCompileTimeSaved += std::max(header.compileTime - getSeconds(start), 0.0);
+    return true;
+}
+
+void ContextGL::saveProgramBinary(unsigned int programId,
+                                  const std::string &cachePath,
+                                  uint64_t hash,
+                                  double compileTime)
+{
+    GLint length = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, kProgramBinaryMagic, sizeof(kProgramBinaryMagic));
+    header.version     = kProgramBinaryVersion;
+    header.hash        = hash;
+    header.compileTime = compileTime;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(programId, length, &length, &format, binary.data());
+    if (glGetError() != GL_NO_ERROR)
+    {
+        return;
+    }
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    // Write to a temporary file first, so a reader never loads a partially written cache.
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.good())
+    {
+        return;
+    }
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(binary.data(), length);
+    stream.close();
+
+    if (stream.fail())
+    {
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+    }
+}
+
+void ContextGL::beginCompileProgram(unsigned int programId,
+                                    const std::string &VertexShaderCode,
+                                    const std::string &FragmentShaderCode,
+                                    const std::string &cachePath,
+                                    ProgramCompileGL *compile)
+{
+    compile->vertexShader   = 0;
+    compile->fragmentShader = 0;
+    compile->hash           = 0;
+    compile->cachePath      = cachePath;
+    compile->start          = std::chrono::steady_clock::now();
+
+    if (mProgramBinaryHash != 0)
+    {
+        compile->hash = hashString(VertexShaderCode, mProgramBinaryHash);
+        compile->hash = hashString(FragmentShaderCode, compile->hash);
+        if (loadProgramBinary(programId, cachePath, compile->hash))
+        {
+            ++mProgramCacheHits;
+            return;
+        }
+    }
+    ++mProgramCacheMisses;
+
+    // Statuses aren't queried until endCompileProgram(), so the driver can compile the shaders in
+    // the background meanwhile.
+    compile->vertexShader   = glCreateShader(GL_VERTEX_SHADER);
+    compile->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
-    // Compile Vertex Shader
     char const *VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer, nullptr);
-    glCompileShader(VertexShaderID);
+    glShaderSource(compile->vertexShader, 1, &VertexSourcePointer, nullptr);
+    glCompileShader(compile->vertexShader);
+
+    char const *FragmentSourcePointer = FragmentShaderCode.c_str();
+    glShaderSource(compile->fragmentShader, 1, &FragmentSourcePointer, nullptr);
+    glCompileShader(compile->fragmentShader);
+
+    glAttachShader(programId, compile->vertexShader);
+    glAttachShader(programId, compile->fragmentShader);
+    if (mProgramBinaryHash != 0)
+    {
+        glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(programId);
+}
+
+bool ContextGL::endCompileProgram(unsigned int programId, ProgramCompileGL *compile)
+{
+    // The program was loaded from the cache.
+    if (compile->vertexShader == 0)
+    {
+        return true;
+    }
+
+    GLint Result = GL_FALSE;
+    int InfoLogLength;
 
     // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
+    glGetShaderiv(compile->vertexShader, GL_COMPILE_STATUS, &Result);
     if (!Result)
     {
-        glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+        glGetShaderiv(compile->vertexShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
         std::vector<char> VertexShaderErrorMessage(InfoLogLength);
-        glGetShaderInfoLog(VertexShaderID, InfoLogLength, nullptr, &VertexShaderErrorMessage[0]);
+        glGetShaderInfoLog(compile->vertexShader, InfoLogLength, nullptr,
+                           &VertexShaderErrorMessage[0]);
         std::cout << stdout << &VertexShaderErrorMessage[0] << std::endl;
     }
 
-    // Compile Fragment Shader
-    char const *FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, nullptr);
-    glCompileShader(FragmentShaderID);
-
     // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
+    glGetShaderiv(compile->fragmentShader, GL_COMPILE_STATUS, &Result);
     if (!Result)
     {
-        glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+        glGetShaderiv(compile->fragmentShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
         std::vector<char> FragmentShaderErrorMessage(InfoLogLength);
-        glGetShaderInfoLog(FragmentShaderID, InfoLogLength, nullptr, &FragmentShaderErrorMessage[0]);
+        glGetShaderInfoLog(compile->fragmentShader, InfoLogLength, nullptr,
+                           &FragmentShaderErrorMessage[0]);
         std::cout << stdout << &FragmentShaderErrorMessage[0] << std::endl;
     }
 
-    // Link the program
-    glAttachShader(programId, VertexShaderID);
-    glAttachShader(programId, FragmentShaderID);
-    glLinkProgram(programId);
-
     // Check the program
     glGetProgramiv(programId, GL_LINK_STATUS, &Result);
     if (!Result)
@@ -753,8 +1421,21 @@ bool ContextGL::compileProgram(unsigned int programId,
         glGetProgramInfoLog(programId, InfoLogLength, nullptr, &ProgramErrorMessage[0]);
         std::cout << stdout << &ProgramErrorMessage[0] << std::endl;
     }
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
+    glDetachShader(programId, compile->vertexShader);
+    glDetachShader(programId, compile->fragmentShader);
+    glDeleteShader(compile->vertexShader);
+    glDeleteShader(compile->fragmentShader);
+    compile->vertexShader   = 0;
+    compile->fragmentShader = 0;
+
+    // Programs compiled in parallel overlap, so this is the latency of the program rather than
+    // the time the driver spent on it.
+    double compileTime = getSeconds(compile->start);
+    mProgramCompileTime += compileTime;
+    if (Result && mProgramBinaryHash != 0)
+    {
+        saveProgramBinary(programId, compile->cachePath, compile->hash, compileTime);
+    }
 
     return true;
 }
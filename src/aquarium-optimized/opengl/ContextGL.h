@@ -20,6 +20,11 @@
 #include "glad/glad.h"
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include "GLFW/glfw3.h"
@@ -28,8 +33,43 @@
 
 class BufferGL;
 class TextureGL;
+class UniformBufferGL;
+struct VertexElement;
 enum BACKENDTYPE: short;
 
+// Binding points of the uniform blocks of the OpenGL 4.5 shaders. The blocks mirror the uniform
+// blocks of the Dawn shaders.
+enum UNIFORMBLOCKBINDING : unsigned int
+{
+    UNIFORMBLOCKLIGHTWORLDPOSITION,
+    UNIFORMBLOCKLIGHT,
+    UNIFORMBLOCKFOG,
+    // Uniforms of a model, read by the vertex and the fragment shader.
+    UNIFORMBLOCKMODELVERTEX,
+    UNIFORMBLOCKMODELFRAGMENT,
+    // Uniforms of an instance of a model.
+    UNIFORMBLOCKINSTANCE,
+};
+
+// A program being compiled, between ContextGL::beginCompileProgram() and endCompileProgram().
+struct ProgramCompileGL
+{
+    // 0 if the program is loaded from the program binary cache.
+    unsigned int vertexShader;
+    unsigned int fragmentShader;
+    uint64_t hash;
+    std::string cachePath;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Counts of the calls to the driver which go through the state cache of ContextGL.
+struct StateCacheStatsGL
+{
+    int issued;
+    // Skipped because they would set the state the driver already has.
+    int skipped;
+};
+
 class ContextGL : public Context
 {
   public:
@@ -44,11 +84,16 @@ class ContextGL : public Context
     void DoFlush() override;
     void Terminate() override;
     void showWindow() override;
-    void showFPS(const FPSTimer &fpsTimer) override;
+    void showFPS(const FPSTimer &fpsTimer, const CullingStats &cullingStats) override;
     void destoryImgUI() override;
 
     void preFrame() override;
     void enableBlend(bool flag) const;
+    // Of the frame being drawn, reset by preFrame().
+    const StateCacheStatsGL &getStateCacheStats() const { return mStateCacheStats; }
+
+    void initGeneralResources(Aquarium *aquarium) override;
+    void updateWorldlUniforms(Aquarium *aquarium) override;
 
     Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
     int getUniformLocation(unsigned int programId, const std::string &name) const;
@@ -58,27 +103,75 @@ class ContextGL : public Context
     void setAttribs(const BufferGL &bufferGL, int index) const;
     void setIndices(const BufferGL &bufferGL) const;
     void drawElements(const BufferGL &buffer) const;
+    void drawElementsInstanced(const BufferGL &buffer, int instanceCount) const;
+    // Source the attribute at index from buf once per instance. The VAO must be bound.
+    void setInstancedAttrib(unsigned int buf,
+                            int index,
+                            int numComponents,
+                            int stride,
+                            size_t offset) const;
 
-    Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) override;
     Buffer *createBuffer(int numComponents,
-                         std::vector<unsigned short> *buffer,
+                         const float *buffer,
+                         size_t size,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const unsigned short *buffer,
+                         size_t size,
                          bool isIndex) override;
-    unsigned int generateBuffer();
-    void deleteBuffer(unsigned int buf);
-    void bindBuffer(unsigned int target, unsigned int buf);
-    void uploadBuffer(unsigned int target, const std::vector<float> &buf);
-    void uploadBuffer(unsigned int target, const std::vector<unsigned short> &buf);
+    unsigned int generateBuffer() const;
+    void deleteBuffer(unsigned int buf) const;
+    void bindBuffer(unsigned int target, unsigned int buf) const;
+    void uploadBuffer(unsigned int target, const float *buf, size_t size);
+    void uploadBuffer(unsigned int target, const unsigned short *buf, size_t size);
+    // The uniforms of the 4.5 shaders are in uniform blocks, which are updated once a frame and
+    // bound to the binding points of UNIFORMBLOCKBINDING. The ES 2.0 shaders of ANGLE have no
+    // uniform blocks, so their uniforms are set for each model and each instance.
+    bool useUniformBlocks() const { return mUseUniformBlocks; }
+    size_t getUniformBufferAlignment() const { return mUniformBufferAlignment; }
+    // Upload data which is respecified every frame, such as uniform blocks and the attributes of
+    // instances.
+    void uploadStreamBuffer(unsigned int target,
+                            unsigned int buf,
+                            const void *data,
+                            size_t size) const;
+    void bindUniformBuffer(unsigned int binding,
+                           unsigned int buf,
+                           size_t offset,
+                           size_t size) const;
+    // Bind the uniform buffers shared by all of the models, after a model bound one of its own in
+    // their place.
+    void bindGeneralUniformBuffers() const;
 
-    Program *createProgram(const std::string &mVId, const std::string &mFId) override;
+    Program *createProgram(const std::string &mVId,
+                           const std::string &mFId,
+                           uint32_t features) override;
     unsigned int generateProgram();
     void setProgram(unsigned int program);
     void deleteProgram(unsigned int program);
-    bool compileProgram(unsigned int programId,
-                        const std::string &VertexShaderCode,
-                        const std::string &FragmentShaderCode);
+    // Assign the uniform blocks of the program to their binding points.
+    void bindUniformBlocks(unsigned int programId) const;
+    // Link the program from the binary cached at cachePath if the cache is built from the same
+    // sources by the same driver, otherwise start compiling it from the sources. Doesn't wait for
+    // the driver, so programs begun one after another compile in parallel if the driver supports
+    // GL_KHR_parallel_shader_compile.
+    void beginCompileProgram(unsigned int programId,
+                             const std::string &VertexShaderCode,
+                             const std::string &FragmentShaderCode,
+                             const std::string &cachePath,
+                             ProgramCompileGL *compile);
+    // Wait for the program to be linked, report errors, and cache its binary.
+    bool endCompileProgram(unsigned int programId, ProgramCompileGL *compile);
     void bindVAO(unsigned int vao) const;
-    unsigned int generateVAO();
-    void deleteVAO(unsigned int vao);
+    unsigned int generateVAO() const;
+    void deleteVAO(unsigned int vao) const;
+    // Create a VAO which sources all of the attributes of the program from one interleaved
+    // vertex buffer. stride is the size of a vertex in bytes.
+    unsigned int createVertexArray(unsigned int programId,
+                                   const BufferGL &vertexBuffer,
+                                   const std::vector<VertexElement> &elements,
+                                   int stride,
+                                   const BufferGL &indexBuffer) const;
 
     Texture *createTexture(const std::string &name, const std::string &url) override;
     Texture *createTexture(const std::string &name, const std::vector<std::string> &urls) override;
@@ -89,18 +182,83 @@ class ContextGL : public Context
                        unsigned int format,
                        int width,
                        int height,
-                       unsigned char *pixel);
+                       const unsigned char *pixel,
+                       int level = 0);
     void setParameter(unsigned int target, unsigned int pname, int param);
     void generateMipmap(unsigned int target);
+    // Get the sampler object of the sampler state, which is shared by all of the textures
+    // sampled with the same state instead of setting the state on every texture.
+    unsigned int getSampler(int minFilter, int magFilter, int wrap);
 
   private:
+    // Count a call through the state cache, and return true if it changes nothing and is
+    // skipped.
+    bool skipRedundantCall(bool redundant) const;
+    void setActiveTexture(unsigned int unit) const;
+    // Record the value of the uniform at location of the current program, and return true if
+    // the program already has it.
+    bool cacheUniformValue(int location, const float *v, int count) const;
     void initState();
     void initAvailableToggleBitset(BACKENDTYPE backendType) override;
+    // Hash the driver, so binaries cached by another driver or another version are rebuilt.
+    void initProgramBinaryHash();
+    // Let the driver compile shaders on threads of its own if it supports it.
+    void initParallelShaderCompile();
+    bool loadProgramBinary(unsigned int programId, const std::string &cachePath, uint64_t hash);
+    void saveProgramBinary(unsigned int programId,
+                           const std::string &cachePath,
+                           uint64_t hash,
+                           double compileTime);
 
     GLFWwindow *mWindow;
     std::string mGLSLVersion;
     std::string mRenderer;
 
+    // Keyed by min filter, mag filter and wrap mode.
+    std::map<std::tuple<int, int, int>, unsigned int> mSamplers;
+    int mSamplerRequestCount;
+
+    // 0 if the driver supports no program binary formats, so programs aren't cached.
+    uint64_t mProgramBinaryHash;
+    int mProgramCacheHits;
+    int mProgramCacheMisses;
+    // In seconds. The time saved is the compile time recorded in the cache minus the load time.
+    double mProgramCompileTime;
+    double mProgramCompileTimeSaved;
+    bool mParallelShaderCompile;
+
+    bool mUseUniformBlocks;
+    size_t mUniformBufferAlignment;
+    UniformBufferGL *mLightWorldPositionBuffer;
+    UniformBufferGL *mLightBuffer;
+    UniformBufferGL *mFogBuffer;
+
+    // Shadow of the state of the driver, so calls which set the state it already has are
+    // skipped. GL calls made outside of ContextGL must restore the state, as ImGui does.
+    struct BufferRangeGL
+    {
+        unsigned int buf;
+        size_t offset;
+        size_t size;
+    };
+    mutable unsigned int mCurrentProgram;
+    mutable unsigned int mCurrentVertexArray;
+    mutable bool mBlendEnabled;
+    mutable unsigned int mActiveTextureUnit;
+    // Indexed by texture unit.
+    mutable std::vector<unsigned int> mBoundTextures;
+    mutable std::vector<unsigned int> mBoundSamplers;
+    // Keyed by target, except GL_ELEMENT_ARRAY_BUFFER whose binding is a state of the VAO.
+    mutable std::map<unsigned int, unsigned int> mBoundBuffers;
+    // Indexed by UNIFORMBLOCKBINDING.
+    mutable std::vector<BufferRangeGL> mBoundUniformBuffers;
+    // Values of the uniforms of every program, indexed by location. A value is empty until it's
+    // set.
+    std::map<unsigned int, std::vector<std::vector<float>>> mUniformValues;
+    mutable std::vector<std::vector<float>> *mCurrentUniformValues;
+    mutable StateCacheStatsGL mStateCacheStats;
+    StateCacheStatsGL mTotalStateCacheStats;
+
 #ifdef EGL_EGL_PROTOTYPES
     EGLBoolean FindEGLConfig(EGLDisplay dpy, const EGLint *attrib_list, EGLConfig *config);
     EGLContext createContext(EGLContext share) const;
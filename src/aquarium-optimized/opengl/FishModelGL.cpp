@@ -14,7 +14,12 @@ FishModelGL::FishModelGL(const ContextGL *mContextGL,
                          MODELGROUP type,
                          MODELNAME name,
                          bool blend)
-    : FishModel(type, name, blend), mContextGL(mContextGL)
+    : FishModel(type, name, blend),
+      mVertexArray(0),
+      mFishVertexBuffer(nullptr),
+      mLightFactorBuffer(nullptr),
+      mFishPerBuffer(nullptr),
+      mContextGL(mContextGL)
 {
     mViewInverseUniform.first    = aquarium->lightWorldPositionUniform.viewInverse;
     mLightWorldPosUniform.first  = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -35,6 +40,23 @@ FishModelGL::FishModelGL(const ContextGL *mContextGL,
     mFishLengthUniform.first          = fishInfo.fishLength;
     mFishBendAmountUniform.first      = fishInfo.fishBendAmount;
     mFishWaveLengthUniform.first      = fishInfo.fishWaveLength;
+
+    mFishVertexUniforms.fishLength      = fishInfo.fishLength;
+    mFishVertexUniforms.fishWaveLength  = fishInfo.fishWaveLength;
+    mFishVertexUniforms.fishBendAmount  = fishInfo.fishBendAmount;
+    mLightFactorUniforms.shininess      = mShininessUniform.first;
+    mLightFactorUniforms.specularFactor = mSpecularFactorUniform.first;
+}
+
+FishModelGL::~FishModelGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    delete mFishVertexBuffer;
+    delete mLightFactorBuffer;
+    delete mFishPerBuffer;
 }
 
 void FishModelGL::init()
@@ -97,11 +119,42 @@ void FishModelGL::init()
     mBiNormalBuffer.second = mContextGL->getAttribLocation(programGL->getProgramId(), "binormal");
 
     mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programGL->getProgramId(), *static_cast<BufferGL *>(bufferMap["vertices"]),
+            vertexElements, vertexStride, *mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mFishVertexBuffer = new UniformBufferGL(mContextGL, sizeof(FishVertexUniforms));
+        mFishVertexBuffer->setElement(0, &mFishVertexUniforms);
+        mFishVertexBuffer->upload(1);
+        mLightFactorBuffer = new UniformBufferGL(mContextGL, sizeof(LightFactorUniforms));
+        mLightFactorBuffer->setElement(0, &mLightFactorUniforms);
+        mLightFactorBuffer->upload(1);
+        mFishPerBuffer = new UniformBufferGL(mContextGL, sizeof(FishPer));
+    }
 }
 
 void FishModelGL::draw()
 {
-    mContextGL->drawElements(*mIndicesBuffer);
+    if (!mContextGL->useUniformBlocks())
+    {
+        mContextGL->drawElements(*mIndicesBuffer);
+        return;
+    }
+
+    // The fish are drawn once for every species, so the state of the species is set here.
+    prepareForDraw();
+    mFishPerBuffer->upload(mCurInstance);
+    for (int i = 0; i < mCurInstance; ++i)
+    {
+        mFishPerBuffer->bind(UNIFORMBLOCKINSTANCE, i);
+        mContextGL->drawElements(*mIndicesBuffer);
+    }
 }
 
 void FishModelGL::prepareForDraw() const
@@ -110,35 +163,54 @@ void FishModelGL::prepareForDraw() const
     mContextGL->enableBlend(mBlend);
 
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
-    mContextGL->bindVAO(programGL->getVAOId());
+    if (mVertexArray != 0)
+    {
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mContextGL->bindVAO(programGL->getVAOId());
 
-    mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
-    mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
-    mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
 
-    mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
-    mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
+        mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
+        mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
 
-    mContextGL->setIndices(*mIndicesBuffer);
+        mContextGL->setIndices(*mIndicesBuffer);
+    }
 
-    mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first, GL_FLOAT_MAT4);
-    mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
-                           GL_FLOAT_VEC3);
-    mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
-
-    mContextGL->setUniform(mViewProjectionUniform.second, mViewProjectionUniform.first,
-                           GL_FLOAT_MAT4);
-    mContextGL->setUniform(mFishBendAmountUniform.second, &mFishBendAmountUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFishLengthUniform.second, &mFishLengthUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFishWaveLengthUniform.second, &mFishWaveLengthUniform.first, GL_FLOAT);
+    if (mContextGL->useUniformBlocks())
+    {
+        mFishVertexBuffer->bind(UNIFORMBLOCKMODELVERTEX, 0);
+        mLightFactorBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+    }
+    else
+    {
+        mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first,
+                               GL_FLOAT_MAT4);
+        mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
+                               GL_FLOAT_VEC3);
+        mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+
+        mContextGL->setUniform(mViewProjectionUniform.second, mViewProjectionUniform.first,
+                               GL_FLOAT_MAT4);
+        mContextGL->setUniform(mFishBendAmountUniform.second, &mFishBendAmountUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mFishLengthUniform.second, &mFishLengthUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFishWaveLengthUniform.second, &mFishWaveLengthUniform.first,
+                               GL_FLOAT);
+    }
 
     // Fish models includes small, medium and big. Some of them contains reflection and skybox
     // texture, but some doesn't.
@@ -170,6 +242,13 @@ void FishModelGL::updateFishPerUniforms(float x,
                                         float time,
                                         int index)
 {
+    if (mContextGL->useUniformBlocks())
+    {
+        FishPer fishPer = {{x, y, z}, scale, {nextX, nextY, nextZ}, time};
+        mFishPerBuffer->setElement(index, &fishPer);
+        return;
+    }
+
     mWorldPositionUniform.first[0] = x;
     mWorldPositionUniform.first[1] = y;
     mWorldPositionUniform.first[2] = z;
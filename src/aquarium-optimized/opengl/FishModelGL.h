@@ -10,6 +10,8 @@
 
 #include <string>
 
+#include "UniformBufferGL.h"
+
 #include "../FishModel.h"
 
 class TextureGL;
@@ -19,6 +21,7 @@ class FishModelGL : public FishModel
 {
   public:
     FishModelGL(const ContextGL *context, Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend);
+    ~FishModelGL() override;
     void prepareForDraw() const override;
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
 
@@ -72,6 +75,35 @@ class FishModelGL : public FishModel
     std::pair<BufferGL *, int> mBiNormalBuffer;
 
     BufferGL *mIndicesBuffer;
+    // VAO of the interleaved vertex buffer, or 0 if the attributes are in separate buffers.
+    unsigned int mVertexArray;
+
+    struct FishVertexUniforms
+    {
+        float fishLength;
+        float fishWaveLength;
+        float fishBendAmount;
+    } mFishVertexUniforms;
+
+    struct LightFactorUniforms
+    {
+        float shininess;
+        float specularFactor;
+    } mLightFactorUniforms;
+
+    struct FishPer
+    {
+        float worldPosition[3];
+        float scale;
+        float nextPosition[3];
+        float time;
+    };
+
+    // Created if the context uses uniform blocks. The uniforms of the fish are staged by
+    // updateFishPerUniforms(), and uploaded at once by draw().
+    UniformBufferGL *mFishVertexBuffer;
+    UniformBufferGL *mLightFactorBuffer;
+    UniformBufferGL *mFishPerBuffer;
 
   private:
     const ContextGL *mContextGL;
@@ -0,0 +1,186 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishModelInstancedDrawGL.cpp: Implements instanced fish model of OpenGL.
+
+#include <cstddef>
+
+#include "ContextGL.h"
+#include "FishModelInstancedDrawGL.h"
+#include "ProgramGL.h"
+
+#include "common/AQUARIUM_ASSERT.h"
+
+FishModelInstancedDrawGL::FishModelInstancedDrawGL(const ContextGL *mContextGL,
+                                                   Aquarium *aquarium,
+                                                   MODELGROUP type,
+                                                   MODELNAME name,
+                                                   bool blend)
+    : FishModel(type, name, blend),
+      mFishPers(),
+      mIndicesBuffer(nullptr),
+      mVertexArray(0),
+      mFishPersBuffer(0),
+      mFishVertexBuffer(nullptr),
+      mLightFactorBuffer(nullptr),
+      mContextGL(mContextGL)
+{
+    mLightFactorUniforms.shininess      = 5.0f;
+    mLightFactorUniforms.specularFactor = 0.3f;
+
+    const Fish &fishInfo = fishTable[name - MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS];
+    mFishVertexUniforms.fishLength     = fishInfo.fishLength;
+    mFishVertexUniforms.fishWaveLength = fishInfo.fishWaveLength;
+    mFishVertexUniforms.fishBendAmount = fishInfo.fishBendAmount;
+
+    mFishPers.resize(aquarium->fishCount[fishInfo.modelName - MODELNAME::MODELSMALLFISHA]);
+}
+
+FishModelInstancedDrawGL::~FishModelInstancedDrawGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    if (mFishPersBuffer != 0)
+    {
+        mContextGL->deleteBuffer(mFishPersBuffer);
+    }
+    delete mFishVertexBuffer;
+    delete mLightFactorBuffer;
+}
+
+void FishModelInstancedDrawGL::init()
+{
+    // The instanced vertex shader is only ported to the 4.5 shaders, which have uniform blocks.
+    ASSERT(mContextGL->useUniformBlocks());
+
+    ProgramGL *programGL   = static_cast<ProgramGL *>(mProgram);
+    unsigned int programId = programGL->getProgramId();
+
+    mDiffuseTexture.first     = static_cast<TextureGL *>(textureMap["diffuse"]);
+    mDiffuseTexture.second    = mContextGL->getUniformLocation(programId, "diffuse");
+    mNormalTexture.first      = static_cast<TextureGL *>(textureMap["normalMap"]);
+    mNormalTexture.second     = mContextGL->getUniformLocation(programId, "normalMap");
+    mReflectionTexture.first  = static_cast<TextureGL *>(textureMap["reflectionMap"]);
+    mReflectionTexture.second = mContextGL->getUniformLocation(programId, "reflectionMap");
+    mSkyboxTexture.first      = static_cast<TextureGL *>(textureMap["skybox"]);
+    mSkyboxTexture.second     = mContextGL->getUniformLocation(programId, "skybox");
+
+    mPositionBuffer.first  = static_cast<BufferGL *>(bufferMap["position"]);
+    mPositionBuffer.second = mContextGL->getAttribLocation(programId, "position");
+    mNormalBuffer.first    = static_cast<BufferGL *>(bufferMap["normal"]);
+    mNormalBuffer.second   = mContextGL->getAttribLocation(programId, "normal");
+    mTexCoordBuffer.first  = static_cast<BufferGL *>(bufferMap["texCoord"]);
+    mTexCoordBuffer.second = mContextGL->getAttribLocation(programId, "texCoord");
+    mTangentBuffer.first   = static_cast<BufferGL *>(bufferMap["tangent"]);
+    mTangentBuffer.second  = mContextGL->getAttribLocation(programId, "tangent");
+    mBiNormalBuffer.first  = static_cast<BufferGL *>(bufferMap["binormal"]);
+    mBiNormalBuffer.second = mContextGL->getAttribLocation(programId, "binormal");
+
+    mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    // Unlike the fish model, the attributes of the instances are part of the VAO, so the model
+    // owns a VAO in either vertex layout.
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programId, *static_cast<BufferGL *>(bufferMap["vertices"]), vertexElements,
+            vertexStride, *mIndicesBuffer);
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mVertexArray = mContextGL->generateVAO();
+        mContextGL->bindVAO(mVertexArray);
+
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+
+        mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
+        mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
+
+        mContextGL->setIndices(*mIndicesBuffer);
+    }
+
+    mFishPersBuffer = mContextGL->generateBuffer();
+    mContextGL->setInstancedAttrib(mFishPersBuffer,
+                                   mContextGL->getAttribLocation(programId, "worldPosition"), 3,
+                                   sizeof(FishPer), offsetof(FishPer, worldPosition));
+    mContextGL->setInstancedAttrib(mFishPersBuffer,
+                                   mContextGL->getAttribLocation(programId, "scale"), 1,
+                                   sizeof(FishPer), offsetof(FishPer, scale));
+    mContextGL->setInstancedAttrib(mFishPersBuffer,
+                                   mContextGL->getAttribLocation(programId, "nextPosition"), 3,
+                                   sizeof(FishPer), offsetof(FishPer, nextPosition));
+    mContextGL->setInstancedAttrib(mFishPersBuffer,
+                                   mContextGL->getAttribLocation(programId, "time"), 1,
+                                   sizeof(FishPer), offsetof(FishPer, time));
+    mContextGL->bindVAO(0);
+
+    mFishVertexBuffer = new UniformBufferGL(mContextGL, sizeof(FishVertexUniforms));
+    mFishVertexBuffer->setElement(0, &mFishVertexUniforms);
+    mFishVertexBuffer->upload(1);
+    mLightFactorBuffer = new UniformBufferGL(mContextGL, sizeof(LightFactorUniforms));
+    mLightFactorBuffer->setElement(0, &mLightFactorUniforms);
+    mLightFactorBuffer->upload(1);
+}
+
+void FishModelInstancedDrawGL::draw()
+{
+    if (mCurInstance == 0)
+    {
+        return;
+    }
+
+    prepareForDraw();
+    mContextGL->uploadStreamBuffer(GL_ARRAY_BUFFER, mFishPersBuffer, mFishPers.data(),
+                                   mCurInstance * sizeof(FishPer));
+    mContextGL->drawElementsInstanced(*mIndicesBuffer, mCurInstance);
+}
+
+void FishModelInstancedDrawGL::prepareForDraw() const
+{
+    mProgram->setProgram();
+    mContextGL->enableBlend(mBlend);
+    mContextGL->bindVAO(mVertexArray);
+
+    mFishVertexBuffer->bind(UNIFORMBLOCKMODELVERTEX, 0);
+    mLightFactorBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+
+    mContextGL->setTexture(*mDiffuseTexture.first, mDiffuseTexture.second, 0);
+    mContextGL->setTexture(*mNormalTexture.first, mNormalTexture.second, 1);
+    if (mSkyboxTexture.second != -1 && mReflectionTexture.second != -1)
+    {
+        mContextGL->setTexture(*mReflectionTexture.first, mReflectionTexture.second, 2);
+        mContextGL->setTexture(*mSkyboxTexture.first, mSkyboxTexture.second, 3);
+    }
+}
+
+void FishModelInstancedDrawGL::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
+{
+}
+
+void FishModelInstancedDrawGL::updateFishPerUniforms(float x,
+                                                     float y,
+                                                     float z,
+                                                     float nextX,
+                                                     float nextY,
+                                                     float nextZ,
+                                                     float scale,
+                                                     float time,
+                                                     int index)
+{
+    FishPer &fishPer         = mFishPers[index];
+    fishPer.worldPosition[0] = x;
+    fishPer.worldPosition[1] = y;
+    fishPer.worldPosition[2] = z;
+    fishPer.nextPosition[0]  = nextX;
+    fishPer.nextPosition[1]  = nextY;
+    fishPer.nextPosition[2]  = nextZ;
+    fishPer.scale            = scale;
+    fishPer.time             = time;
+}
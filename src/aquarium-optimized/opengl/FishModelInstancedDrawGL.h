@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishModelInstancedDrawGL.h: Defines instanced fish model of OpenGL. All of the fish of a
+// species are drawn by one instanced draw, sourcing their positions from a per instance vertex
+// buffer.
+
+#pragma once
+#ifndef FISHMODELINSTANCEDDRAWGL_H
+#define FISHMODELINSTANCEDDRAWGL_H 1
+
+#include <string>
+#include <vector>
+
+#include "UniformBufferGL.h"
+
+#include "../FishModel.h"
+
+class TextureGL;
+class BufferGL;
+
+class FishModelInstancedDrawGL : public FishModel
+{
+  public:
+    FishModelInstancedDrawGL(const ContextGL *context,
+                             Aquarium *aquarium,
+                             MODELGROUP type,
+                             MODELNAME name,
+                             bool blend);
+    ~FishModelInstancedDrawGL() override;
+
+    void init() override;
+    void prepareForDraw() const override;
+    void draw() override;
+
+    void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    void updateFishPerUniforms(float x,
+                               float y,
+                               float z,
+                               float nextX,
+                               float nextY,
+                               float nextZ,
+                               float scale,
+                               float time,
+                               int index) override;
+
+    struct FishVertexUniforms
+    {
+        float fishLength;
+        float fishWaveLength;
+        float fishBendAmount;
+    } mFishVertexUniforms;
+
+    struct LightFactorUniforms
+    {
+        float shininess;
+        float specularFactor;
+    } mLightFactorUniforms;
+
+    struct FishPer
+    {
+        float worldPosition[3];
+        float scale;
+        float nextPosition[3];
+        float time;
+    };
+    // Staged by updateFishPerUniforms(), and uploaded at once by draw().
+    std::vector<FishPer> mFishPers;
+
+    std::pair<TextureGL *, int> mDiffuseTexture;
+    std::pair<TextureGL *, int> mNormalTexture;
+    std::pair<TextureGL *, int> mReflectionTexture;
+    std::pair<TextureGL *, int> mSkyboxTexture;
+
+    std::pair<BufferGL *, int> mPositionBuffer;
+    std::pair<BufferGL *, int> mNormalBuffer;
+    std::pair<BufferGL *, int> mTexCoordBuffer;
+    std::pair<BufferGL *, int> mTangentBuffer;
+    std::pair<BufferGL *, int> mBiNormalBuffer;
+
+    BufferGL *mIndicesBuffer;
+    // Sources the attributes of the vertices, and the attributes of the instances from
+    // mFishPersBuffer.
+    unsigned int mVertexArray;
+    unsigned int mFishPersBuffer;
+
+    UniformBufferGL *mFishVertexBuffer;
+    UniformBufferGL *mLightFactorBuffer;
+
+  private:
+    const ContextGL *mContextGL;
+};
+
+#endif  // !FISHMODELINSTANCEDDRAWGL_H
@@ -12,7 +12,12 @@ GenericModelGL::GenericModelGL(const ContextGL *context,
                                MODELGROUP type,
                                MODELNAME name,
                                bool blend)
-    : Model(type, name, blend), mContextGL(context)
+    : Model(type, name, blend),
+      mVertexArray(0),
+      mLightFactorBuffer(nullptr),
+      mWorldBuffer(nullptr),
+      mInstanceCount(0),
+      mContextGL(context)
 {
     mViewInverseUniform.first           = aquarium->lightWorldPositionUniform.viewInverse;
     mLightWorldPosUniform.first         = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -28,6 +33,19 @@ GenericModelGL::GenericModelGL(const ContextGL *context,
     mFogMultUniform.first               = g_fogMult;
     mFogOffsetUniform.first             = g_fogOffset;
     mFogColorUniform.first              = aquarium->fogUniforms.fogColor;
+
+    mLightFactorUniforms.shininess      = mShininessUniform.first;
+    mLightFactorUniforms.specularFactor = mSpecularFactorUniform.first;
+}
+
+GenericModelGL::~GenericModelGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    delete mLightFactorBuffer;
+    delete mWorldBuffer;
 }
 
 void GenericModelGL::init()
@@ -75,11 +93,38 @@ void GenericModelGL::init()
     mBiNormalBuffer.second = mContextGL->getAttribLocation(programGL->getProgramId(), "binormal");
 
     mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programGL->getProgramId(), *static_cast<BufferGL *>(bufferMap["vertices"]),
+            vertexElements, vertexStride, *mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer = new UniformBufferGL(mContextGL, sizeof(LightFactorUniforms));
+        mLightFactorBuffer->setElement(0, &mLightFactorUniforms);
+        mLightFactorBuffer->upload(1);
+        mWorldBuffer = new UniformBufferGL(mContextGL, sizeof(WorldUniforms));
+    }
 }
 
 void GenericModelGL::draw()
 {
-    mContextGL->drawElements(*mIndicesBuffer);
+    if (!mContextGL->useUniformBlocks())
+    {
+        mContextGL->drawElements(*mIndicesBuffer);
+        return;
+    }
+
+    mWorldBuffer->upload(mInstanceCount);
+    for (int i = 0; i < mInstanceCount; ++i)
+    {
+        mWorldBuffer->bind(UNIFORMBLOCKINSTANCE, i);
+        mContextGL->drawElements(*mIndicesBuffer);
+    }
+    mInstanceCount = 0;
 }
 
 void GenericModelGL::prepareForDraw() const
@@ -88,34 +133,51 @@ void GenericModelGL::prepareForDraw() const
     mContextGL->enableBlend(mBlend);
 
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
-    mContextGL->bindVAO(programGL->getVAOId());
+    if (mVertexArray != 0)
+    {
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mContextGL->bindVAO(programGL->getVAOId());
 
-    mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
-    mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
-    mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
 
-    // diffuseVertexShader doesn't contains tangent and binormal but normalMapVertexShader
-    // contains the two buffers.
-    if (mTangentBuffer.second != -1 && mBiNormalBuffer.second != -1)
-    {
-        mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
-        mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
+        // diffuseVertexShader doesn't contains tangent and binormal but normalMapVertexShader
+        // contains the two buffers.
+        if (mTangentBuffer.second != -1 && mBiNormalBuffer.second != -1)
+        {
+            mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
+            mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
+        }
+
+        mContextGL->setIndices(*mIndicesBuffer);
     }
 
-    mContextGL->setIndices(*mIndicesBuffer);
-
-    mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first, GL_FLOAT_MAT4);
-    mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
-                           GL_FLOAT_VEC3);
-    mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+    }
+    else
+    {
+        mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first,
+                               GL_FLOAT_MAT4);
+        mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
+                               GL_FLOAT_VEC3);
+        mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first,
+                               GL_FLOAT_VEC4);
+        mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+    }
 
     mContextGL->setTexture(*mDiffuseTexture.first, mDiffuseTexture.second, 0);
     // Generic models includes Arch, coral, rock, ship, etc. diffuseFragmentShader doesn't contain
@@ -128,6 +190,12 @@ void GenericModelGL::prepareForDraw() const
 
 void GenericModelGL::updatePerInstanceUniforms(const WorldUniforms &mWorldUniforms)
 {
+    if (mContextGL->useUniformBlocks())
+    {
+        mWorldBuffer->setElement(mInstanceCount++, &mWorldUniforms);
+        return;
+    }
+
     mContextGL->setUniform(mWorldUniform.second, mWorldUniform.first, GL_FLOAT_MAT4);
     mContextGL->setUniform(mWorldViewProjectionUniform.second, mWorldViewProjectionUniform.first,
                            GL_FLOAT_MAT4);
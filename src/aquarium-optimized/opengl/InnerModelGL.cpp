@@ -12,7 +12,12 @@ InnerModelGL::InnerModelGL(const ContextGL *context,
                            MODELGROUP type,
                            MODELNAME name,
                            bool blend)
-    : Model(type, name, blend), mContextGL(context)
+    : Model(type, name, blend),
+      mVertexArray(0),
+      mInnerBuffer(nullptr),
+      mWorldBuffer(nullptr),
+      mInstanceCount(0),
+      mContextGL(context)
 {
     mViewInverseUniform.first   = aquarium->lightWorldPositionUniform.viewInverse;
     mLightWorldPosUniform.first = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -29,6 +34,21 @@ InnerModelGL::InnerModelGL(const ContextGL *context,
     mFogMultUniform.first   = g_fogMult;
     mFogOffsetUniform.first = g_fogOffset;
     mFogColorUniform.first  = aquarium->fogUniforms.fogColor;
+
+    mInnerUniforms.eta             = mEtaUniform.first;
+    mInnerUniforms.tankColorFudge  = mTankColorFudgeUniform.first;
+    mInnerUniforms.refractionFudge = mRefractionFudgeUniform.first;
+    mInnerUniforms.padding         = 0.0f;
+}
+
+InnerModelGL::~InnerModelGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    delete mInnerBuffer;
+    delete mWorldBuffer;
 }
 
 void InnerModelGL::init()
@@ -79,11 +99,38 @@ void InnerModelGL::init()
     mBiNormalBuffer.second = mContextGL->getAttribLocation(programGL->getProgramId(), "binormal");
 
     mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programGL->getProgramId(), *static_cast<BufferGL *>(bufferMap["vertices"]),
+            vertexElements, vertexStride, *mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mInnerBuffer = new UniformBufferGL(mContextGL, sizeof(InnerUniforms));
+        mInnerBuffer->setElement(0, &mInnerUniforms);
+        mInnerBuffer->upload(1);
+        mWorldBuffer = new UniformBufferGL(mContextGL, sizeof(WorldUniforms));
+    }
 }
 
 void InnerModelGL::draw()
 {
-    mContextGL->drawElements(*mIndicesBuffer);
+    if (!mContextGL->useUniformBlocks())
+    {
+        mContextGL->drawElements(*mIndicesBuffer);
+        return;
+    }
+
+    mWorldBuffer->upload(mInstanceCount);
+    for (int i = 0; i < mInstanceCount; ++i)
+    {
+        mWorldBuffer->bind(UNIFORMBLOCKINSTANCE, i);
+        mContextGL->drawElements(*mIndicesBuffer);
+    }
+    mInstanceCount = 0;
 }
 
 void InnerModelGL::prepareForDraw() const
@@ -92,29 +139,45 @@ void InnerModelGL::prepareForDraw() const
     mContextGL->enableBlend(mBlend);
 
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
-    mContextGL->bindVAO(programGL->getVAOId());
-
-    mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
-    mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
-    mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
-
-    mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
-    mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
-
-    mContextGL->setIndices(*mIndicesBuffer);
-
-    mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first, GL_FLOAT_MAT4);
-    // lightWorldPosition is optimized away on mesa because it's not used by shader
-    // mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
-    // GL_FLOAT_VEC3);
-    mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mEtaUniform.second, &mEtaUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mTankColorFudgeUniform.second, &mTankColorFudgeUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mRefractionFudgeUniform.second, &mRefractionFudgeUniform.first,
-                           GL_FLOAT);
+    if (mVertexArray != 0)
+    {
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mContextGL->bindVAO(programGL->getVAOId());
+
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+
+        mContextGL->setAttribs(*mTangentBuffer.first, mTangentBuffer.second);
+        mContextGL->setAttribs(*mBiNormalBuffer.first, mBiNormalBuffer.second);
+
+        mContextGL->setIndices(*mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mInnerBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+    }
+    else
+    {
+        mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first,
+                               GL_FLOAT_MAT4);
+        // lightWorldPosition is optimized away on mesa because it's not used by shader
+        // mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
+        // GL_FLOAT_VEC3);
+        mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mEtaUniform.second, &mEtaUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mTankColorFudgeUniform.second, &mTankColorFudgeUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mRefractionFudgeUniform.second, &mRefractionFudgeUniform.first,
+                               GL_FLOAT);
+    }
 
     mContextGL->setTexture(*mDiffuseTexture.first, mDiffuseTexture.second, 0);
     mContextGL->setTexture(*mNormalTexture.first, mNormalTexture.second, 1);
@@ -124,6 +187,12 @@ void InnerModelGL::prepareForDraw() const
 
 void InnerModelGL::updatePerInstanceUniforms(const WorldUniforms &mWorldUniforms)
 {
+    if (mContextGL->useUniformBlocks())
+    {
+        mWorldBuffer->setElement(mInstanceCount++, &mWorldUniforms);
+        return;
+    }
+
     mContextGL->setUniform(mWorldUniform.second, mWorldUniform.first, GL_FLOAT_MAT4);
     mContextGL->setUniform(mWorldViewProjectionUniform.second, mWorldViewProjectionUniform.first,
                            GL_FLOAT_MAT4);
@@ -11,6 +11,7 @@
 
 #include "ContextGL.h"
 #include "ProgramGL.h"
+#include "UniformBufferGL.h"
 
 #include "../Model.h"
 
@@ -18,6 +19,7 @@ class InnerModelGL : public Model
 {
   public:
     InnerModelGL(const ContextGL *context, Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend);
+    ~InnerModelGL() override;
     void prepareForDraw() const override;
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
     void init() override;
@@ -53,6 +55,22 @@ class InnerModelGL : public Model
     std::pair<BufferGL *, int> mBiNormalBuffer;
 
     BufferGL *mIndicesBuffer;
+    // VAO of the interleaved vertex buffer, or 0 if the attributes are in separate buffers.
+    unsigned int mVertexArray;
+
+    struct InnerUniforms
+    {
+        float eta;
+        float tankColorFudge;
+        float refractionFudge;
+        float padding;
+    } mInnerUniforms;
+
+    // Created if the context uses uniform blocks. The world uniforms of the instances are staged
+    // by updatePerInstanceUniforms(), and uploaded at once by draw().
+    UniformBufferGL *mInnerBuffer;
+    UniformBufferGL *mWorldBuffer;
+    int mInstanceCount;
 
   private:
     const ContextGL *mContextGL;
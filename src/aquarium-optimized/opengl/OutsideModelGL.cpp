@@ -12,7 +12,13 @@ OutsideModelGL::OutsideModelGL(const ContextGL *context,
                                MODELGROUP type,
                                MODELNAME name,
                                bool blend)
-    : Model(type, name, blend), mContextGL(context)
+    : Model(type, name, blend),
+      mVertexArray(0),
+      mLightFactorBuffer(nullptr),
+      mFogBuffer(nullptr),
+      mWorldBuffer(nullptr),
+      mInstanceCount(0),
+      mContextGL(context)
 {
     mViewInverseUniform.first           = aquarium->lightWorldPositionUniform.viewInverse;
     mLightWorldPosUniform.first         = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -28,6 +34,24 @@ OutsideModelGL::OutsideModelGL(const ContextGL *context,
     mFogMultUniform.first               = 0;
     mFogOffsetUniform.first             = 0;
     mFogColorUniform.first              = aquarium->fogUniforms.fogColor;
+
+    mLightFactorUniforms.shininess      = mShininessUniform.first;
+    mLightFactorUniforms.specularFactor = mSpecularFactorUniform.first;
+    mFogUniforms                        = aquarium->fogUniforms;
+    mFogUniforms.fogPower               = mFogPowerUniform.first;
+    mFogUniforms.fogMult                = mFogMultUniform.first;
+    mFogUniforms.fogOffset              = mFogOffsetUniform.first;
+}
+
+OutsideModelGL::~OutsideModelGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    delete mLightFactorBuffer;
+    delete mFogBuffer;
+    delete mWorldBuffer;
 }
 
 void OutsideModelGL::init()
@@ -69,11 +93,44 @@ void OutsideModelGL::init()
     mTexCoordBuffer.second = mContextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
 
     mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programGL->getProgramId(), *static_cast<BufferGL *>(bufferMap["vertices"]),
+            vertexElements, vertexStride, *mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer = new UniformBufferGL(mContextGL, sizeof(LightFactorUniforms));
+        mLightFactorBuffer->setElement(0, &mLightFactorUniforms);
+        mLightFactorBuffer->upload(1);
+        mFogBuffer = new UniformBufferGL(mContextGL, sizeof(FogUniforms));
+        mFogBuffer->setElement(0, &mFogUniforms);
+        mFogBuffer->upload(1);
+        mWorldBuffer = new UniformBufferGL(mContextGL, sizeof(WorldUniforms));
+    }
 }
 
 void OutsideModelGL::draw()
 {
-    mContextGL->drawElements(*mIndicesBuffer);
+    if (!mContextGL->useUniformBlocks())
+    {
+        mContextGL->drawElements(*mIndicesBuffer);
+        return;
+    }
+
+    mWorldBuffer->upload(mInstanceCount);
+    for (int i = 0; i < mInstanceCount; ++i)
+    {
+        mWorldBuffer->bind(UNIFORMBLOCKINSTANCE, i);
+        mContextGL->drawElements(*mIndicesBuffer);
+    }
+    mInstanceCount = 0;
+
+    // The fog uniforms bound by prepareForDraw() are the model's own.
+    mContextGL->bindGeneralUniformBuffers();
 }
 
 void OutsideModelGL::prepareForDraw() const
@@ -82,32 +139,55 @@ void OutsideModelGL::prepareForDraw() const
     mContextGL->enableBlend(mBlend);
 
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
-    mContextGL->bindVAO(programGL->getVAOId());
-
-    mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
-    mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
-    mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
-
-    mContextGL->setIndices(*mIndicesBuffer);
-
-    mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first, GL_FLOAT_MAT4);
-    mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
-                           GL_FLOAT_VEC3);
-    mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+    if (mVertexArray != 0)
+    {
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mContextGL->bindVAO(programGL->getVAOId());
+
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+
+        mContextGL->setIndices(*mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+        mFogBuffer->bind(UNIFORMBLOCKFOG, 0);
+    }
+    else
+    {
+        mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first,
+                               GL_FLOAT_MAT4);
+        mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
+                               GL_FLOAT_VEC3);
+        mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+    }
 
     mContextGL->setTexture(*mDiffuseTexture.first, mDiffuseTexture.second, 0);
 }
 
 void OutsideModelGL::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
 {
+    if (mContextGL->useUniformBlocks())
+    {
+        mWorldBuffer->setElement(mInstanceCount++, &worldUniforms);
+        return;
+    }
+
     mContextGL->setUniform(mWorldUniform.second, mWorldUniform.first, GL_FLOAT_MAT4);
     mContextGL->setUniform(mWorldViewProjectionUniform.second, mWorldViewProjectionUniform.first,
                            GL_FLOAT_MAT4);
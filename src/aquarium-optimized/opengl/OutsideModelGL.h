@@ -11,6 +11,7 @@
 
 #include "ContextGL.h"
 #include "ProgramGL.h"
+#include "UniformBufferGL.h"
 
 #include "../Model.h"
 
@@ -22,6 +23,7 @@ class OutsideModelGL : public Model
                    MODELGROUP type,
                    MODELNAME name,
                    bool blend);
+    ~OutsideModelGL() override;
     void prepareForDraw() const override;
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
     void init() override;
@@ -52,6 +54,24 @@ class OutsideModelGL : public Model
     std::pair<BufferGL *, int> mTexCoordBuffer;
 
     BufferGL *mIndicesBuffer;
+    // VAO of the interleaved vertex buffer, or 0 if the attributes are in separate buffers.
+    unsigned int mVertexArray;
+
+    struct LightFactorUniforms
+    {
+        float shininess;
+        float specularFactor;
+    } mLightFactorUniforms;
+
+    // The outside models aren't fogged, so their fog uniforms are zero.
+    FogUniforms mFogUniforms;
+
+    // Created if the context uses uniform blocks. The world uniforms of the instances are staged
+    // by updatePerInstanceUniforms(), and uploaded at once by draw().
+    UniformBufferGL *mLightFactorBuffer;
+    UniformBufferGL *mFogBuffer;
+    UniformBufferGL *mWorldBuffer;
+    int mInstanceCount;
 
   private:
     const ContextGL *mContextGL;
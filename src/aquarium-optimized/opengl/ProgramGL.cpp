@@ -20,21 +20,21 @@
 #include "glad/glad.h"
 #endif
 
-#include <fstream>
 #include <iostream>
 #include <map>
-#include <regex>
 #include <string>
 #include <vector>
 
 #include "common/AQUARIUM_ASSERT.h"
 #include "ProgramGL.h"
 
+#include "../ShaderPermutation.h"
+
 #include "../Buffer.h"
 #include "../Texture.h"
 
-ProgramGL::ProgramGL(ContextGL *context, std::string mVId, std::string mFId)
-    : Program(mVId, mFId), mProgramId(0u), mContext(context)
+ProgramGL::ProgramGL(ContextGL *context, std::string mVId, std::string mFId, uint32_t features)
+    : Program(mVId, mFId, features), mProgramId(0u), mCompile(), mContext(context)
 {
     mProgramId= context->generateProgram();
     mVAO = context->generateVAO();
@@ -46,21 +46,24 @@ ProgramGL::~ProgramGL()
     mContext->deleteProgram(mProgramId);
 }
 
-void ProgramGL::loadProgram()
+void ProgramGL::prepareProgram()
 {
-    std::ifstream VertexShaderStream(mVId, std::ios::in);
-    std::string VertexShaderCode((std::istreambuf_iterator<char>(VertexShaderStream)),
-                                 std::istreambuf_iterator<char>());
-    VertexShaderStream.close();
+    if (mPrepared)
+    {
+        return;
+    }
 
-    // Read the Fragment Shader code from the file
-    std::ifstream FragmentShaderStream(mFId, std::ios::in);
-    std::string FragmentShaderCode((std::istreambuf_iterator<char>(FragmentShaderStream)),
-                                   std::istreambuf_iterator<char>());
-    FragmentShaderStream.close();
+    loadSource(mContext->getResourceHelper());
 
     const std::string fogUniforms =
-        R"(uniform float fogPower;
+        mContext->useUniformBlocks()
+            ? R"(layout(std140) uniform FogUniforms {
+          float fogPower;
+          float fogMult;
+          float fogOffset;
+          vec4 fogColor;
+        };)"
+            : R"(uniform float fogPower;
         uniform float fogMult;
         uniform float fogOffset;
         uniform vec4 fogColor;)";
@@ -68,29 +71,52 @@ void ProgramGL::loadProgram()
         R"(outColor = mix(outColor, vec4(fogColor.rgb, diffuseColor.a),
         clamp(pow((v_position.z / v_position.w), fogPower) * fogMult - fogOffset,0.0,1.0));)";
 
+    ShaderVariant variant = getShaderVariant(mFeatures);
+    if (mFeatures & FEATUREFOG)
+    {
+        variant.substitutedTags = {{"fogUniforms", fogUniforms}, {"fogCode", fogCode}};
+    }
+    else
+    {
+        variant.substitutedTags = {{"fogUniforms", ""}, {"fogCode", ""}};
+    }
 #ifdef __APPLE__
-    VertexShaderCode   = std::regex_replace(VertexShaderCode, std::regex(R"(#version 450 core)"),
-                                          R"(#version 410 core)");
-    FragmentShaderCode = std::regex_replace(FragmentShaderCode, std::regex(R"(#version 450 core)"),
-                                            R"(#version 410 core)");
+    variant.fromVersion = "450 core";
+    variant.toVersion   = "410 core";
 #endif
 
-    // enable fog, reflection and normalMaps
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(// #fogUniforms)"), fogUniforms);
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(// #fogCode)"), fogCode);
+    ShaderPreprocessor *preprocessor = mContext->getShaderPreprocessor();
+    mVertexShaderCode   = preprocessor->preprocess(mVId, mVertexShaderCode, variant);
+    mFragmentShaderCode = preprocessor->preprocess(mFId, mFragmentShaderCode, variant);
+    mPrepared           = true;
+}
 
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noReflection)"), "");
-    FragmentShaderCode =
-        std::regex_replace(FragmentShaderCode, std::regex(R"(\n.*?// #noNormalMap)"), "");
+void ProgramGL::loadProgram()
+{
+    prepareProgram();
+    std::string VertexShaderCode   = std::move(mVertexShaderCode);
+    std::string FragmentShaderCode = std::move(mFragmentShaderCode);
+
+    // Each permutation is cached next to its fragment shader, as a fragment shader may be linked
+    // with several vertex shaders, and instantiated with several keys.
+    std::string cachePath = mFId + "." + mVId.substr(mVId.find_last_of("/\\") + 1) + "." +
+                            std::to_string(mFeatures) + ".glprogram";
+    mContext->beginCompileProgram(mProgramId, VertexShaderCode, FragmentShaderCode, cachePath,
+                                  &mCompile);
+}
 
-    bool status = mContext->compileProgram(mProgramId, VertexShaderCode, FragmentShaderCode);
+void ProgramGL::finishProgram()
+{
+    bool status = mContext->endCompileProgram(mProgramId, &mCompile);
     ASSERT(status);
     if (!status) {
         std::cout << "Error occurs in compiling program!" << std::endl;
     }
+
+    if (mContext->useUniformBlocks())
+    {
+        mContext->bindUniformBlocks(mProgramId);
+    }
 }
 
 void ProgramGL::setProgram()
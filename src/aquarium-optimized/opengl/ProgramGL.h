@@ -26,17 +26,20 @@ class ProgramGL : public Program
 {
 public:
     ProgramGL() {}
-    ProgramGL(ContextGL *, std::string mVId, std::string mFId);
+    ProgramGL(ContextGL *, std::string mVId, std::string mFId, uint32_t features);
     ~ProgramGL() override;
 
     void setProgram() override;
     GLuint getProgramId() const { return mProgramId; }
     GLuint getVAOId() { return mVAO; }
-    void loadProgram();
+    void prepareProgram() override;
+    void loadProgram() override;
+    void finishProgram() override;
 
   private:
     GLuint mProgramId;
     GLuint mVAO;
+    ProgramCompileGL mCompile;
 
     ContextGL *mContext;
 };
@@ -12,7 +12,13 @@ SeaweedModelGL::SeaweedModelGL(const ContextGL *context,
                                MODELGROUP type,
                                MODELNAME name,
                                bool blend)
-    : SeaweedModel(type, name, blend), mContextGL(context)
+    : SeaweedModel(type, name, blend),
+      mVertexArray(0),
+      mLightFactorBuffer(nullptr),
+      mSeaweedPerBuffer(nullptr),
+      mInstanceCount(0),
+      mContextGL(context),
+      mAquarium(aquarium)
 {
     mViewInverseUniform.first    = aquarium->lightWorldPositionUniform.viewInverse;
     mLightWorldPosUniform.first  = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -27,6 +33,19 @@ SeaweedModelGL::SeaweedModelGL(const ContextGL *context,
     mFogOffsetUniform.first      = g_fogOffset;
     mFogColorUniform.first       = aquarium->fogUniforms.fogColor;
     mViewProjectionUniform.first = aquarium->lightWorldPositionUniform.viewProjection;
+
+    mLightFactorUniforms.shininess      = mShininessUniform.first;
+    mLightFactorUniforms.specularFactor = mSpecularFactorUniform.first;
+}
+
+SeaweedModelGL::~SeaweedModelGL()
+{
+    if (mVertexArray != 0)
+    {
+        mContextGL->deleteVAO(mVertexArray);
+    }
+    delete mLightFactorBuffer;
+    delete mSeaweedPerBuffer;
 }
 
 void SeaweedModelGL::init()
@@ -68,11 +87,38 @@ void SeaweedModelGL::init()
     mTexCoordBuffer.second = mContextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
 
     mIndicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+
+    if (!vertexElements.empty())
+    {
+        mVertexArray = mContextGL->createVertexArray(
+            programGL->getProgramId(), *static_cast<BufferGL *>(bufferMap["vertices"]),
+            vertexElements, vertexStride, *mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer = new UniformBufferGL(mContextGL, sizeof(LightFactorUniforms));
+        mLightFactorBuffer->setElement(0, &mLightFactorUniforms);
+        mLightFactorBuffer->upload(1);
+        mSeaweedPerBuffer = new UniformBufferGL(mContextGL, sizeof(SeaweedPer));
+    }
 }
 
 void SeaweedModelGL::draw()
 {
-    mContextGL->drawElements(*mIndicesBuffer);
+    if (!mContextGL->useUniformBlocks())
+    {
+        mContextGL->drawElements(*mIndicesBuffer);
+        return;
+    }
+
+    mSeaweedPerBuffer->upload(mInstanceCount);
+    for (int i = 0; i < mInstanceCount; ++i)
+    {
+        mSeaweedPerBuffer->bind(UNIFORMBLOCKINSTANCE, i);
+        mContextGL->drawElements(*mIndicesBuffer);
+    }
+    mInstanceCount = 0;
 }
 
 void SeaweedModelGL::prepareForDraw() const
@@ -81,34 +127,60 @@ void SeaweedModelGL::prepareForDraw() const
     mContextGL->enableBlend(mBlend);
 
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
-    mContextGL->bindVAO(programGL->getVAOId());
-
-    mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
-    mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
-    mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
-
-    mContextGL->setIndices(*mIndicesBuffer);
-
-    mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first, GL_FLOAT_MAT4);
-    mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
-                           GL_FLOAT_VEC3);
-    mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
-    mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
-    mContextGL->setUniform(mViewProjectionUniform.second, mViewProjectionUniform.first,
-                           GL_FLOAT_MAT4);
+    if (mVertexArray != 0)
+    {
+        mContextGL->bindVAO(mVertexArray);
+    }
+    else
+    {
+        mContextGL->bindVAO(programGL->getVAOId());
+
+        mContextGL->setAttribs(*mPositionBuffer.first, mPositionBuffer.second);
+        mContextGL->setAttribs(*mNormalBuffer.first, mNormalBuffer.second);
+        mContextGL->setAttribs(*mTexCoordBuffer.first, mTexCoordBuffer.second);
+
+        mContextGL->setIndices(*mIndicesBuffer);
+    }
+
+    if (mContextGL->useUniformBlocks())
+    {
+        mLightFactorBuffer->bind(UNIFORMBLOCKMODELFRAGMENT, 0);
+    }
+    else
+    {
+        mContextGL->setUniform(mViewInverseUniform.second, mViewInverseUniform.first,
+                               GL_FLOAT_MAT4);
+        mContextGL->setUniform(mLightWorldPosUniform.second, mLightWorldPosUniform.first,
+                               GL_FLOAT_VEC3);
+        mContextGL->setUniform(mLightColorUniform.second, mLightColorUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mSpecularUniform.second, mSpecularUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mShininessUniform.second, &mShininessUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mSpecularFactorUniform.second, &mSpecularFactorUniform.first,
+                               GL_FLOAT);
+        mContextGL->setUniform(mAmbientUniform.second, mAmbientUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mFogPowerUniform.second, &mFogPowerUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogMultUniform.second, &mFogMultUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogOffsetUniform.second, &mFogOffsetUniform.first, GL_FLOAT);
+        mContextGL->setUniform(mFogColorUniform.second, mFogColorUniform.first, GL_FLOAT_VEC4);
+        mContextGL->setUniform(mViewProjectionUniform.second, mViewProjectionUniform.first,
+                               GL_FLOAT_MAT4);
+    }
 
     mContextGL->setTexture(*mDiffuseTexture.first, mDiffuseTexture.second, 0);
 }
 
 void SeaweedModelGL::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
 {
+    if (mContextGL->useUniformBlocks())
+    {
+        // Each instance sways with a phase of its own, as in the Dawn backend.
+        SeaweedPer seaweedPer;
+        seaweedPer.worldUniforms = worldUniforms;
+        seaweedPer.time          = mAquarium->g.mclock + mInstanceCount;
+        mSeaweedPerBuffer->setElement(mInstanceCount++, &seaweedPer);
+        return;
+    }
+
     mContextGL->setUniform(mWorldUniform.second, mWorldUniform.first, GL_FLOAT_MAT4);
     mContextGL->setUniform(mTimeUniform.second, &mTimeUniform.first, GL_FLOAT);
 }
@@ -11,6 +11,7 @@
 
 #include "ContextGL.h"
 #include "ProgramGL.h"
+#include "UniformBufferGL.h"
 
 #include "../SeaweedModel.h"
 
@@ -22,6 +23,7 @@ class SeaweedModelGL : public SeaweedModel
                    MODELGROUP type,
                    MODELNAME name,
                    bool blend);
+    ~SeaweedModelGL() override;
     void prepareForDraw() const override;
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
     void init() override;
@@ -55,9 +57,30 @@ class SeaweedModelGL : public SeaweedModel
     std::pair<BufferGL *, int> mTexCoordBuffer;
 
     BufferGL *mIndicesBuffer;
+    // VAO of the interleaved vertex buffer, or 0 if the attributes are in separate buffers.
+    unsigned int mVertexArray;
+
+    struct LightFactorUniforms
+    {
+        float shininess;
+        float specularFactor;
+    } mLightFactorUniforms;
+
+    struct SeaweedPer
+    {
+        WorldUniforms worldUniforms;
+        float time;
+    };
+
+    // Created if the context uses uniform blocks. The uniforms of the instances are staged by
+    // updatePerInstanceUniforms(), and uploaded at once by draw().
+    UniformBufferGL *mLightFactorBuffer;
+    UniformBufferGL *mSeaweedPerBuffer;
+    int mInstanceCount;
 
   private:
     const ContextGL *mContextGL;
+    Aquarium *mAquarium;
 };
 
 #endif // !SEAWEEDMODELGL_H
@@ -7,18 +7,29 @@
 
 #include "TextureGL.h"
 
+#include <algorithm>
+#include <iostream>
+
 #include "common/AQUARIUM_ASSERT.h"
 
 // initializs texture 2d
 TextureGL::TextureGL(ContextGL *context, std::string name, std::string url)
-    : Texture(name, url, true), mTarget(GL_TEXTURE_2D), mFormat(GL_RGBA), mContext(context)
+    : Texture(name, url, true),
+      mTarget(GL_TEXTURE_2D),
+      mSamplerId(0),
+      mFormat(GL_RGBA),
+      mContext(context)
 {
     mTextureId = context->generateTexture();
 }
 
 // initializs cube map
 TextureGL::TextureGL(ContextGL *context, std::string name, const std::vector<std::string> &urls)
-    : Texture(name, urls, false), mTarget(GL_TEXTURE_CUBE_MAP), mFormat(GL_RGBA), mContext(context)
+    : Texture(name, urls, false),
+      mTarget(GL_TEXTURE_CUBE_MAP),
+      mSamplerId(0),
+      mFormat(GL_RGBA),
+      mContext(context)
 {
     ASSERT(urls.size() == 6);
     mTextureId = context->generateTexture();
@@ -26,43 +37,107 @@ TextureGL::TextureGL(ContextGL *context, std::string name, const std::vector<std
 
 void TextureGL::loadTexture()
 {
-    mContext->bindTexture(mTarget, mTextureId);
+    // The placeholder stays bound if the images can't be loaded.
+    if (!prepareLevels(mContext->getResourceHelper()))
+    {
+        std::cout << "Failed to load texture " << mName << "." << std::endl;
+        releaseLevels();
+        return;
+    }
 
-    std::vector<unsigned char *> pixelVec;
-    loadImage(mUrls, &pixelVec);
+    mContext->bindTexture(mTarget, mTextureId);
 
     if (mTarget == GL_TEXTURE_CUBE_MAP)
     {
         for (unsigned int i = 0; i < 6; i++)
         {
             mContext->uploadTexture(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mFormat, mWidth, mHeight,
-                                    pixelVec[i]);
+                                    getLevel(i, 0));
         }
 
-        mContext->setParameter(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        mContext->setParameter(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        mContext->setParameter(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        mContext->setParameter(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        mSamplerId = mContext->getSampler(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);
+    }
+    else if (mStreamed)
+    {
+        loadMips(getInitialStreamedMip());
+        return;
     }
     else  // GL_TEXTURE_2D
     {
-        mContext->uploadTexture(mTarget, mFormat, mWidth, mHeight, pixelVec[0]);
+        mContext->uploadTexture(mTarget, mFormat, mWidth, mHeight, getLevel(0, 0));
 
         if (isPowerOf2(mWidth) && isPowerOf2(mHeight))
         {
-            mContext->setParameter(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             mContext->generateMipmap(mTarget);
+            mSamplerId = mContext->getSampler(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT);
         }
         else
         {
-            mContext->setParameter(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            mContext->setParameter(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            mContext->setParameter(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            mSamplerId = mContext->getSampler(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);
         }
-        mContext->setParameter(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    mResidentMip = 0;
+
+    releaseLevels();
+}
+
+// The levels are uploaded into a new texture object, so the memory of evicted levels is freed
+// along with the old one. Models bind textures by id at each draw.
+void TextureGL::loadMips(int mip)
+{
+    ASSERT(mTarget == GL_TEXTURE_2D);
+    if (!prepareLevels(mContext->getResourceHelper()))
+    {
+        releaseLevels();
+        return;
+    }
+
+    int levelCount = getLevelCount();
+    mip            = std::min(mip, levelCount - 1);
+
+    mContext->deleteTexture(mTextureId);
+    mTextureId = mContext->generateTexture();
+    mContext->bindTexture(mTarget, mTextureId);
+    for (int level = mip; level < levelCount; ++level)
+    {
+        mContext->uploadTexture(mTarget, mFormat, std::max(mWidth >> level, 1),
+                                std::max(mHeight >> level, 1), getLevel(0, level), level - mip);
     }
 
-    DestoryImageData(pixelVec);
+    if (isPowerOf2(mWidth) && isPowerOf2(mHeight))
+    {
+        mSamplerId = mContext->getSampler(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT);
+    }
+    else
+    {
+        mSamplerId = mContext->getSampler(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);
+    }
+    mResidentMip = mip;
+
+    releaseLevels();
+}
+
+// Models bind textures by id at each draw, so loadTexture() swaps in the real image by
+// respecifying the same texture.
+void TextureGL::loadPlaceholder()
+{
+    uint8_t pixel[4];
+    getPlaceholderPixel(pixel);
+
+    mContext->bindTexture(mTarget, mTextureId);
+    if (mTarget == GL_TEXTURE_CUBE_MAP)
+    {
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            mContext->uploadTexture(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mFormat, 1, 1, pixel);
+        }
+    }
+    else  // GL_TEXTURE_2D
+    {
+        mContext->uploadTexture(mTarget, mFormat, 1, 1, pixel);
+    }
+    mContext->setParameter(mTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    mContext->setParameter(mTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 TextureGL::~TextureGL()
@@ -40,14 +40,19 @@ class TextureGL : public Texture
 
     unsigned int getTextureId() const { return mTextureId; }
     unsigned int getTarget() const { return mTarget; }
+    // 0 until the texture is loaded, so a placeholder is sampled with the state of the texture.
+    unsigned int getSamplerId() const { return mSamplerId; }
     void setTextureId(unsigned int texId) { mTextureId = texId; }
 
     void loadTexture() override;
+    void loadPlaceholder() override;
+    void loadMips(int mip) override;
 
   private:
 
     unsigned int mTarget;
     unsigned int mTextureId;
+    unsigned int mSamplerId;
     unsigned int mFormat;
     ContextGL *mContext;
 };
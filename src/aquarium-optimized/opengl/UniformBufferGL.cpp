@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformBufferGL.cpp: Implements the uniform buffer wrapper of OpenGL.
+
+#include "UniformBufferGL.h"
+
+#include <cstring>
+
+#include "ContextGL.h"
+
+#include "common/AQUARIUM_ASSERT.h"
+
+UniformBufferGL::UniformBufferGL(const ContextGL *context, size_t elementSize)
+    : mContext(context),
+      mBuf(0),
+      mElementSize(elementSize),
+      mBlockSize((elementSize + 15) / 16 * 16),
+      mStride(0),
+      mData()
+{
+    size_t alignment = mContext->getUniformBufferAlignment();
+    mStride          = (mBlockSize + alignment - 1) / alignment * alignment;
+    mBuf             = mContext->generateBuffer();
+}
+
+UniformBufferGL::~UniformBufferGL()
+{
+    mContext->deleteBuffer(mBuf);
+}
+
+void UniformBufferGL::setElement(int index, const void *element)
+{
+    ASSERT(index >= 0);
+    size_t offset = index * mStride;
+    if (mData.size() < offset + mStride)
+    {
+        mData.resize(offset + mStride);
+    }
+    memcpy(mData.data() + offset, element, mElementSize);
+}
+
+void UniformBufferGL::upload(int count)
+{
+    ASSERT(count * mStride <= mData.size());
+    if (count > 0)
+    {
+        mContext->uploadStreamBuffer(GL_UNIFORM_BUFFER, mBuf, mData.data(), count * mStride);
+    }
+}
+
+void UniformBufferGL::bind(unsigned int binding, int index) const
+{
+    mContext->bindUniformBuffer(binding, mBuf, index * mStride, mBlockSize);
+}
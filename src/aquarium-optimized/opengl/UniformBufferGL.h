@@ -0,0 +1,47 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformBufferGL.h: Defines the uniform buffer wrapper of OpenGL. The elements of the buffer are
+// staged one after another, uploaded by one call, and bound one at a time to the binding point of
+// a uniform block.
+
+#pragma once
+#ifndef UNIFORMBUFFERGL_H
+#define UNIFORMBUFFERGL_H 1
+
+#include <cstddef>
+#include <vector>
+
+class ContextGL;
+
+class UniformBufferGL
+{
+  public:
+    // elementSize is the size in bytes of the std140 block of an element.
+    UniformBufferGL(const ContextGL *context, size_t elementSize);
+    ~UniformBufferGL();
+    UniformBufferGL(const UniformBufferGL &) = delete;
+    UniformBufferGL &operator=(const UniformBufferGL &) = delete;
+
+    // Stage the element at index, growing the staged elements if needed.
+    void setElement(int index, const void *element);
+    // Upload the first count staged elements.
+    void upload(int count);
+    // Bind the element at index of the last upload to the binding point.
+    void bind(unsigned int binding, int index) const;
+
+  private:
+    const ContextGL *mContext;
+    unsigned int mBuf;
+    size_t mElementSize;
+    // std140 blocks are padded to a multiple of a vec4, and ranges must cover the padding.
+    size_t mBlockSize;
+    // Offsets of ranges bound to a binding point must be multiples of the uniform buffer offset
+    // alignment, so the elements are padded to it.
+    size_t mStride;
+    std::vector<char> mData;
+};
+
+#endif  // !UNIFORMBUFFERGL_H
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AssetPack.cpp: Implement reading and writing of asset packs.
+
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Compare the NUL padded name of an entry with name, like std::string::compare.
+int compareName(const AssetPackEntry &entry, const std::string &name)
+{
+    size_t length = strnlen(entry.name, sizeof(entry.name));
+    return -name.compare(0, std::string::npos, entry.name, length);
+}
+
+}  // namespace
+
+AssetPack::AssetPack() : mFile(), mEntries(nullptr), mEntryCount(0) {}
+
+bool AssetPack::open(const std::string &path)
+{
+    close();
+
+    if (!mFile.open(path))
+    {
+        return false;
+    }
+
+    const uint8_t *base = mFile.data();
+    size_t size         = mFile.size();
+    if (size < sizeof(AssetPackHeader))
+    {
+        close();
+        return false;
+    }
+
+    AssetPackHeader header;
+    memcpy(&header, base, sizeof(header));
+    uint64_t tableEnd =
+        sizeof(AssetPackHeader) + static_cast<uint64_t>(header.entryCount) * sizeof(AssetPackEntry);
+    if (memcmp(header.magic, kAssetPackMagic, sizeof(kAssetPackMagic)) != 0 ||
+        header.version != kAssetPackVersion || header.fileSize != size || tableEnd > size)
+    {
+        close();
+        return false;
+    }
+
+    const auto *entries = reinterpret_cast<const AssetPackEntry *>(base + sizeof(header));
+    for (uint32_t i = 0; i < header.entryCount; ++i)
+    {
+        const AssetPackEntry &entry = entries[i];
+        if (entry.offset % kAssetPackBlobAlignment != 0 || entry.offset < tableEnd ||
+            entry.offset > size || entry.size > size - entry.offset)
+        {
+            close();
+            return false;
+        }
+    }
+
+    mEntries    = entries;
+    mEntryCount = header.entryCount;
+
+    return true;
+}
+
+void AssetPack::close()
+{
+    mFile.close();
+    mEntries    = nullptr;
+    mEntryCount = 0;
+}
+
+bool AssetPack::find(const std::string &name, const uint8_t **data, size_t *size) const
+{
+    const AssetPackEntry *end = mEntries + mEntryCount;
+    const AssetPackEntry *entry =
+        std::lower_bound(mEntries, end, name, [](const AssetPackEntry &e, const std::string &n) {
+            return compareName(e, n) < 0;
+        });
+    if (entry == end || compareName(*entry, name) != 0)
+    {
+        return false;
+    }
+
+    *data = mFile.data() + entry->offset;
+    *size = static_cast<size_t>(entry->size);
+
+    return true;
+}
+
+bool writeAssetPack(const std::string &path, std::vector<AssetPackInput> *assets)
+{
+    std::sort(assets->begin(), assets->end(),
+              [](const AssetPackInput &a, const AssetPackInput &b) { return a.name < b.name; });
+
+    AssetPackHeader header;
+    memcpy(header.magic, kAssetPackMagic, sizeof(kAssetPackMagic));
+    header.version    = kAssetPackVersion;
+    header.entryCount = static_cast<uint32_t>(assets->size());
+    header.reserved   = 0;
+
+    uint64_t offset = sizeof(AssetPackHeader) + assets->size() * sizeof(AssetPackEntry);
+    std::vector<AssetPackEntry> entries(assets->size());
+    for (size_t i = 0; i < assets->size(); ++i)
+    {
+        const AssetPackInput &asset = (*assets)[i];
+        if (asset.name.size() > sizeof(entries[i].name) ||
+            (i > 0 && asset.name == (*assets)[i - 1].name))
+        {
+            return false;
+        }
+
+        memset(entries[i].name, 0, sizeof(entries[i].name));
+        memcpy(entries[i].name, asset.name.data(), asset.name.size());
+        offset            = alignUp(offset, kAssetPackBlobAlignment);
+        entries[i].offset = offset;
+        entries[i].size   = asset.data.size();
+        offset += asset.data.size();
+    }
+    header.fileSize = offset;
+
+    // Write to a temporary file first, so a reader never maps a partially written pack.
+    std::string tempPath = path + ".tmp";
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.good())
+    {
+        return false;
+    }
+
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(entries.data()),
+                 entries.size() * sizeof(AssetPackEntry));
+
+    uint64_t written = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry);
+    const char padding[kAssetPackBlobAlignment] = {};
+    for (size_t i = 0; i < assets->size(); ++i)
+    {
+        const std::vector<uint8_t> &data = (*assets)[i].data;
+        stream.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+        stream.write(reinterpret_cast<const char *>(data.data()),
+                     static_cast<std::streamsize>(data.size()));
+        written = entries[i].offset + data.size();
+    }
+    stream.close();
+
+    if (stream.fail())
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
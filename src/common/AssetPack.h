@@ -0,0 +1,81 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AssetPack.h: Define a single file archive of assets, which is mapped once at startup instead
+// of opening every asset file.
+//
+// The pack is laid out as below. All of the values are little endian.
+//   AssetPackHeader
+//   AssetPackEntry[entryCount], sorted by name
+//   blobs of entries, each aligned to kAssetPackBlobAlignment bytes
+
+#pragma once
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+constexpr char kAssetPackMagic[4]          = {'A', 'Q', 'P', 'K'};
+constexpr uint32_t kAssetPackVersion       = 1;
+constexpr uint64_t kAssetPackBlobAlignment = 64;
+
+struct AssetPackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct AssetPackEntry
+{
+    char name[112];
+    uint64_t offset;
+    uint64_t size;
+};
+
+// An asset to write into a pack. name is the path relative to the root of the repo with '/'
+// separators, such as "assets/BigFishA.mesh".
+struct AssetPackInput
+{
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+class AssetPack
+{
+  public:
+    AssetPack();
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    // Map the pack at path. Return false if it doesn't exist or is corrupted.
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return mFile.isOpen(); }
+    uint32_t getEntryCount() const { return mEntryCount; }
+
+    // Find the blob of an asset by name. The blob is valid until the pack is closed. It's safe
+    // to call on several threads.
+    bool find(const std::string &name, const uint8_t **data, size_t *size) const;
+
+  private:
+    MappedFile mFile;
+    const AssetPackEntry *mEntries;
+    uint32_t mEntryCount;
+};
+
+// Write the assets into a pack at path. Return false if a name is duplicated or too long, or
+// the pack can't be written.
+bool writeAssetPack(const std::string &path, std::vector<AssetPackInput> *assets);
+
+#endif  // !ASSET_PACK_H
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MappedFile.h: Define a read only memory mapped file.
+
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Map the whole file read only. Return false if the file can't be opened or is empty.
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return mData != nullptr; }
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+
+  private:
+    const uint8_t *mData;
+    size_t mSize;
+#if defined(WIN32) || defined(_WIN32)
+    void *mFile;
+    void *mMapping;
+#endif
+};
+
+#endif  // !MAPPED_FILE_H
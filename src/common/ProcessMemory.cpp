@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ProcessMemory.cpp: Implement the memory usage query on Windows, Linux and macOS.
+
+#include "ProcessMemory.h"
+
+#if defined(WIN32) || defined(_WIN32)
+#include <Windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <cstdio>
+#endif
+
+bool getProcessMemory(size_t *resident, size_t *peak)
+{
+#if defined(WIN32) || defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return false;
+    }
+    *resident = counters.WorkingSetSize;
+    *peak     = counters.PeakWorkingSetSize;
+    return true;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+                  &count) != KERN_SUCCESS)
+    {
+        return false;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return false;
+    }
+    *resident = static_cast<size_t>(info.resident_size);
+    // ru_maxrss is in bytes on macOS.
+    *peak = static_cast<size_t>(usage.ru_maxrss);
+    return true;
+#else
+    // VmRSS and VmHWM of /proc/self/status are in kB.
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool foundResident = false;
+    bool foundPeak     = false;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr)
+    {
+        unsigned long kilobytes;
+        if (sscanf(line, "VmRSS: %lu", &kilobytes) == 1)
+        {
+            *resident     = static_cast<size_t>(kilobytes) * 1024;
+            foundResident = true;
+        }
+        else if (sscanf(line, "VmHWM: %lu", &kilobytes) == 1)
+        {
+            *peak     = static_cast<size_t>(kilobytes) * 1024;
+            foundPeak = true;
+        }
+    }
+    fclose(file);
+
+    return foundResident && foundPeak;
+#endif
+}
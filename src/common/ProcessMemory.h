@@ -0,0 +1,18 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ProcessMemory.h: Query the memory usage of the process.
+
+#pragma once
+#ifndef PROCESS_MEMORY_H
+#define PROCESS_MEMORY_H 1
+
+#include <cstddef>
+
+// Get the current and peak resident set size of the process in bytes. Return false if it isn't
+// supported on the platform.
+bool getProcessMemory(size_t *resident, size_t *peak);
+
+#endif  // !PROCESS_MEMORY_H
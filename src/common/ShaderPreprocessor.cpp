@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderPreprocessor.cpp: Implement the preprocessor of shader tags.
+
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+constexpr char kTagPrefix[]     = "// #";
+constexpr char kVersionPrefix[] = "#version ";
+
+bool isTagCharacter(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool contains(const std::vector<std::string> &tags, const std::string &tag)
+{
+    return std::find(tags.begin(), tags.end(), tag) != tags.end();
+}
+
+}  // namespace
+
+std::string ShaderVariant::getKey() const
+{
+    // Tags are identifiers, so they can't contain the separators.
+    std::string key;
+    for (const std::string &tag : removedTags)
+    {
+        key += "-" + tag;
+    }
+    for (const auto &tag : substitutedTags)
+    {
+        key += "+" + tag.first + "=" + tag.second + "\n";
+    }
+    key += "#" + fromVersion + "=" + toVersion;
+    return key;
+}
+
+ShaderTemplate::ShaderTemplate(const std::string &source) : mSource(source), mLines()
+{
+    size_t begin = 0;
+    while (begin < mSource.size())
+    {
+        size_t end = mSource.find('\n', begin);
+        if (end == std::string::npos)
+        {
+            end = mSource.size();
+        }
+
+        Line line = {begin, end, std::string::npos, std::string::npos, std::string()};
+        size_t tagBegin = mSource.find(kTagPrefix, begin);
+        if (tagBegin < end)
+        {
+            size_t nameBegin = tagBegin + sizeof(kTagPrefix) - 1;
+            size_t nameEnd   = nameBegin;
+            while (nameEnd < end && isTagCharacter(mSource[nameEnd]))
+            {
+                ++nameEnd;
+            }
+            if (nameEnd > nameBegin)
+            {
+                line.tagBegin = tagBegin;
+                line.tagEnd   = nameEnd;
+                line.tag      = mSource.substr(nameBegin, nameEnd - nameBegin);
+            }
+        }
+        mLines.push_back(line);
+
+        begin = end + 1;
+    }
+}
+
+std::string ShaderTemplate::instantiate(const ShaderVariant &variant) const
+{
+    std::string fromVersionLine;
+    if (!variant.fromVersion.empty() && !variant.toVersion.empty())
+    {
+        fromVersionLine = kVersionPrefix + variant.fromVersion;
+    }
+
+    std::string result;
+    result.reserve(mSource.size());
+    for (const Line &line : mLines)
+    {
+        if (!line.tag.empty() && contains(variant.removedTags, line.tag))
+        {
+            continue;
+        }
+
+        auto substitution =
+            std::find_if(variant.substitutedTags.begin(), variant.substitutedTags.end(),
+                         [&line](const std::pair<std::string, std::string> &tag) {
+                             return tag.first == line.tag;
+                         });
+        if (!line.tag.empty() && substitution != variant.substitutedTags.end())
+        {
+            result.append(mSource, line.begin, line.tagBegin - line.begin);
+            result += substitution->second;
+            result.append(mSource, line.tagEnd, line.end - line.tagEnd);
+        }
+        else if (!fromVersionLine.empty() &&
+                 mSource.compare(line.begin, fromVersionLine.size(), fromVersionLine) == 0)
+        {
+            result += kVersionPrefix + variant.toVersion;
+            result.append(mSource, line.begin + fromVersionLine.size(),
+                          line.end - line.begin - fromVersionLine.size());
+        }
+        else
+        {
+            result.append(mSource, line.begin, line.end - line.begin);
+        }
+
+        if (line.end < mSource.size())
+        {
+            result += '\n';
+        }
+    }
+
+    return result;
+}
+
+ShaderPreprocessor::ShaderPreprocessor() : mMutex(), mTemplates(), mInstances() {}
+
+std::string ShaderPreprocessor::preprocess(const std::string &path,
+                                           const std::string &source,
+                                           const ShaderVariant &variant)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto key      = std::make_pair(path, variant.getKey());
+    auto instance = mInstances.find(key);
+    if (instance != mInstances.end())
+    {
+        return instance->second;
+    }
+
+    std::unique_ptr<ShaderTemplate> &shaderTemplate = mTemplates[path];
+    if (shaderTemplate == nullptr)
+    {
+        shaderTemplate.reset(new ShaderTemplate(source));
+    }
+
+    std::string result = shaderTemplate->instantiate(variant);
+    mInstances[key]    = result;
+    return result;
+}
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderPreprocessor.h: Define the preprocessor of shader tags. A tag is a comment of the form
+// "// #name" in a line of a shader, such as "// #noNormalMap" or "// #fogCode". Each shader file
+// is split into tagged lines once, and the variants are instantiated from the lines by masking
+// or substituting tags.
+
+#pragma once
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H 1
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ShaderVariant
+{
+    // Lines tagged with one of these tags are removed.
+    std::vector<std::string> removedTags;
+    // Pairs of tag and text. The tag is replaced by the text, keeping the rest of its line.
+    std::vector<std::pair<std::string, std::string>> substitutedTags;
+    // Rewrite "#version fromVersion" as "#version toVersion" if they aren't empty.
+    std::string fromVersion;
+    std::string toVersion;
+
+    // Unique for the content of the variant, to memoize instances.
+    std::string getKey() const;
+};
+
+class ShaderTemplate
+{
+  public:
+    explicit ShaderTemplate(const std::string &source);
+
+    std::string instantiate(const ShaderVariant &variant) const;
+
+  private:
+    struct Line
+    {
+        size_t begin;
+        size_t end;  // Excluding the line break.
+        // The comment "// #tag" if the line is tagged, otherwise tagBegin is std::string::npos.
+        size_t tagBegin;
+        size_t tagEnd;
+        std::string tag;
+    };
+
+    std::string mSource;
+    std::vector<Line> mLines;
+};
+
+// Memoizes a template per shader file, and an instance per file and variant. Safe to call on
+// several threads.
+class ShaderPreprocessor
+{
+  public:
+    ShaderPreprocessor();
+
+    // Instantiate the variant of the shader file at path. source is the content of the file, and
+    // is only tokenized the first time the file is seen.
+    std::string preprocess(const std::string &path,
+                           const std::string &source,
+                           const ShaderVariant &variant);
+
+  private:
+    std::mutex mMutex;
+    std::map<std::string, std::unique_ptr<ShaderTemplate>> mTemplates;
+    std::map<std::pair<std::string, std::string>, std::string> mInstances;
+};
+
+#endif  // !SHADER_PREPROCESSOR_H
@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2019 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ThreadPool.h: Define a fixed size pool of worker threads.
+
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H 1
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+  public:
+    // A pool without threads runs each task on the calling thread of enqueue().
+    explicit ThreadPool(int threadCount);
+    // Wait for all of the queued tasks to finish.
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void enqueue(std::function<void()> task);
+    int getThreadCount() const { return static_cast<int>(mThreads.size()); }
+
+    // Count of threads which can run in parallel, at least 1.
+    static int getHardwareThreadCount();
+
+  private:
+    void workerLoop();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStop;
+};
+
+#endif  // !THREAD_POOL_H
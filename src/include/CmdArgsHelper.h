@@ -14,6 +14,12 @@ const char *cmdArgsStrAquarium = R"(Options and arguments:
 --num-fish              : specifies how many fishes will be rendered.
 --allow-instanced-draws : specifies rendering fishes by instanced draw. By default, fishes are rendered by individual draw.Instanced rendering is only supported on dawn and d3d12 backend now.
 --enable-msaa           : Enable 4 samples MSAA. MSAA of angle backend is not supported now.
+--loading-threads       : specifies how many worker threads load assets at startup. By default, it's the count of cores. 0 loads assets serially on the render thread.
+--enable-interleaved-vertex-buffer : interleaves the vertex attributes of a model into one vertex buffer bound by one vertex binding. This option is only supported on opengl, angle and dawn backend.
+--enable-quantized-vertex-attributes : interleaves the vertex attributes like --enable-interleaved-vertex-buffer, and stores normals, tangents, binormals and texture coordinates as 16-bit normalized integers or half floats. This option is only supported on opengl, angle and dawn backend.
+--enable-progressive-loading : draws the first frame with placeholder textures, and swaps in the real textures when they are loaded. This option is only supported on opengl and angle backend.
+--texture-budget-mb     : streams the mips of textures needed by the view, keeping them within the budget of GPU memory in MB. This option is only supported on opengl and angle backend.
+--enable-fish-texture-arrays : packs the textures of the instanced fish species sharing a shader into texture arrays, so they share one pipeline and bind group. It requires --enable-instanced-draws. This option is only supported on dawn backend.
 --disable-dynamic-buffer-offset : The path is to test individual draw by creating many binding groups on dawn backend. By default, dynamic buffer offset is enabled. This option is only supported on dawn backend.)";
 
 const char *cmdArgsStrAquariumDirectMap = R"(Options and arguments:
@@ -21,4 +27,9 @@ const char *cmdArgsStrAquariumDirectMap = R"(Options and arguments:
 --num-fish              : specifies how many fishes will be rendered.
 --enable-msaa           : Enable 4 samples MSAA.)";
 
+const char *cmdArgsStrAquariumBake = R"(Usage: aquarium_bake [options] model.js...
+Bake JSON model files into binary mesh caches, which are written next to the JSON files.
+--force                 : rebuild caches even if they are up to date.
+--pack aquarium.pack    : pack the files into a single asset pack instead, where models are baked and packed as their mesh caches. Run it at the root of the repo, so the files are packed by their paths relative to the root.)";
+
 #endif